@@ -7,6 +7,14 @@
 #include <string>       // std::string type
 #include <curl/curl.h>  // cURL library
 
+class RdoCoalescer;
+class RdoCache;
+class RdoDaemon;
+class RdoClient;
+class RdoRateLimiter;
+class RdoMetrics;
+class RdoObserver;
+
 /** \class RdoAbsObject 
     \brief Abstract base class for random.org client.
     
@@ -23,10 +31,16 @@ class RdoAbsObject {
 public:
   RdoAbsObject();
   RdoAbsObject(const RdoAbsObject& other);
+  RdoAbsObject& operator=(const RdoAbsObject& other);
   virtual ~RdoAbsObject();
 
-  // get the libCURL object pointer
+  // initialize libCURL (once per process)
+  static void initCURL();
+  // get the libCURL object pointer (connection options are applied at transfer time)
   CURL* cURL() const { return _cURL; }
+  // download through a thread-safe client (one cURL session per thread)
+  void setClient(RdoClient* client);
+  RdoClient* client() const { return _client; }
   // agent (identify yourself to random.org)
   void setAgent(const char* agent);
   const char* agent() const { return _agent.c_str(); }
@@ -37,8 +51,10 @@ public:
   const char* proxyType() const { return _proxyType.c_str(); }
   // time-out
   void setTimeOut(unsigned int seconds = 120);
+  unsigned int timeOut() const { return _timeOut; }
 
   // random.org url
+  void setRdoUrl(const char* rdoUrl = "www.random.org");
   const char* rdoUrl() const { return _rdoUrl.c_str(); }
   // set/get secure HTTP connect
   void setScheme(const char* scheme);
@@ -57,6 +73,8 @@ public:
   // url address
   void setUrl(const char* u = 0);
   const char* url() const { return _url; }
+  //! size of the url buffer, including the terminating null
+  static const unsigned int kUrlSize = 512;
 
   // file options
   const char* outFileName() const { return _outFileName.c_str(); }
@@ -65,19 +83,64 @@ public:
   void setAppend(bool append=true);
   void setInMemory(bool inMem=true);
   bool inMemory() const { return _inMemory; }
+  void setOutString(std::string* out);
+  std::string* outString() const { return _outString; }
 
   // download data
   bool downloadToStdOut();
   bool downloadToFile();
+  bool downloadToString();
   bool downloadToMemory();
   bool downloadData();
 
+  // health tests on downloaded (in-memory) blocks
+  void setHealthTests(bool health=true);
+  bool healthTests() const { return _healthTests; }
+  unsigned long rejectedBlocks() const { return _rejectedBlocks; }
+
+  // merge concurrent in-memory downloads with other objects
+  void setCoalescer(RdoCoalescer* coalescer);
+  RdoCoalescer* coalescer() const { return _coalescer; }
+  // serve deterministic downloads from a cache
+  void setUrlCache(RdoCache* cache);
+  RdoCache* urlCache() const { return _cache; }
+  // get fresh data from a local rdo-entropyd daemon
+  void setDaemon(RdoDaemon* daemon);
+  RdoDaemon* daemon() const { return _daemon; }
+  // throttle requests to random.org with a shared rate limiter
+  void setRateLimiter(RdoRateLimiter* limiter);
+  RdoRateLimiter* rateLimiter() const { return _limiter; }
+  // count downloads, parses and draws in a shared metrics registry
+  void setMetrics(RdoMetrics* metrics);
+  RdoMetrics* metrics() const { return _metrics; }
+  // report request and cache events to an observer (e.g. for tracing)
+  void setObserver(RdoObserver* observer);
+  RdoObserver* observer() const { return _observer; }
+  // random bits a request for the current settings costs from the quota
+  virtual unsigned long requestBits() const { return 0; }
+
   //! memory struct for callback method for libCURL.
   struct CurlMem {
     char* memory;
     size_t size;
   };
 
+  //! timing (seconds) and size of one transfer, from libcurl and our own clocks
+  struct TransferStats {
+    double wait;          //<! waited for the rate limiter
+    double dns;           //<! name lookup
+    double connect;       //<! TCP connect after the name lookup (0 on a reused connection)
+    double tls;           //<! TLS handshake after the connect
+    double ttfb;          //<! start until the first response byte
+    double total;         //<! start until the last response byte
+    double parse;         //<! parsing the block into memory
+    unsigned long bytes;  //<! bytes downloaded
+    bool reused;          //<! went over a reused connection
+    bool failed;          //<! the download failed
+  };
+  // timing and size of the last transfer to random.org
+  const TransferStats& lastTransferStats() const { return _lastStats; }
+
 protected:
   std::string _scheme;       //<! http or https
   std::string _rdoUrl;       //<! base url for website
@@ -85,23 +148,74 @@ protected:
   std::string _rnd;          //<! randomization to use to generate the data
   unsigned int _num;         //<! number of random units to download;
   char* _url;                //<! the complete url for downloading data
+  std::string _postData;     //<! JSON body to POST (GET if empty)
 
   virtual void buildUrl() = 0;
   virtual void parseMemory(struct CurlMem cMem) = 0;
+  virtual bool coalescible() const { return false; }
+  virtual bool servedByDaemon() const { return false; }
+  virtual bool fetchFromDaemon(RdoDaemon& daemon);
+  void rejectBlock(const char* where, const char* reason);
+  static unsigned int bitsPerValue(double nValues);
+  //! count a draw (or n) from memory; the registry is updated once per kDrawBatch draws
+  void countDraw() { if(_metrics && ++_draws >= kDrawBatch) flushDraws(); }
+  void countDraws(unsigned int n) { if(_metrics && (_draws += n) >= kDrawBatch) flushDraws(); }
+  void flushDraws();
+  static const unsigned int kDrawBatch = 64;
+  static size_t writeMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp);
+  bool fetchMemory(struct CurlMem* cMem);
+  bool parseBlock(struct CurlMem cMem);
+  CURL* beginTransfer(bool acquired = false, double waited = 0.);
+  bool endTransfer(CURLcode res);
 
 private:
   CURL* _cURL;               //<! libCURL object
+  struct curl_slist* _headers; //<! HTTP headers for POST requests
   std::string _agent;        //<! some servers don't like anon agents
   std::string _proxy;        //<! proxy used by cURL
   std::string _proxyType;    //<! type of proxy used by cURL
+  unsigned int _timeOut;     //<! transfer time-out in seconds
   bool _inMemory;            //<! keep data in memory (don't write to file or cout)
   std::string _outFileName;  //<! name of file to which data is to be written
   bool _append;              //<! append-to or overwrite the output file?
+  std::string* _outString;   //<! string to which the raw data are appended (not owned)
+  bool _healthTests;         //<! run health tests on parsed blocks
+  unsigned long _rejectedBlocks; //<! number of blocks rejected by the health tests
+  bool _blockRejected;       //<! last parsed block was rejected
+  RdoCoalescer* _coalescer;  //<! shared request coalescer (not owned)
+  RdoCache* _cache;          //<! shared deterministic data cache (not owned)
+  RdoDaemon* _daemon;        //<! local entropy daemon connection (not owned)
+  RdoClient* _client;        //<! thread-safe client providing the cURL sessions (not owned)
+  RdoRateLimiter* _limiter;  //<! shared request throttle (not owned)
+  RdoMetrics* _metrics;      //<! shared metrics registry (not owned)
+  unsigned int _draws;       //<! draws not yet added to the registry
+  RdoObserver* _observer;    //<! request and cache event observer (not owned)
+  CURL* _sinkHandle;         //<! session of the observed transfer
+  size_t (*_sinkFn)(void*, size_t, size_t, void*); //<! write callback behind the observer (0: fwrite)
+  void* _sinkData;           //<! its data
+  bool _sinkFirst;           //<! no byte received yet
+  struct CurlMem _transferMem; //<! data of the running event-loop transfer (in memory)
+  FILE* _transferFile;       //<! output of the running event-loop transfer (to file)
+  TransferStats _lastStats;  //<! timing and size of the last transfer
+  bool _statsOpen;           //<! _lastStats belongs to an unfinished download
 
-  static size_t writeMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp);
+  friend class RdoCoalescer;
+  friend class RdoMulti;
+
+  CURL* handle();
+  void applyOptions(CURL* cURL);
+  void prepareUrl(CURL* cURL);
+  void throttle(bool acquired = false, double waited = 0.);
+  void recordTransfer(CURL* cURL);
+  void finishStats(bool failed);
+  void setSink(CURL* cURL, size_t (*fn)(void*, size_t, size_t, void*), void* data);
+  static size_t observedWriteCallback(void *contents, size_t size, size_t nmemb, void *userp);
+  static int connectedCallback(void* userp, char* remoteIp, char* localIp, int remotePort, int localPort);
   bool checkCURLcode(CURLcode res);
-  bool checkHTTPcode();
+  bool checkHTTPcode(CURL* cURL);
   bool checkBytesDnld();
+  bool cached();
+  bool downloadCached();
 };
 
 #endif // RDOABSOBJECT
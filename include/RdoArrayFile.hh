@@ -0,0 +1,81 @@
+/** \file RdoArrayFile.hh
+    \brief Header for typed binary (raw and NumPy .npy) output class
+*/
+#ifndef RDOARRAYFILE
+#define RDOARRAYFILE
+
+#include <string>
+#include <vector>
+#include "RdoCacheView.hh"
+
+/** \class RdoArrayFile
+    \brief Write in-memory data as a typed binary array, to a file or std::cout.
+
+    Formats:
+    - raw-i32, raw-i64: signed integers, native byte order;
+    - raw-f64: IEEE doubles, native byte order;
+    - npy: NumPy .npy (version 1.0) with int64 for integers, float64 for
+      fractions and uint8 for bytes; with columns > 1 (dividing the data)
+      the shape is (rows, columns), else (n,).
+
+    The header and the data go out in a single write (writev), so the
+    file can be memory-mapped directly, e.g. with numpy.load(mmap_mode='r').
+    Data arriving in pieces go between begin(), which writes the npy header
+    for all of them, and end(); each write() then appends its piece.
+
+    \code
+    RdoArrayFile out("dice.npy", "npy");
+    if(out.write(ints.view())) ... // failed
+
+    out.begin("integers", 3*n);    // header for all three pieces
+    for(...) out.write(ints.view());
+    out.end();
+    \endcode
+*/
+class RdoArrayFile {
+public:
+  RdoArrayFile(const char* fileName = "", const char* format = "npy");
+  RdoArrayFile(const RdoArrayFile& other);
+  virtual ~RdoArrayFile();
+
+  // output file (empty for std::cout)
+  void setFileName(const char* fileName);
+  const char* fileName() const { return _fileName.c_str(); }
+  // format; true if unknown
+  bool setFormat(const char* format);
+  const char* format() const { return _format.c_str(); }
+  static bool knownFormat(const char* format);
+  // columns (npy shape)
+  void setColumns(unsigned int columns = 1);
+  unsigned int columns() const { return _columns; }
+  // append to the file (raw formats only)
+  void setAppend(bool append = true);
+  bool append() const { return _append; }
+
+  // write integers, fractions or bytes (views of caches or vectors); true if failed
+  bool write(RdoCacheView<long int> data);
+  bool write(const RdoIntegerView& data);
+  bool write(RdoCacheView<double> data);
+  bool writeBytes(RdoCacheView<unsigned char> data);
+  // write in pieces: open (and the npy header for n integers, fractions or bytes)
+  // and close; true if failed
+  bool begin(const char* type, unsigned long n);
+  bool end();
+
+  // NumPy .npy header for n values of the dtype descr
+  static std::string npyHeader(const char* descr, unsigned long n, unsigned int columns = 1);
+
+protected:
+  std::string _fileName;   //<! output file (empty for std::cout)
+  std::string _format;     //<! raw-i32, raw-i64, raw-f64 or npy
+  unsigned int _columns;   //<! columns of the npy shape
+  bool _append;            //<! append to the file
+  int _fd;                 //<! output between begin() and end(); -1 otherwise
+
+  template<class T> static void convert(RdoCacheView<T> data, std::string& buffer, const std::string& to);
+  template<class To, class T> static void copy(RdoCacheView<T> data, std::string& buffer);
+  bool writeBuffer(const std::string& header, const char* data, size_t size);
+  static char byteOrder();
+};
+
+#endif // RDOARRAYFILE
@@ -0,0 +1,121 @@
+/** \file RdoAsync.hh
+    \brief Header for coroutine (C++20) downloads on an RdoMulti loop
+*/
+#ifndef RDOASYNC
+#define RDOASYNC
+
+#include "RdoMulti.hh"
+
+#if defined(__cpp_impl_coroutine)
+
+#include <vector>
+#include <string>
+#include <exception>
+#include <coroutine>
+#include <type_traits>
+#include <utility>
+#include "RdoBytes.hh"
+
+/** \struct RdoAsyncResult
+    \brief Outcome of an awaited download: failure flag and the values it brought.
+*/
+template<class V>
+struct RdoAsyncResult {
+  bool failed;   //<! true if the download failed
+  V data;        //<! values parsed by this download only
+
+  explicit operator bool() const { return !failed; }
+};
+
+/** \struct RdoAsyncData
+    \brief Value type returned by an awaited download of a T: the type of
+    T::cache(), except bytes, which come as stored (unsigned char, as
+    RdoBytes::take() gives them).
+*/
+template<class T>
+struct RdoAsyncData {
+  typedef typename std::conditional<std::is_base_of<RdoBytes, T>::value,
+				    std::vector<unsigned char>,
+				    decltype(std::declval<const T&>().cache())>::type type;
+};
+
+/** \class RdoFetch
+    \brief Awaitable download of one object; see RdoMulti::fetch.
+
+    The awaiting coroutine is suspended until the download is parsed, then
+    resumed from inside the loop (RdoMulti::run or perform) and gets an
+    RdoAsyncResult. The object must outlive the download.
+*/
+template<class T>
+class RdoFetch {
+public:
+  typedef typename RdoAsyncData<T>::type Data;
+  typedef RdoAsyncResult<Data> Result;
+
+  RdoFetch(RdoMulti& multi, T& obj)
+    : _multi(multi), _obj(obj), _first(0) { _result.failed = true; }
+
+  bool await_ready() const { return false; }
+
+  //! start the download; resume at once if it could not be started
+  bool await_suspend(std::coroutine_handle<> handle) {
+    _first = _obj.cacheSize();
+    bool failed = _multi.add(_obj, [this, handle](RdoAbsObject& /*obj*/, bool failed){
+	_result.failed = failed;
+	if(!failed) collect();
+	handle.resume();
+      });
+    return !failed;
+  }
+
+  //! the outcome; the awaitable is done with it
+  Result await_resume() { return std::move(_result); }
+
+protected:
+  RdoMulti& _multi;      //<! loop running the download
+  T& _obj;               //<! downloading object
+  unsigned int _first;   //<! cache size before the download
+  Result _result;        //<! outcome
+
+  //! copy the values appended to the object's cache by this download
+  void collect() {
+    auto cache = _obj.view().sub(_first);
+    _result.data.assign(cache.begin(), cache.end());
+  }
+};
+
+/** \struct RdoTask
+    \brief Return type of fire-and-forget coroutines awaiting RdoFetch.
+
+    The coroutine starts at once and runs up to its first co_await; it is
+    then driven by the RdoMulti loop and frees itself when it returns.
+
+    \code
+    RdoTask draw(RdoMulti& multi, RdoIntegers& ints) {
+      auto res = co_await multi.fetch(ints);
+      if(res) use(res.data);
+    }
+    \endcode
+*/
+struct RdoTask {
+  struct promise_type {
+    RdoTask get_return_object() { return RdoTask(); }
+    std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+    std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+//_____________________________________________________________________________
+/** Awaitable in-memory download of obj on this loop; obj is set in-memory. */
+template<class T>
+RdoFetch<T> RdoMulti::fetch(T& obj)
+{
+  obj.setInMemory(true);
+  return RdoFetch<T>(*this, obj);
+}
+
+#endif // __cpp_impl_coroutine
+
+#endif // RDOASYNC
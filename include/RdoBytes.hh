@@ -6,9 +6,13 @@
 
 #include <vector>
 #include "RdoAbsObject.hh"
+#include "RdoCacheView.hh"
 
 /** \class RdoBytes 
     \brief Get integers from random.org.
+
+    The bytes are kept in memory one byte each; rndm() and cache() widen
+    them to unsigned int.
 */
 class RdoBytes : public RdoAbsObject { 
 public:
@@ -18,7 +22,8 @@ public:
 
   // base
   void setBase(const char* base = "10");
-  const char* base() const { return _base.c_str(); }
+  const char* base() const;
+  unsigned int radix() const { return _base; }
 
   // columns
   void setColumns(unsigned int columns = 1);
@@ -26,19 +31,33 @@ public:
 
   // get a random byte (as int) from memory
   unsigned int rndm();
-
-  // examine the cached numbers
-  std::vector<unsigned int> cache() const { return _randData; }
+  // take the next n numbers from memory without copying (fewer at the end)
+  RdoCacheView<unsigned char> consume(unsigned int n);
+
+  // examine the cached numbers: view() without copying; cache() copies them widened to
+  // unsigned int (std::move(obj).cache() then empties the cache); take() empties the cache
+  // and moves the stored unsigned chars out (no copy)
+  std::vector<unsigned int> cache() const & { return std::vector<unsigned int>(_randData.begin(), _randData.end()); }
+  std::vector<unsigned int> cache() && { std::vector<unsigned int> data(cache()); std::vector<unsigned char>().swap(_randData); _pos = 0; return data; }
+  std::vector<unsigned char> take() { std::vector<unsigned char> data; data.swap(_randData); _pos = 0; return data; }
+  RdoCacheView<unsigned char> view() const { return RdoCacheView<unsigned char>(_randData); }
+  unsigned int cacheSize() const { return _randData.size(); }
   unsigned int currentCachePossition() const { return _pos; }
 
+  // random bits a request costs from the quota
+  virtual unsigned long requestBits() const;
+
 protected:
-  std::string _base;     //<! base that will be used to print the numbers
+  unsigned int _base;    //<! base that will be used to print the numbers (2, 8, 10 or 16)
   unsigned int _columns; //<! number of columns in which the integers will be arranged
-  std::vector<unsigned int> _randData;  //<! in-memory downloaded random numbers
+  std::vector<unsigned char> _randData;  //<! in-memory downloaded random numbers
   unsigned int _pos;                //<! current possition in random data array
 
   virtual void buildUrl();
   virtual void parseMemory(struct RdoAbsObject::CurlMem cMem);
+  virtual bool coalescible() const { return _columns==1; }
+  virtual bool servedByDaemon() const { return true; }
+  virtual bool fetchFromDaemon(RdoDaemon& daemon);
 };
 
 #endif // RDOBYTES
@@ -0,0 +1,85 @@
+/** \file RdoCache.hh
+    \brief Header for deterministic data cache class
+*/
+#ifndef RDOCACHE
+#define RDOCACHE
+
+#include <string>
+#include <list>
+#include <map>
+#include <mutex>
+
+/** \class RdoCache
+    \brief Content cache for deterministic (id. and date.) randomizations.
+
+    Downloads with randomization `id.identifier` or `date.YYYY-MM-DD` always
+    return the same data for the same url, so objects sharing a cache
+    (see RdoAbsObject::setUrlCache) download them only once. Responses are kept,
+    keyed by the url from buildUrl(), in a memory LRU list and, if a directory
+    is set, in one binary record file per url:
+
+    \verbatim
+    "RDOC"  version(u32)  key-length(u32)  payload-length(u64)  key  payload  fnv1a-64(payload)
+    \endverbatim
+
+    Both levels are bounded in bytes; the least recently used entries
+    (for the disk, by file modification time) are evicted first. Fresh data
+    (`new`) and the moving dates `today` and `yesterday` are never cached.
+*/
+class RdoCache {
+public:
+  RdoCache(const char* dir = "", unsigned long maxMemBytes = 16UL << 20, unsigned long maxDiskBytes = 256UL << 20);
+  RdoCache(const RdoCache& other);
+  inline virtual ~RdoCache() {}
+
+  // directory of the disk cache (empty for memory only)
+  bool setDirectory(const char* dir);
+  const char* directory() const { return _dir.c_str(); }
+  // size bounds
+  void setMaxMemBytes(unsigned long maxBytes);
+  unsigned long maxMemBytes() const { return _maxMem; }
+  void setMaxDiskBytes(unsigned long maxBytes);
+  unsigned long maxDiskBytes() const { return _maxDisk; }
+
+  // is a download with this url deterministic?
+  static bool cacheable(const char* url);
+
+  // entries
+  bool get(const std::string& url, std::string& data);
+  void put(const std::string& url, const std::string& data);
+  void erase(const std::string& url);
+  void clear();
+
+  // statistics
+  unsigned long memHits() const { return _memHits; }
+  unsigned long diskHits() const { return _diskHits; }
+  unsigned long misses() const { return _misses; }
+  unsigned long memBytes() const { return _memBytes; }
+  unsigned long diskBytes() const { return _diskBytes; }
+
+protected:
+  typedef std::list<std::pair<std::string, std::string> > LruList;
+
+  std::string _dir;                           //<! disk cache directory
+  unsigned long _maxMem;                      //<! memory bound in bytes
+  unsigned long _maxDisk;                     //<! disk bound in bytes
+  LruList _lru;                               //<! (url, data); most recent first
+  std::map<std::string, LruList::iterator> _index; //<! url to memory entry
+  unsigned long _memBytes;                    //<! bytes held in memory
+  unsigned long _diskBytes;                   //<! bytes held on disk
+  unsigned long _memHits;                     //<! hits from memory
+  unsigned long _diskHits;                    //<! hits from disk
+  unsigned long _misses;                      //<! misses
+  std::mutex _mutex;                          //<! guards all of the above
+
+  void putMem(const std::string& url, const std::string& data);
+  void eraseMem(const std::string& url);
+  void evictMem();
+  bool readFile(const std::string& url, std::string& data);
+  bool writeFile(const std::string& url, const std::string& data);
+  void pruneDisk();
+  std::string fileName(const std::string& url) const;
+  static unsigned long long hash(const char* data, size_t n);
+};
+
+#endif // RDOCACHE
@@ -0,0 +1,206 @@
+/** \file RdoCacheView.hh
+    \brief Header for read-only views of in-memory caches
+*/
+#ifndef RDOCACHEVIEW
+#define RDOCACHEVIEW
+
+#include <stddef.h>   // size_t
+#include <stdint.h>   // int8_t, int16_t, int32_t
+#include <string.h>   // memcpy
+#include <iterator>
+#include <vector>
+
+/** \class RdoCacheView
+    \brief Read-only view of values in an object's in-memory cache (or of
+    any contiguous array), without copying them.
+
+    A view is a pointer and a size; it stays valid until the cache it
+    points into changes, i.e. until the next download into the object, or
+    until the data are moved out of it or the object goes away. Views come
+    from view() (the whole cache) and consume(n) (the next n values, which
+    advances the cache position like n rndm() draws) of RdoIntegers,
+    RdoRandom, RdoBytes and RdoStrings; a std::vector converts to one.
+    With C++20 a view converts to std::span<const T>. Integers come as
+    an RdoIntegerView, since they are stored as narrow as their range allows.
+
+    \code
+    RdoIntegers ints;
+    ...
+    long int sum = 0;
+    for(long int v : ints.view()) sum += v;   // no copy, no allocation
+    RdoCacheView<double> next = fracs.consume(6);
+    \endcode
+*/
+template<class T>
+class RdoCacheView {
+public:
+  typedef T value_type;
+  typedef size_t size_type;
+  typedef const T& reference;
+  typedef const T& const_reference;
+  typedef const T* pointer;
+  typedef const T* iterator;
+  typedef const T* const_iterator;
+
+  RdoCacheView() : _data(0), _size(0) {}
+  RdoCacheView(const T* data, size_t size) : _data(data), _size(size) {}
+  RdoCacheView(const std::vector<T>& v) : _data(v.data()), _size(v.size()) {}
+  RdoCacheView(const RdoCacheView& other) : _data(other._data), _size(other._size) {}
+  inline virtual ~RdoCacheView() {}
+
+  RdoCacheView& operator=(const RdoCacheView& other) { _data = other._data; _size = other._size; return *this; }
+
+  // elements
+  const T* data() const { return _data; }
+  size_t size() const { return _size; }
+  bool empty() const { return _size==0; }
+  const T& operator[](size_t k) const { return _data[k]; }
+  const T& front() const { return _data[0]; }
+  const T& back() const { return _data[_size-1]; }
+  const T* begin() const { return _data; }
+  const T* end() const { return _data + _size; }
+
+  //! view of count values from first on (up to the end)
+  RdoCacheView sub(size_t first, size_t count = (size_t)-1) const
+  {
+    if(first > _size) first = _size;
+    if(count > _size - first) count = _size - first;
+    return RdoCacheView(_data + first, count);
+  }
+
+  //! copy of the values
+  std::vector<T> vector() const { return std::vector<T>(begin(), end()); }
+
+protected:
+  const T* _data;   //<! first value (not owned)
+  size_t _size;     //<! number of values
+};
+
+/** \class RdoIntegerView
+    \brief Read-only view of integers stored 1, 2, 4 or 8 bytes wide (see
+    RdoIntegers::width()), widened to long int on read.
+
+    Reading through operator[] or the iterators switches on the width for
+    every value (a well-predicted branch). For long scans, visit() switches
+    once and calls a function with the RdoCacheView of the stored type, so
+    the loop is compiled for that type; as<T>() gives that view directly if
+    T has the stored width. vector() and widen() copy with vectorized
+    loops (AVX2 where the CPU has it).
+
+    \code
+    long int sum = 0;
+    ints.view().visit([&](auto v){ for(auto x : v) sum += x; });
+    \endcode
+*/
+class RdoIntegerView {
+public:
+  typedef long int value_type;
+  typedef size_t size_type;
+
+  //! iterator widening the stored values
+  class const_iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef long int value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const long int* pointer;
+    typedef long int reference;
+
+    const_iterator() : _p(0), _width(8) {}
+    const_iterator(const char* p, unsigned int width) : _p(p), _width(width) {}
+
+    long int operator*() const { return RdoIntegerView::load(_p, _width); }
+    const_iterator& operator++() { _p += _width; return *this; }
+    const_iterator operator++(int) { const_iterator it(*this); _p += _width; return it; }
+    bool operator==(const const_iterator& other) const { return _p==other._p; }
+    bool operator!=(const const_iterator& other) const { return _p!=other._p; }
+
+  protected:
+    const char* _p;        //<! current value
+    unsigned int _width;   //<! bytes per value
+  };
+  typedef const_iterator iterator;
+
+  RdoIntegerView() : _data(0), _size(0), _width(sizeof(long int)) {}
+  RdoIntegerView(const void* data, size_t size, unsigned int width)
+    : _data((const char*)data), _size(size), _width(width) {}
+  RdoIntegerView(const RdoIntegerView& other)
+    : _data(other._data), _size(other._size), _width(other._width) {}
+  inline virtual ~RdoIntegerView() {}
+
+  RdoIntegerView& operator=(const RdoIntegerView& other)
+  { _data = other._data; _size = other._size; _width = other._width; return *this; }
+
+  // elements, widened
+  size_t size() const { return _size; }
+  bool empty() const { return _size==0; }
+  unsigned int width() const { return _width; }
+  long int operator[](size_t k) const { return load(_data + k * _width, _width); }
+  long int front() const { return (*this)[0]; }
+  long int back() const { return (*this)[_size-1]; }
+  const_iterator begin() const { return const_iterator(_data, _width); }
+  const_iterator end() const { return const_iterator(_data + _size * _width, _width); }
+
+  //! view of count values from first on (up to the end)
+  RdoIntegerView sub(size_t first, size_t count = (size_t)-1) const
+  {
+    if(first > _size) first = _size;
+    if(count > _size - first) count = _size - first;
+    return RdoIntegerView(_data + first * _width, count, _width);
+  }
+
+  //! widened copy of the values
+  std::vector<long int> vector() const;
+  //! widen the values into dst (size() long ints)
+  void widen(long int* dst) const;
+
+  //! the values as stored, if T is as wide (else an empty view)
+  template<class T> RdoCacheView<T> as() const
+  {
+    if(sizeof(T)!=_width) return RdoCacheView<T>();
+    return RdoCacheView<T>((const T*)_data, _size);
+  }
+
+  //! call fn with the RdoCacheView of the stored type
+  template<class Fn> void visit(Fn fn) const
+  {
+    switch(_width){
+    case 1:  fn(as<int8_t>()); break;
+    case 2:  fn(as<int16_t>()); break;
+    case 4:  fn(as<int32_t>()); break;
+    default: fn(as<long int>()); break;
+    }
+  }
+
+  //! value stored width bytes wide at p, read as a whole word and sign
+  //! extended, without a switch; needs 8 readable bytes from p on
+  static long int loadWord(const char* p, unsigned int width)
+  {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    unsigned int shift = 64 - 8*width;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return (long int)((int64_t)word >> shift);
+#else
+    return (long int)((int64_t)(word << shift) >> shift);
+#endif
+  }
+
+  //! value stored width bytes wide at p
+  static long int load(const char* p, unsigned int width)
+  {
+    switch(width){
+    case 1:  return *(const int8_t*)p;
+    case 2:  return *(const int16_t*)p;
+    case 4:  return *(const int32_t*)p;
+    default: return *(const long int*)p;
+    }
+  }
+
+protected:
+  const char* _data;     //<! first value (not owned)
+  size_t _size;          //<! number of values
+  unsigned int _width;   //<! bytes per value: 1, 2, 4 or 8
+};
+
+#endif // RDOCACHEVIEW
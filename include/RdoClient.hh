@@ -0,0 +1,107 @@
+/** \file RdoClient.hh
+    \brief Header for thread-safe client class
+*/
+#ifndef RDOCLIENT
+#define RDOCLIENT
+
+#include <vector>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <curl/curl.h>  // cURL library
+#include "RdoTransferStats.hh"
+
+/** \class RdoClient
+    \brief Thread-safe source of cURL sessions, one per thread.
+
+    A cURL easy session must not be used by two threads at once. A client
+    hands every calling thread its own session, kept in thread-local storage,
+    so objects in different threads can download at the same time through
+    one client (see RdoAbsObject::setClient). The sessions of a client share
+    their DNS cache, TLS sessions and connection pool, so threads reuse each
+    other's warm connections.
+
+    Every download through the client adds its timing and size (see
+    RdoAbsObject::lastTransferStats) to the client's rolling aggregates,
+    transferStats().
+
+    A thread holds its session until it exits, then hands it back to the
+    client, which gives it to the next new thread; so the number of sessions
+    follows the number of threads downloading at once, not the number of
+    threads ever served. Sessions not held by a thread are released when the
+    client is destroyed, which must not happen while a transfer is running;
+    a thread still holding one frees it when it exits or next needs a new
+    session. Clients can be moved (the sessions and statistics move along)
+    and copied (the copy starts without sessions or statistics).
+
+    \code
+    RdoClient client;
+    // in each of many threads
+    RdoIntegers ints;
+    ints.setInMemory();
+    client.downloadData(ints);
+    \endcode
+*/
+class RdoClient {
+public:
+  RdoClient();
+  RdoClient(const RdoClient& other);
+  RdoClient(RdoClient&& other);
+  RdoClient& operator=(const RdoClient& other);
+  RdoClient& operator=(RdoClient&& other);
+  virtual ~RdoClient();
+
+  // the calling thread's session
+  CURL* handle();
+  // number of sessions (held by threads or waiting for the next one)
+  unsigned long nHandles() const;
+
+  // download obj with the calling thread's session; true if failed
+  bool downloadData(RdoAbsObject& obj);
+
+  // rolling aggregates of the transfers made through this client
+  RdoTransferStats& transferStats() { return _stats; }
+  const RdoTransferStats& transferStats() const { return _stats; }
+
+protected:
+  //! data shared by the sessions, with its locks; stays put when the client
+  //! moves and lives on while threads hold sessions of a destroyed client
+  struct Shared {
+    CURLSH* share;                          //<! cURL share object
+    std::mutex locks[CURL_LOCK_DATA_LAST];  //<! one lock per kind of shared data
+    std::mutex mutex;                       //<! guards idle and nHandles
+    std::vector<CURL*> idle;                //<! sessions handed back by exited threads
+    unsigned long nHandles;                 //<! sessions not yet freed
+    std::atomic<bool> alive;                //<! the client still uses this data
+
+    Shared();
+    ~Shared();
+    void giveBack(CURL* handle);
+  };
+  //! a thread's session of one client
+  struct Session {
+    std::shared_ptr<Shared> shared;         //<! data of the client
+    CURL* handle;                           //<! the session
+  };
+  //! the calling thread's sessions by client id; hands them back when the thread exits
+  struct Holder {
+    std::map<unsigned long, Session> sessions;
+
+    ~Holder();
+    void prune();
+  };
+
+  unsigned long _id;                 //<! unique id, keys the thread-local sessions
+  std::shared_ptr<Shared> _shared;   //<! shared data (created with the first session)
+  mutable std::mutex _mutex;         //<! guards _shared
+  RdoTransferStats _stats;           //<! transfer aggregates (locks itself)
+
+  void release();
+  static Holder& holder();
+  static unsigned long newId();
+  static void lockShared(CURL* handle, curl_lock_data data, curl_lock_access access, void* shared);
+  static void unlockShared(CURL* handle, curl_lock_data data, void* shared);
+};
+
+#endif // RDOCLIENT
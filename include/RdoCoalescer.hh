@@ -0,0 +1,81 @@
+/** \file RdoCoalescer.hh
+    \brief Header for request coalescing class
+*/
+#ifndef RDOCOALESCER
+#define RDOCOALESCER
+
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "RdoAbsObject.hh"
+
+/** \class RdoCoalescer
+    \brief Merge concurrent small in-memory downloads into one request.
+
+    Objects sharing a coalescer (see RdoAbsObject::setCoalescer) and asking
+    for the same data, i.e. the same url from buildUrl() apart from num,
+    within a short time window are served by a single download. The first
+    object to ask (the leader) waits for the window to close, downloads the
+    sum of all requested numbers and hands each object its share of the
+    lines, which every object then parses (and health-tests) in its own thread.
+
+    Only fresh data (randomization "new") is coalesced; requests of at least
+    maxNum values are downloaded directly.
+
+    \code
+    RdoCoalescer coalescer;
+    // in each of many threads
+    RdoIntegers ints;
+    ints.setInMemory();
+    ints.setCoalescer(&coalescer);
+    ints.downloadData();
+    \endcode
+*/
+class RdoCoalescer {
+public:
+  RdoCoalescer(unsigned int windowMs = 10, unsigned int maxNum = 10000);
+  RdoCoalescer(const RdoCoalescer& other);
+  inline virtual ~RdoCoalescer() {}
+
+  // time window (milliseconds) during which requests are merged
+  void setWindow(unsigned int windowMs = 10);
+  unsigned int window() const { return _windowMs; }
+  // largest merged request (random.org limits num to 10000)
+  void setMaxNum(unsigned int maxNum = 10000);
+  unsigned int maxNum() const { return _maxNum; }
+
+  // statistics
+  unsigned long requests() const { return _requests; }
+  unsigned long downloads() const { return _downloads; }
+
+  // download (in memory) for obj, possibly merged with other requests
+  bool download(RdoAbsObject& obj);
+
+protected:
+  //! requests merged into one download
+  struct Group {
+    std::vector<RdoAbsObject*> members;   //<! requesting objects; the first is the leader
+    std::vector<std::string> chunks;      //<! lines for each member
+    unsigned int num;                     //<! total number of values requested
+    bool done;                            //<! download finished
+    bool failed;                          //<! download failed
+  };
+
+  unsigned int _windowMs;                 //<! merge window in milliseconds
+  unsigned int _maxNum;                   //<! maximum merged num
+  std::atomic<unsigned long> _requests;   //<! number of download requests
+  std::atomic<unsigned long> _downloads;  //<! number of actual downloads
+  std::mutex _mutex;                      //<! guards the open groups
+  std::condition_variable _cond;          //<! signals full and finished groups
+  std::map<std::string, std::shared_ptr<Group> > _open; //<! groups accepting members, by key
+
+  bool downloadDirect(RdoAbsObject& obj);
+  bool downloadMerged(RdoAbsObject& obj, std::shared_ptr<Group> group);
+  static std::string key(RdoAbsObject& obj);
+};
+
+#endif // RDOCOALESCER
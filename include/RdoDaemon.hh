@@ -0,0 +1,125 @@
+/** \file RdoDaemon.hh
+    \brief Header for rdo-entropyd client class and protocol
+*/
+#ifndef RDODAEMON
+#define RDODAEMON
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** \struct RdoDaemonHeader
+    \brief Header of an rdo-entropyd request or response frame.
+
+    A request is a header followed by nItems RdoDaemonItem records.
+    A response is a header (status set) followed by the data of each item
+    in request order: bytes as n unsigned chars, integers as n int64_t and
+    fractions as n doubles in [0,1). All fields are in host byte order;
+    the peers share a host.
+*/
+struct RdoDaemonHeader {
+  uint32_t magic;     //<! RdoDaemon::kMagic
+  uint16_t status;    //<! response status (RdoDaemon::Status); 0 in requests
+  uint16_t nItems;    //<! number of items in the batch
+};
+
+/** \struct RdoDaemonItem
+    \brief One request of a batch.
+*/
+struct RdoDaemonItem {
+  uint32_t type;      //<! RdoDaemon::Type
+  uint32_t n;         //<! number of values
+  int64_t min;        //<! integers: smallest value
+  int64_t max;        //<! integers: largest value
+};
+
+/** \class RdoDaemon
+    \brief Client for the rdo-entropyd daemon.
+
+    rdo-entropyd owns the random.org connection and an in-memory pool of
+    health-tested random bytes, and serves bytes, integers in a range and
+    fractions over a Unix domain socket. Requests are queued with the add
+    methods and sent as one batch by request(); the data of each request
+    are then available by the index returned by the add method.
+
+    Objects derived from RdoAbsObject use a daemon instead of random.org
+    when set with RdoAbsObject::setDaemon(). A connection is used by one
+    thread at a time.
+
+    The default socket lives in a directory only the user can enter
+    (privateSocket()); the client refuses it if that directory belongs to
+    someone else or is open to others, so another local user cannot pose
+    as the daemon.
+
+    \code
+    RdoDaemon daemon;
+    unsigned int dice = daemon.addIntegers(10, 1, 6);
+    unsigned int key  = daemon.addBytes(32);
+    if(!daemon.request()) use(daemon.integers(dice), daemon.bytes(key));
+    \endcode
+*/
+class RdoDaemon {
+public:
+  //! item types
+  enum Type { kBytes=1, kIntegers=2, kFractions=3 };
+  //! response status
+  enum Status { kOk=0, kBadRequest=1, kUnavailable=2 };
+  //! frame magic ("RDOE")
+  static const uint32_t kMagic = 0x454f4452;
+  //! largest number of values in one item
+  static const uint32_t kMaxN = 1 << 24;
+  //! largest number of items in one batch
+  static const uint16_t kMaxItems = 1024;
+  //! largest response data of one batch, in bytes (one item of kMaxN integers)
+  static const uint64_t kMaxBytes = (uint64_t)kMaxN * sizeof(int64_t);
+
+  RdoDaemon(const char* socket = "");
+  RdoDaemon(const RdoDaemon& other);
+  virtual ~RdoDaemon();
+
+  // socket path
+  void setSocket(const char* socket = "");
+  const char* socket() const { return _socket.c_str(); }
+  static std::string defaultSocket();
+  static std::string privateSocket();
+  static bool checkPrivateDir(const std::string& socket, bool create = false);
+
+  // connection (opened on demand by request())
+  bool connect();
+  void disconnect();
+  bool connected() const { return _fd >= 0; }
+
+  // queue requests; return the index of the request
+  unsigned int addBytes(uint32_t n);
+  unsigned int addIntegers(uint32_t n, int64_t min, int64_t max);
+  unsigned int addFractions(uint32_t n);
+  void clearRequests();
+  unsigned int nRequests() const { return _items.size(); }
+
+  // send the queued batch; true if failed
+  bool request();
+
+  // results of the last batch
+  const std::vector<unsigned char>& bytes(unsigned int k) const { return _bytes[k]; }
+  const std::vector<long int>& integers(unsigned int k) const { return _integers[k]; }
+  const std::vector<double>& fractions(unsigned int k) const { return _fractions[k]; }
+
+  // response data bytes of an item (0 if the type is unknown)
+  static uint64_t dataSize(const RdoDaemonItem& item);
+
+  // frame i/o on a socket; true if failed
+  static bool writeAll(int fd, const void* data, size_t size);
+  static bool readAll(int fd, void* data, size_t size);
+
+protected:
+  std::string _socket;                            //<! socket path
+  int _fd;                                        //<! connected socket (-1 if none)
+  std::vector<RdoDaemonItem> _items;              //<! queued requests
+  std::vector<std::vector<unsigned char> > _bytes;//<! bytes results
+  std::vector<std::vector<long int> > _integers;  //<! integers results
+  std::vector<std::vector<double> > _fractions;   //<! fractions results
+
+  unsigned int addItem(uint32_t type, uint32_t n, int64_t min, int64_t max);
+};
+
+#endif // RDODAEMON
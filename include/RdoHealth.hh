@@ -0,0 +1,208 @@
+/** \file RdoHealth.hh
+    \brief Header for health tests class
+*/
+#ifndef RDOHEALTH
+#define RDOHEALTH
+
+#include <string>
+#include <vector>
+
+/** \class RdoHealth
+    \brief Continuous health tests on a downloaded block of random data.
+
+    The tests follow the spirit of NIST SP 800-90B section 4.4:
+    the repetition count test (RCT) and the adaptive proportion test (APT)
+    are updated for every sample as it is parsed, and a chi-square test on
+    the binned sample frequencies is evaluated at the end of the block.
+    Samples are symbols in [0,nSymbols), assumed to be uniformly distributed.
+
+    Typical use within a parseMemory method:
+    \code
+    RdoHealth health;
+    health.begin(nSymbols, nExpected);
+    // for every parsed value
+    health.fill(symbol);
+    // at the end of the block
+    if(health.end()) rejectBlock("...", health.reason());
+    \endcode
+
+    A whole parsed block is cheaper to test with fill(first, last, symbol),
+    in a pass of its own after parsing, than value by value while parsing:
+    the test state then stays in registers.
+*/
+class RdoHealth {
+public:
+  RdoHealth();
+  RdoHealth(const RdoHealth& other);
+  inline virtual ~RdoHealth() {}
+
+  // start a new block
+  void begin(double nSymbols, unsigned long nExpected);
+  // add a sample (symbol) to the block
+  inline void fill(unsigned long long symbol);
+  // add the samples symbol(*it) of the values in [first,last) to the block
+  template<class It, class Symbol> inline void fill(It first, It last, Symbol symbol);
+  // flag the block as failed
+  void fail(const char* reason);
+  // finish the block; true if the block failed
+  bool end();
+
+  // results
+  bool failed() const { return _failed; }
+  const char* reason() const { return _reason.c_str(); }
+  unsigned long samples() const { return _n; }
+  double chiSquare() const { return _chi2; }
+  unsigned int bins() const { return _nBins; }
+
+  // test cutoffs
+  static unsigned int rctCutoff(double entropy);
+  static unsigned int aptCutoff(double entropy, unsigned int window);
+  static double chiSquareCritical(unsigned int dof);
+
+protected:
+  // counts kept per frequency bin, summed by end()
+  static const unsigned int kLanes = 4;
+
+  // run the tests on a run of samples
+  template<bool Identity, class It, class Symbol> inline void fillTests(It first, It last, Symbol symbol);
+
+  // frequency bin of a symbol
+  unsigned int bin(unsigned long long symbol) const { return bin(symbol, _binMul, _binScale, _nBins); }
+  // frequency bin of a symbol, symbol * mul / 2^63 (an integer multiply and shift)
+  static unsigned int bin(unsigned long long symbol, unsigned long long mul, double scale,
+			  unsigned int nBins) {
+#if defined(__SIZEOF_INT128__)
+    unsigned long long b = (unsigned long long)(((unsigned __int128)symbol * mul) >> 63);
+    (void)scale;
+#else
+    unsigned long long b = (unsigned long long)((double)(long long)symbol * scale);
+    (void)mul;
+#endif
+    return (b < nBins) ? (unsigned int)b : nBins-1;
+  }
+
+  double _nSymbols;            //<! number of possible symbols
+  bool _active;                //<! run the RCT, APT and chi-square tests
+  unsigned long _n;            //<! number of samples in this block
+  bool _failed;                //<! block failed a test
+  std::string _reason;         //<! name of the first failed test
+
+  unsigned long long _rctLast; //<! RCT: last symbol seen
+  unsigned int _rctCount;      //<! RCT: number of consecutive repetitions
+  unsigned int _rctCutoff;     //<! RCT: failure cutoff
+
+  unsigned long long _aptFirst;//<! APT: first symbol of the window
+  unsigned int _aptIdx;        //<! APT: possition in the window
+  unsigned int _aptCount;      //<! APT: occurences of the first symbol
+  unsigned int _aptWindow;     //<! APT: window size
+  unsigned int _aptCutoff;     //<! APT: failure cutoff
+
+  double _binScale;            //<! chi-square: bins per symbol
+  unsigned long long _binMul;  //<! chi-square: bins per symbol, times 2^63
+  unsigned int _nBins;         //<! chi-square: number of frequency bins
+  std::vector<unsigned long> _bins; //<! chi-square: frequency bins, kLanes counts each
+  double _chi2;                //<! chi-square: statistic of the last block
+};
+
+//_____________________________________________________________________________
+/** Add a sample to the block; symbol must be in [0,nSymbols).
+    Inlined since it is called for every parsed value.
+*/
+inline void RdoHealth::fill(unsigned long long symbol)
+{
+  if(_active){
+    // repetition count test
+    if(symbol==_rctLast){
+      if(++_rctCount >= _rctCutoff) fail("repetition count test");
+    } else {
+      _rctLast = symbol;
+      _rctCount = 1;
+    }
+
+    // adaptive proportion test
+    if(_aptIdx==0){
+      _aptFirst = symbol;
+      _aptCount = 1;
+    } else if(symbol==_aptFirst){
+      if(++_aptCount >= _aptCutoff) fail("adaptive proportion test");
+    }
+    if(++_aptIdx >= _aptWindow) _aptIdx = 0;
+
+    // frequency bins
+    if(_nBins) _bins[bin(symbol)*kLanes]++;
+  }
+  _n++;
+}
+
+//_____________________________________________________________________________
+/** Add the samples symbol(*it), it in [first,last), to the block; the same
+    as fill() on each.
+*/
+template<class It, class Symbol>
+inline void RdoHealth::fill(It first, It last, Symbol symbol)
+{
+  _n += last - first;
+  if(!_active) return;
+  // one bin per symbol (no more symbols than bins) needs no scaling
+  if(_nBins && _binMul==(1ULL << 63)) fillTests<true>(first, last, symbol);
+  else fillTests<false>(first, last, symbol);
+}
+
+//_____________________________________________________________________________
+/** Run the tests on the samples symbol(*it), it in [first,last), with the
+    test state kept in locals and the APT window walked in runs, so that no
+    test state is carried through memory; Identity if symbols are bins.
+*/
+template<bool Identity, class It, class Symbol>
+inline void RdoHealth::fillTests(It first, It last, Symbol symbol)
+{
+  unsigned long long rctLast = _rctLast, aptFirst = _aptFirst;
+  unsigned int rctCount = _rctCount, rctCutoff = _rctCutoff;
+  unsigned int aptIdx = _aptIdx, aptCount = _aptCount, aptCutoff = _aptCutoff;
+  unsigned long* bins = _nBins ? _bins.data() : 0;
+  unsigned long long binMul = _binMul;
+  double binScale = _binScale;
+  unsigned int nBins = _nBins;
+  unsigned int lane = 0;
+  while(first!=last){
+    // a new APT window: its first sample is counted by the loop below
+    if(aptIdx==0){
+      aptFirst = symbol(*first);
+      aptCount = 0;
+    }
+    // the rest of this window, or of the samples
+    unsigned long rest = _aptWindow - aptIdx;
+    It end = ((unsigned long)(last - first) > rest) ? first + rest : last;
+    aptIdx += end - first;
+    if(aptIdx >= _aptWindow) aptIdx = 0;
+
+    for(; first!=end; ++first){
+      unsigned long long s = symbol(*first);
+
+      // repetition count test
+      if(s==rctLast){
+	if(++rctCount >= rctCutoff) fail("repetition count test");
+      } else {
+	rctLast = s;
+	rctCount = 1;
+      }
+
+      // adaptive proportion test
+      if(s==aptFirst && ++aptCount >= aptCutoff) fail("adaptive proportion test");
+
+      // frequency bins; consecutive samples count in different lanes, so
+      // that a repeated bin does not wait on its previous increment
+      if(bins){
+	unsigned int b = Identity ? ((s < nBins) ? (unsigned int)s : nBins-1) : bin(s, binMul, binScale, nBins);
+	bins[b*kLanes + (lane++ & (kLanes-1))]++;
+      }
+    }
+  }
+  _rctLast = rctLast;
+  _rctCount = rctCount;
+  _aptFirst = aptFirst;
+  _aptIdx = aptIdx;
+  _aptCount = aptCount;
+}
+
+#endif // RDOHEALTH
@@ -6,9 +6,16 @@
 
 #include <vector>
 #include "RdoAbsObject.hh"
+#include "RdoCacheView.hh"
 
 /** \class RdoIntegers 
     \brief Get integers from random.org.
+
+    The numbers are kept in memory 1, 2, 4 or 8 bytes wide, the narrowest
+    type holding the range (setRange) of every block downloaded; a wider
+    range widens the numbers already in memory. They are packed in one
+    buffer, so rndm() reads the next one without switching on the width;
+    view() and cache() widen them to long int on read.
 */
 class RdoIntegers : public RdoAbsObject { 
 public:
@@ -25,7 +32,8 @@ public:
 
   // base
   void setBase(const char* base = "10");
-  const char* base() const { return _base.c_str(); }
+  const char* base() const;
+  unsigned int radix() const { return _base; }
 
   // columns
   void setColumns(unsigned int columns = 1);
@@ -33,21 +41,44 @@ public:
 
   // get a random integer from memory
   long int rndm();
+  // take the next n numbers from memory without copying (fewer at the end)
+  RdoIntegerView consume(unsigned int n);
 
-  // examine the cached numbers
-  std::vector<long int> cache() const { return _randData; }
+  // examine the cached numbers: view() without copying, cache() as a widened copy;
+  // std::move(obj).cache() then empties the cache and frees its memory (it still
+  // copies unless width() is 8)
+  std::vector<long int> cache() const & { return view().vector(); }
+  std::vector<long int> cache() &&;
+  RdoIntegerView view() const { return RdoIntegerView(_randData.data(), _size, _width); }
+  unsigned int cacheSize() const { return _size; }
   unsigned int currentCachePossition() const { return _pos; }
+  // bytes per cached number (1, 2, 4 or 8): the narrowest for the ranges downloaded
+  unsigned int width() const { return _width; }
+  static unsigned int widthFor(long int min, long int max);
+
+  // random bits a request costs from the quota
+  virtual unsigned long requestBits() const;
 
 protected:
   long int _min;         //<! smallest value allowed for each integer
   long int _max;         //<! largest value allowed for each integer
-  std::string _base;     //<! base that will be used to print the numbers
+  unsigned int _base;    //<! base that will be used to print the numbers (2, 8, 10 or 16)
   unsigned int _columns; //<! number of columns in which the integers will be arranged
-  std::vector<long int> _randData;  //<! in-memory downloaded random numbers
+  std::vector<long int> _randData;  //<! in-memory downloaded random numbers, packed _width bytes each
+  unsigned int _size;               //<! numbers in memory
+  unsigned int _width;              //<! bytes per number in memory
   unsigned int _pos;                //<! current possition in random data array
 
+  void store(const std::vector<long int>& block);
+  void append(const long int* values, size_t n);
+  void clearData();
+
   virtual void buildUrl();
   virtual void parseMemory(struct RdoAbsObject::CurlMem cMem);
+  virtual unsigned int expectedNum() const { return num(); }
+  virtual bool coalescible() const { return _columns==1; }
+  virtual bool servedByDaemon() const { return true; }
+  virtual bool fetchFromDaemon(RdoDaemon& daemon);
 };
 
 #endif // RDOINTEGERS
@@ -0,0 +1,77 @@
+/** \file RdoJson.hh
+    \brief Header for in-place JSON decoder class
+*/
+#ifndef RDOJSON
+#define RDOJSON
+
+#include <string>
+#include <vector>
+
+/** \class RdoJson
+    \brief Minimal in-place JSON decoder.
+
+    parse() tokenizes a mutable, NUL-terminated text buffer in a single pass
+    without allocating per value: strings are unescaped in place and every
+    string and primitive token is NUL-terminated inside the buffer, so
+    str() returns pointers into the original text. The buffer must outlive
+    the decoder. Tokens are stored in document order; token 0 is the root.
+
+    decodeBase64() decodes base64 in place, e.g. a blob string token.
+*/
+class RdoJson {
+public:
+  //! token types
+  enum Type { kNone=0, kObject, kArray, kString, kPrimitive };
+
+  //! token; a span of the text buffer
+  struct Token {
+    Type type;       //<! type of the token
+    size_t start;    //<! offset of the first character
+    size_t end;      //<! offset one past the last character
+    int size;        //<! number of children (object: number of keys)
+    int skip;        //<! index of the token following this sub-tree
+  };
+
+  RdoJson();
+  RdoJson(const RdoJson& other);
+  inline virtual ~RdoJson() {}
+
+  // decode a mutable text buffer; true if it failed
+  bool parse(char* text, size_t len);
+  const char* error() const { return _error.c_str(); }
+
+  // tokens
+  int size() const { return (int)_tokens.size(); }
+  const Token& token(int i) const { return _tokens[i]; }
+  Type type(int i) const { return (i>=0 && i<size()) ? _tokens[i].type : kNone; }
+  int children(int i) const { return (i>=0 && i<size()) ? _tokens[i].size : 0; }
+
+  // navigation; -1 if not found
+  int find(int obj, const char* key) const;
+  int at(int arr, int idx) const;
+  int first(int i) const { return (children(i)>0) ? i+1 : -1; }
+  int next(int i) const { return _tokens[i].skip; }
+
+  // values
+  const char* str(int i) const { return (i>=0 && i<size()) ? _text + _tokens[i].start : ""; }
+  size_t length(int i) const { return (i>=0 && i<size()) ? _tokens[i].end - _tokens[i].start : 0; }
+  long int asLong(int i, int base = 10) const;
+  double asDouble(int i) const;
+  bool asBool(int i) const;
+  bool isNull(int i) const;
+
+  // base64
+  static bool decodeBase64(char* text, size_t len, size_t* decoded);
+  // append a quoted, escaped JSON string to out
+  static void quote(std::string& out, const char* s);
+
+protected:
+  char* _text;                  //<! decoded buffer (not owned)
+  std::vector<Token> _tokens;   //<! tokens in document order
+  std::string _error;           //<! description of the last parse error
+
+  bool fail(const char* what, size_t pos);
+  size_t unescape(size_t start, size_t end);
+};
+
+#endif // RDOJSON
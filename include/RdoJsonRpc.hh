@@ -0,0 +1,89 @@
+/** \file RdoJsonRpc.hh
+    \brief Header for JSON-RPC (api.random.org) class
+*/
+#ifndef RDOJSONRPC
+#define RDOJSONRPC
+
+#include <vector>
+#include "RdoAbsObject.hh"
+
+/** \struct RdoJsonRpcResult
+    \brief Typed result of one JSON-RPC call.
+*/
+struct RdoJsonRpcResult {
+  std::string method;                 //<! JSON-RPC method name
+  std::vector<long int> integers;     //<! generateIntegers data
+  std::vector<double> fractions;      //<! generateDecimalFractions data
+  std::vector<std::string> strings;   //<! generateStrings data
+  std::vector<std::vector<unsigned char> > blobs; //<! generateBlobs data (decoded)
+  bool done;                          //<! a result (or error) was received
+  int errorCode;                      //<! JSON-RPC error code (0 if none)
+  std::string error;                  //<! JSON-RPC error message
+  unsigned long bitsUsed;             //<! bits used by this call
+  long int advisoryDelay;             //<! milliseconds to wait before the next request
+};
+
+/** \class RdoJsonRpc
+    \brief Client for the JSON-RPC API at api.random.org (release 4).
+
+    Typed calls are queued with the add methods and sent in a single round
+    trip by downloadData(); more than one queued call is sent as a JSON-RPC
+    batch. The response is decoded in place and each call's typed data is
+    available through result(k), where k is the index returned by the add method.
+    Data is always kept in memory.
+
+    \code
+    RdoJsonRpc rpc;
+    rpc.setApiKey("00000000-0000-0000-0000-000000000000");
+    unsigned int ints  = rpc.addIntegers(100, 1, 6);
+    unsigned int blobs = rpc.addBlobs(2, 1024);
+    if(!rpc.downloadData()) use(rpc.result(ints).integers, rpc.result(blobs).blobs);
+    \endcode
+*/
+class RdoJsonRpc : public RdoAbsObject {
+public:
+  RdoJsonRpc();
+  RdoJsonRpc(const RdoJsonRpc& other);
+  inline virtual ~RdoJsonRpc() {}
+
+  // api key
+  void setApiKey(const char* apiKey);
+  const char* apiKey() const { return _apiKey.c_str(); }
+
+  // queue typed calls; return the index of the call
+  unsigned int addIntegers(unsigned int n, long int min, long int max, bool replacement = true);
+  unsigned int addDecimalFractions(unsigned int n, unsigned int decimals, bool replacement = true);
+  unsigned int addStrings(unsigned int n, unsigned int length, const char* characters, bool replacement = true);
+  unsigned int addBlobs(unsigned int n, unsigned int bits);
+  void clearCalls();
+  unsigned int nCalls() const { return _calls.size(); }
+
+  // results of the last download
+  const RdoJsonRpcResult& result(unsigned int k) const { return _results[k]; }
+  long int bitsLeft() const { return _bitsLeft; }
+  long int requestsLeft() const { return _requestsLeft; }
+
+protected:
+  //! a queued call
+  struct Call {
+    std::string method;   //<! JSON-RPC method name
+    std::string params;   //<! JSON parameters, without the api key
+    long int min;         //<! integers: smallest value
+    long int max;         //<! integers: largest value
+    unsigned int decimals;//<! fractions: decimal places
+    unsigned int size;    //<! blobs: size in bytes; strings: length
+    std::string chars;    //<! strings: allowed characters
+  };
+
+  std::string _apiKey;                    //<! api.random.org key
+  std::vector<Call> _calls;               //<! queued calls
+  std::vector<RdoJsonRpcResult> _results; //<! results of the queued calls
+  long int _bitsLeft;                     //<! remaining bits in the key's quota
+  long int _requestsLeft;                 //<! remaining requests in the key's quota
+
+  virtual void buildUrl();
+  virtual void parseMemory(struct RdoAbsObject::CurlMem cMem);
+  unsigned int addCall(const Call& call);
+};
+
+#endif // RDOJSONRPC
@@ -0,0 +1,122 @@
+/** \file RdoMetrics.hh
+    \brief Header for metrics registry class
+*/
+#ifndef RDOMETRICS
+#define RDOMETRICS
+
+#include <string>
+#include <atomic>
+
+/** \class RdoMetrics
+    \brief Lock-free counters, gauges and histograms of downloads, parsing
+    and the in-memory caches, shared by objects and threads (see
+    RdoAbsObject::setMetrics), with export in the Prometheus text format.
+
+    The set of metrics is fixed, so updates need no lookup: a counter is
+    a relaxed atomic add on a cache line of the calling thread's shard,
+    a histogram observation (once per transfer) a few relaxed adds. The
+    rndm() draws are counted per object and added in batches of
+    RdoAbsObject::kDrawBatch (and when the object goes away), so the
+    registry may lag by a few draws. Objects without a registry pay a
+    single null-pointer check.
+
+    text() renders all metrics; writeFile() replaces a file with them
+    (e.g. for the node_exporter textfile collector), sendTo() writes them
+    to a Unix domain socket and write() picks one by the "unix:" prefix.
+
+    \code
+    RdoMetrics metrics;
+    RdoIntegers ints;
+    ints.setMetrics(&metrics);
+    ...
+    metrics.writeFile("/var/lib/node_exporter/rdo.prom");
+    \endcode
+*/
+class RdoMetrics {
+public:
+  //! counters
+  enum Counter {
+    kRequests = 0,   //<! transfers to random.org
+    kFailures,       //<! failed transfers
+    kBytes,          //<! bytes downloaded
+    kRefills,        //<! blocks added to an in-memory cache
+    kRejected,       //<! blocks rejected by the health tests
+    kUrlHits,        //<! downloads served by the URL cache
+    kUrlMisses,      //<! URL cache misses
+    kDaemonFetches,  //<! in-memory refills from rdo-entropyd
+    kRndm,           //<! values drawn with rndm()
+    kWraps,          //<! rndm() ran past the cache and began to repeat
+    kEmpty,          //<! rndm() found no data in memory
+    kServedBytes,    //<! bytes served to clients (rdo-entropyd)
+    kNCounters
+  };
+  //! gauges
+  enum Gauge {
+    kQuotaBits = 0,  //<! remaining quota, as last downloaded
+    kPoolBytes,      //<! bytes in the pool (rdo-entropyd)
+    kNGauges
+  };
+  //! histograms, in seconds
+  enum Histogram {
+    kDownloadSeconds = 0,  //<! whole transfer
+    kFirstByteSeconds,     //<! time to the first byte
+    kParseSeconds,         //<! parsing a block
+    kNHistograms
+  };
+
+  RdoMetrics();
+  RdoMetrics(const RdoMetrics& other);
+  inline virtual ~RdoMetrics() {}
+
+  // update
+  void add(Counter c, unsigned long long n = 1)
+  { _counters[c][shard()].value.fetch_add(n, std::memory_order_relaxed); }
+  void setGauge(Gauge g, double value) { _gauges[g].store(value, std::memory_order_relaxed); }
+  void observe(Histogram h, double seconds);
+
+  // read
+  unsigned long long counter(Counter c) const;
+  double gauge(Gauge g) const { return _gauges[g].load(std::memory_order_relaxed); }
+  unsigned long long count(Histogram h) const;
+  double sum(Histogram h) const;
+  static double bucketEdge(unsigned int k);
+
+  // export; true if failed
+  std::string text() const;
+  bool writeFile(const char* path) const;
+  bool sendTo(const char* socketPath) const;
+  bool write(const char* where) const;
+
+  void reset();
+
+  //! counter shards (threads hash onto them)
+  static const unsigned int kShards = 16;
+  //! histogram buckets, the last one is +Inf
+  static const unsigned int kBuckets = 18;
+
+protected:
+  //! a counter shard on its own cache line
+  struct alignas(64) Cell {
+    std::atomic<unsigned long long> value;
+  };
+  //! a histogram
+  struct Hist {
+    std::atomic<unsigned long long> buckets[kBuckets];  //<! counts per bucket (not cumulative)
+    std::atomic<unsigned long long> count;              //<! observations
+    std::atomic<unsigned long long> sumNs;              //<! sum in nanoseconds
+  };
+
+  Cell _counters[kNCounters][kShards];   //<! counters, sharded
+  std::atomic<double> _gauges[kNGauges]; //<! gauges (NaN until set)
+  Hist _hists[kNHistograms];             //<! histograms
+
+  //! the calling thread's shard, assigned round-robin on first use
+  static unsigned int shard()
+  {
+    static std::atomic<unsigned int> next(0);
+    static thread_local unsigned int s = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return s;
+  }
+};
+
+#endif // RDOMETRICS
@@ -0,0 +1,157 @@
+/** \file RdoMulti.hh
+    \brief Header for concurrent transfers (curl_multi) class
+*/
+#ifndef RDOMULTI
+#define RDOMULTI
+
+#include <map>
+#include <deque>
+#include <chrono>
+#include <functional>
+#include <curl/curl.h>  // cURL library
+
+class RdoAbsObject;
+class RdoRateLimiter;
+template<class T> class RdoFetch;
+
+/** \class RdoMulti
+    \brief Event loop running many downloads at once on one thread.
+
+    Objects added to the loop download concurrently (over libCURL's multi
+    interface, sharing its connections) while run() or perform() is called,
+    to memory or to their output file as set on the object; when an object's
+    data are parsed or written, its completion callback is called with the
+    object and a failure flag. Each object runs at most one transfer at a time on its own cURL
+    session. The coalescer, cache and daemon of an object are not used here.
+    The rate limiter is, but add() never sleeps in it: while the limiter
+    has no tokens, the download waits in the loop (in order with the others
+    behind the same limiter) and starts from a later perform() or
+    timeoutAction() once it has.
+
+    \code
+    RdoMulti multi;
+    RdoIntegers a, b;
+    multi.add(a, [](RdoAbsObject& obj, bool failed){ ... });
+    multi.add(b, [](RdoAbsObject& obj, bool failed){ ... });
+    multi.run();
+    \endcode
+
+    With C++20, RdoAsync.hh adds awaitable fetch() for coroutines.
+
+    In socket mode (setSocketMode) the loop can be driven by the caller's
+    own event loop (epoll, libuv, ...) instead of run(): libCURL reports the
+    sockets to watch and the time-out to arm through callbacks (or sockets()
+    and timeoutMs()), and the caller reports readiness with socketAction()
+    and expired time-outs with timeoutAction(). Callbacks must not call back
+    into the loop.
+
+    \code
+    multi.setSocketMode(
+      [&](curl_socket_t fd, int events){ // update the epoll set
+        if(events & RdoMulti::kRemove) epoll_ctl(ep, EPOLL_CTL_DEL, fd, 0);
+        else ... },
+      [&](long ms){ // arm (or, for -1, disarm) a timer });
+    multi.add(ints, [](RdoIntegers& ints, bool failed){ ... ints.view() ... });
+    // on readiness of fd: multi.socketAction(fd, RdoMulti::kIn);
+    // on timer expiry:    multi.timeoutAction();
+    \endcode
+*/
+class RdoMulti {
+public:
+  //! completion callback
+  typedef std::function<void(RdoAbsObject& obj, bool failed)> Callback;
+  //! completion callback taking the object's own type
+  template<class T> struct Typed { typedef std::function<void(T& obj, bool failed)> Callback; };
+  //! socket mode: watch fd for events (kIn|kOut), or stop watching it (kRemove)
+  typedef std::function<void(curl_socket_t fd, int events)> SocketCallback;
+  //! socket mode: call timeoutAction() in ms milliseconds (-1 for never)
+  typedef std::function<void(long ms)> TimerCallback;
+
+  //! socket events
+  enum Events { kIn = 1, kOut = 2, kError = 4, kRemove = 8 };
+
+  RdoMulti();
+  RdoMulti(const RdoMulti& other);
+  virtual ~RdoMulti();
+
+  // limit the number of open connections (0 for no limit)
+  void setMaxConnections(long n = 0);
+  long maxConnections() const { return _maxConnections; }
+
+  // start a download of obj; true if failed
+  bool add(RdoAbsObject& obj, Callback done = Callback());
+  // same, with a callback taking the object's own type
+  template<class T>
+  bool add(T& obj, typename Typed<T>::Callback done);
+  // number of running and rate-limited downloads
+  unsigned int pending() const { return _transfers.size() + _deferred.size(); }
+
+  // drive the transfers without blocking; returns the number still running
+  unsigned int perform();
+  // wait up to timeoutMs for activity, then perform; returns the number still running
+  unsigned int wait(int timeoutMs = 1000);
+  // run until all transfers are done; true if timed out
+  bool run(int timeoutMs = -1);
+
+  // socket mode, driven by an external event loop
+  bool setSocketMode(SocketCallback onSocket = SocketCallback(), TimerCallback onTimer = TimerCallback());
+  bool socketMode() const { return _socketMode; }
+  // sockets to watch, with their events
+  const std::map<curl_socket_t, int>& sockets() const { return _sockets; }
+  // milliseconds until timeoutAction() is due (-1 for none)
+  long timeoutMs() const;
+  // report events on fd / an expired time-out; return the number still running
+  unsigned int socketAction(curl_socket_t fd, int events);
+  unsigned int timeoutAction();
+
+#if defined(__cpp_impl_coroutine)
+  // awaitable download of obj (see RdoAsync.hh)
+  template<class T> RdoFetch<T> fetch(T& obj);
+#endif
+
+protected:
+  //! a running transfer
+  struct Transfer {
+    RdoAbsObject* obj;    //<! downloading object
+    Callback done;        //<! completion callback
+  };
+  //! a transfer waiting for its rate limiter
+  struct Deferred {
+    RdoAbsObject* obj;        //<! downloading object
+    Callback done;            //<! completion callback
+    RdoRateLimiter* limiter;  //<! limiter it waits for
+    std::chrono::steady_clock::time_point since; //<! time it was added
+  };
+
+  CURLM* _multi;                          //<! libCURL multi session
+  long _maxConnections;                   //<! connection limit
+  std::map<CURL*, Transfer> _transfers;   //<! running transfers by session
+  std::deque<Deferred> _deferred;         //<! transfers waiting for their limiter
+  std::chrono::steady_clock::time_point _retry; //<! next try of the waiting transfers
+
+  bool _socketMode;                       //<! driven by socket actions
+  SocketCallback _onSocket;               //<! socket mode: watch requests
+  TimerCallback _onTimer;                 //<! socket mode: time-out requests
+  std::map<curl_socket_t, int> _sockets;  //<! socket mode: watched sockets and events
+  bool _timerSet;                         //<! socket mode: time-out armed
+  std::chrono::steady_clock::time_point _deadline; //<! socket mode: time-out due
+
+  bool start(RdoAbsObject& obj, Callback done, bool acquired, double waited);
+  void startDeferred();
+  long deferredMs() const;
+  void complete();
+  unsigned int waitSockets(int timeoutMs);
+  static int socketCallback(CURL* cURL, curl_socket_t fd, int what, void* multi, void* socketp);
+  static int timerCallback(CURLM* cURLM, long ms, void* multi);
+};
+
+//_____________________________________________________________________________
+/** Start a download of obj; done gets obj as its own type. */
+template<class T>
+bool RdoMulti::add(T& obj, typename Typed<T>::Callback done)
+{
+  return add(static_cast<RdoAbsObject&>(obj),
+	     Callback([done](RdoAbsObject& o, bool failed){ if(done) done(static_cast<T&>(o), failed); }));
+}
+
+#endif // RDOMULTI
@@ -0,0 +1,59 @@
+/** \file RdoObserver.hh
+    \brief Header for request lifecycle observer interface
+*/
+#ifndef RDOOBSERVER
+#define RDOOBSERVER
+
+#include <stddef.h>   // size_t
+#include <chrono>
+
+class RdoAbsObject;
+
+/** \class RdoObserver
+    \brief Callbacks for the lifecycle of requests and in-memory caches,
+    e.g. to correlate downloads with one's own traces (see
+    RdoAbsObject::setObserver and RdoTraceWriter).
+
+    Every callback gets the object and a steady_clock timestamp taken
+    when the event happened (nanosecond resolution on Linux). In order,
+    a request calls:
+    - requestStart: the request is about to be sent (after the rate limiter);
+    - connected: a connection is ready, new or reused (libcurl >= 7.80);
+    - firstByte, then chunk for every block of data received;
+    - transferEnd: the transfer finished (or failed);
+    - parseComplete: the block was parsed (in memory), with its start;
+    - cacheRefill: the block was added to the object's memory;
+    - requestEnd: the download is done, with its outcome.
+    cacheExhausted is called when rndm() runs past the data in memory.
+
+    The callbacks run on the downloading thread, inside libcurl's for
+    connected, firstByte and chunk; they should be quick and must not
+    start transfers on the same object. The defaults do nothing. An
+    object without an observer pays a null-pointer check per event.
+*/
+class RdoObserver {
+public:
+  typedef std::chrono::steady_clock Clock;
+  typedef Clock::time_point Time;
+
+  RdoObserver() {}
+  RdoObserver(const RdoObserver& /*other*/) {}
+  inline virtual ~RdoObserver() {}
+
+  static Time now() { return Clock::now(); }
+
+  // requests
+  virtual void requestStart(const RdoAbsObject& /*obj*/, Time /*t*/) {}
+  virtual void connected(const RdoAbsObject& /*obj*/, bool /*reused*/, Time /*t*/) {}
+  virtual void firstByte(const RdoAbsObject& /*obj*/, Time /*t*/) {}
+  virtual void chunk(const RdoAbsObject& /*obj*/, size_t /*bytes*/, Time /*t*/) {}
+  virtual void transferEnd(const RdoAbsObject& /*obj*/, Time /*t*/) {}
+  virtual void parseComplete(const RdoAbsObject& /*obj*/, bool /*rejected*/, Time /*start*/, Time /*end*/) {}
+  virtual void requestEnd(const RdoAbsObject& /*obj*/, bool /*failed*/, Time /*t*/) {}
+
+  // in-memory caches
+  virtual void cacheRefill(const RdoAbsObject& /*obj*/, Time /*t*/) {}
+  virtual void cacheExhausted(const RdoAbsObject& /*obj*/, Time /*t*/) {}
+};
+
+#endif // RDOOBSERVER
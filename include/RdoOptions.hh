@@ -27,16 +27,29 @@ public:
   std::string  proxy;        //<! proxy used by cURL
   std::string  proxyType;    //<! type of proxy used by cURL
   unsigned int timeout;      //<! time in seconds to wait for random.org
+  std::string  host;         //<! random.org host (and :port)
+  std::string  socket;       //<! rdo-entropyd socket path (empty for the default)
+  unsigned long pool;        //<! rdo-entropyd pool size in bytes
+  std::string  metrics;      //<! file or unix:socket for Prometheus metrics (empty for none)
+  std::string  trace;        //<! file for a Chrome trace of the requests (empty for none)
 
   std::string  outFile;      //<! name of file to which data is to be written
   bool         append;       //<! append to or overwrite the output file?
 
   std::string  format;       //<! format of downloaded data; plain or html
+  std::string  outFormat;    //<! typed binary output: raw-i32, raw-i64, raw-f64 or npy (empty for text)
   std::string  rnd;          //<! randomization to use to generate the data
   unsigned long columns;      //<! number of columns for file formating
   unsigned long num;          //<! number of random units to download
 
   std::string  type;         //<! type of data to download
+  std::string  input;        //<! input file (jobs of the batch type) or mix (of the bench type)
+
+  bool         stream;       //<! stream binary data until limit or signal
+  unsigned long long limit;  //<! number of bytes to stream (0 for no limit)
+  unsigned int workers;      //<! number of overlapping downloads when streaming
+  unsigned long requests;    //<! number of requests of the bench type
+  std::string  reportFormat; //<! report of the bench type; table or json
 
   bool         quota;        //<! run quota checker (before dowloading other randoms)
   std::string  ip;           //<! IP address for quota-checker
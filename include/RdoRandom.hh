@@ -6,6 +6,7 @@
 
 #include <vector>
 #include "RdoAbsObject.hh"
+#include "RdoCacheView.hh"
 
 /** \class RdoRandom 
     \brief Get random numbers in [0,1] (decimal fractions) from random.org.
@@ -30,11 +31,19 @@ public:
 
   // get a random number from memory
   double rndm();
-
-  // examine the cached numbers
-  std::vector<double> cache() const { return _randData; }
+  // take the next n numbers from memory without copying (fewer at the end)
+  RdoCacheView<double> consume(unsigned int n);
+
+  // examine the cached numbers: view() without copying, std::move(obj).cache() moves them out
+  std::vector<double> cache() const & { return _randData; }
+  std::vector<double> cache() && { std::vector<double> data; data.swap(_randData); _pos = 0; return data; }
+  RdoCacheView<double> view() const { return RdoCacheView<double>(_randData); }
+  unsigned int cacheSize() const { return _randData.size(); }
   unsigned int currentCachePossition() const { return _pos; }
 
+  // random bits a request costs from the quota
+  virtual unsigned long requestBits() const;
+
 protected:
   unsigned int _decimals;  //<! decimals (number of digits)
   unsigned int _columns;   //<! number of columns in which the integers will be arranged
@@ -43,6 +52,9 @@ protected:
 
   virtual void buildUrl();
   virtual void parseMemory(struct RdoAbsObject::CurlMem cMem);
+  virtual bool coalescible() const { return _columns==1; }
+  virtual bool servedByDaemon() const { return true; }
+  virtual bool fetchFromDaemon(RdoDaemon& daemon);
 };
 
 #endif // RDORANDOM
@@ -0,0 +1,92 @@
+/** \file RdoRateLimiter.hh
+    \brief Header for client-side rate limiter class
+*/
+#ifndef RDORATELIMITER
+#define RDORATELIMITER
+
+#include <vector>
+#include <ostream>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+/** \class RdoRateLimiter
+    \brief Token-bucket throttle for requests to random.org, shared by
+    threads and objects (see RdoAbsObject::setRateLimiter).
+
+    Two buckets are checked before every request: one of requests per
+    second and one of random bits per second (RdoAbsObject::requestBits).
+    A bucket holds at most its burst size; a rate of 0 disables it. A
+    request larger than the bit burst waits for a full bucket and leaves
+    it in debt, so the sustained rate still holds.
+
+    Waiting requests queue in arrival order; only the head of the queue
+    sleeps until its tokens are available, the others sleep until it is
+    their turn. Event loops, which must not sleep, use tryAcquire() instead
+    and retry after nextAvailable() seconds; they get tokens only while no
+    acquire() is queued. The time every request waited is kept in a
+    histogram with bins [0,1) ms, [1,2) ms, [2,4) ms, ... doubling up to
+    the last bin, which collects everything longer.
+*/
+class RdoRateLimiter {
+public:
+  RdoRateLimiter(double requestsPerSec = 1., double bitsPerSec = 0.);
+  RdoRateLimiter(const RdoRateLimiter& other);
+  inline virtual ~RdoRateLimiter() {}
+
+  // requests per second, and the largest burst of requests
+  void setRequestRate(double perSec, double burst = 1.);
+  double requestRate() const { return _requests.rate; }
+  double requestBurst() const { return _requests.capacity; }
+  // random bits per second, and the largest burst of bits (0: one second's worth)
+  void setBitRate(double perSec, double burst = 0.);
+  double bitRate() const { return _bits.rate; }
+  double bitBurst() const { return _bits.capacity; }
+
+  // wait for the turn of a request of the given bits; returns seconds waited
+  double acquire(unsigned long bits = 0);
+  // take the tokens of a request only if available now; true if taken
+  bool tryAcquire(unsigned long bits = 0, double waited = 0.);
+  // seconds until the tokens of a request are available (0 for now)
+  double nextAvailable(unsigned long bits = 0) const;
+
+  // wait statistics
+  unsigned long nRequests() const;
+  double totalWait() const;
+  double maxWait() const;
+  std::vector<unsigned long> waitHistogram() const;
+  static double binEdge(unsigned int bin);
+  void printStats(std::ostream& os) const;
+  void resetStats();
+
+  //! number of wait histogram bins
+  static const unsigned int kBins = 20;
+
+protected:
+  typedef std::chrono::steady_clock Clock;
+
+  //! a token bucket
+  struct Bucket {
+    double rate;       //<! tokens per second (0 for unlimited)
+    double capacity;   //<! largest number of tokens
+    double tokens;     //<! current tokens (negative for debt)
+  };
+
+  mutable Bucket _requests;           //<! requests bucket
+  mutable Bucket _bits;               //<! bits bucket
+  mutable Clock::time_point _last;    //<! time of the last refill
+  unsigned long _nextTicket;          //<! ticket of the next arriving request
+  unsigned long _serving;             //<! ticket at the head of the queue
+  unsigned long _nRequests;           //<! requests served
+  double _totalWait;                  //<! seconds waited in total
+  double _maxWait;                    //<! longest wait in seconds
+  std::vector<unsigned long> _hist;   //<! wait histogram
+  mutable std::mutex _mutex;          //<! guards all of the above
+  std::condition_variable _cv;        //<! signals turns and rate changes
+
+  void refill(Clock::time_point now) const;
+  void take(unsigned long bits, double waited);
+  static double deficit(const Bucket& b, double need);
+};
+
+#endif // RDORATELIMITER
@@ -0,0 +1,361 @@
+/** \file RdoRequest.hh
+    \brief Header for compile-time typed request templates
+*/
+#ifndef RDOREQUEST
+#define RDOREQUEST
+
+#include <stddef.h>   // size_t
+#include <stdlib.h>   // strtod (without floating-point std::from_chars)
+#include <math.h>     // floor
+#include <string.h>   // memchr, memcpy, strlen
+#include <charconv>   // std::to_chars, std::from_chars
+#include <string>
+#include <vector>
+#include "RdoAbsObject.hh"
+#include "RdoHealth.hh"
+
+//! kinds of requests to random.org (see RdoRequest)
+enum RdoKind {
+  kRdoIntegers = 0,  //<! /integers/
+  kRdoSequences,     //<! /sequences/
+  kRdoFractions,     //<! /decimal-fractions/
+  kRdoStrings,       //<! /strings/
+  kRdoQuota          //<! /quota/
+};
+
+/** \class RdoUrlBuffer
+    \brief Appends text and numbers to a bounded character buffer without
+    allocating. What does not fit is cut off and flagged by overflow();
+    the buffer is always null-terminated.
+*/
+class RdoUrlBuffer {
+public:
+  RdoUrlBuffer(char* buf, size_t size)
+    : _buf(buf), _size(size), _len(0), _overflow(size==0)
+  { if(size) _buf[0] = '\0'; }
+  RdoUrlBuffer(const RdoUrlBuffer& other)
+    : _buf(other._buf), _size(other._size), _len(other._len), _overflow(other._overflow) {}
+  inline virtual ~RdoUrlBuffer() {}
+
+  //! append n characters of s
+  RdoUrlBuffer& put(const char* s, size_t n)
+  {
+    if(_len + n >= _size){
+      n = (_size > _len) ? _size - _len - 1 : 0;
+      _overflow = true;
+    }
+    memcpy(_buf + _len, s, n);
+    _len += n;
+    if(_size) _buf[_len] = '\0';
+    return *this;
+  }
+  //! append a string
+  RdoUrlBuffer& put(const char* s) { return put(s, strlen(s)); }
+  //! append an integer in base 10
+  template<class T> RdoUrlBuffer& num(T value)
+  {
+    char tmp[24];
+    std::to_chars_result r = std::to_chars(tmp, tmp + sizeof(tmp), value);
+    return put(tmp, r.ptr - tmp);
+  }
+  //! append "on" or "off"
+  RdoUrlBuffer& onOff(bool b) { return b ? put("on", 2) : put("off", 3); }
+
+  const char* str() const { return _buf; }
+  size_t length() const { return _len; }
+  bool overflow() const { return _overflow; }
+
+protected:
+  char* _buf;       //<! the buffer (not owned)
+  size_t _size;     //<! its size, including the terminating null
+  size_t _len;      //<! characters written
+  bool _overflow;   //<! something did not fit
+};
+
+/** \class RdoRequestBase
+    \brief Parts shared by all RdoRequest kinds: the head of the URL, the
+    tokenizer of downloaded blocks and the dispatch from a run-time base to
+    the request type for it.
+*/
+class RdoRequestBase {
+public:
+  //! "scheme://host/path?format=..." of obj
+  static void head(RdoUrlBuffer& u, const RdoAbsObject& obj, const char* path)
+  {
+    u.put(obj.scheme()).put("://").put(obj.rdoUrl()).put(path).put("?format=").put(obj.format());
+  }
+
+  /** Call fn(first, last) for every value of a downloaded block, in place:
+      one value per line (blocks are downloaded in one column), without a
+      trailing '\\r' and null-terminated. Empty values are skipped; stops
+      when fn returns false.
+  */
+  template<class Fn>
+  static void tokens(char* mem, size_t size, Fn fn)
+  {
+    char* p = mem;
+    char* end = mem + size;
+    while(p < end){
+      char* q = (char*)memchr(p, '\n', end - p);
+      if(!q) q = end;
+      char* last = q;
+      if(last > p && last[-1]=='\r') last--;
+      if(last > p){
+	*last = '\0';
+	if(!fn((const char*)p, (const char*)last)) return;
+      }
+      p = q + 1;
+    }
+  }
+
+  /** Call fn(RdoRequest<Kind, base>()) for a base chosen at run time (2, 8,
+      10 or 16, else 10), so one switch per block picks the parser.
+  */
+  template<RdoKind Kind, class Fn>
+  static void withBase(unsigned int base, Fn fn);
+};
+
+/** \class RdoRequest
+    \brief Request to random.org whose endpoint, parameter encoding and
+    value parser are chosen at compile time by the Kind and the number Base
+    (2, 8, 10 or 16). The number of columns only changes the URL, so it is
+    an argument of url(); parsed blocks come in one column. The types are
+    stateless tags: all their members are static.
+
+    url() writes the URL into a bounded buffer (e.g. RdoAbsObject::url(),
+    of RdoAbsObject::kUrlSize characters) without allocating and returns
+    true if it did not fit. parse() converts one value, or fills a vector
+    from a whole downloaded block, with the health tests if given one. The
+    typed classes (RdoIntegers, RdoSequence, RdoRandom, RdoStrings, RdoBytes,
+    RdoQuota) are thin wrappers that pick the instantiation for their
+    settings once per request.
+
+    \code
+    char url[RdoAbsObject::kUrlSize];
+    RdoIntegers ints;
+    RdoRequest<kRdoIntegers, 16>::url(url, sizeof(url), ints, 0, 255);
+    long int val;
+    bool bad = RdoRequest<kRdoIntegers, 16>::parse(first, last, val);
+    \endcode
+*/
+template<RdoKind Kind, unsigned int Base = 10>
+class RdoRequest;
+
+//! /integers/: num values in [min,max], in Base
+template<unsigned int Base>
+class RdoRequest<kRdoIntegers, Base> : public RdoRequestBase {
+  static_assert(Base==2 || Base==8 || Base==10 || Base==16, "RdoRequest: base must be 2, 8, 10 or 16");
+public:
+  static const char* path() { return "/integers/"; }
+
+  //! the URL; true if it did not fit
+  static bool url(char* buf, size_t size, const RdoAbsObject& obj,
+		  long int min, long int max, unsigned int columns = 1)
+  {
+    RdoUrlBuffer u(buf, size);
+    head(u, obj, path());
+    u.put("&rnd=").put(obj.randomization()).put("&num=").num(obj.num()).put("&col=").num(columns)
+      .put("&min=").num(min).put("&max=").num(max).put("&base=").num(Base);
+    return u.overflow();
+  }
+
+  //! parse a value spanning [first,last); true if malformed
+  template<class T>
+  static bool parse(const char* first, const char* last, T& val)
+  {
+    std::from_chars_result r = std::from_chars(first, last, val, (int)Base);
+    return r.ec!=std::errc() || r.ptr!=last;
+  }
+
+  //! append the values of a block to block; with health, check them to be in [min,max]
+  //! and test them once parsed
+  template<class T>
+  static void parse(struct RdoAbsObject::CurlMem cMem, long int min, long int max,
+		    std::vector<T>& block, RdoHealth* health)
+  {
+    size_t start = block.size();
+    tokens(cMem.memory, cMem.size, [&](const char* first, const char* last){
+	T val = 0;
+	bool bad = parse(first, last, val);
+	if(health){
+	  if(bad){ health->fail("parse check"); return false; }
+	  if((long int)val < min || (long int)val > max){ health->fail("range check"); return false; }
+	}
+	block.push_back(val);
+	return true;
+      });
+    if(health && !health->failed())
+      health->fill(block.begin() + start, block.end(), [min](T val){
+	  return (unsigned long long)((long int)val - min);
+	});
+  }
+};
+
+//! /sequences/: a permutation of [min,max]; parsed like integers
+template<unsigned int Base>
+class RdoRequest<kRdoSequences, Base> : public RdoRequest<kRdoIntegers, Base> {
+public:
+  static const char* path() { return "/sequences/"; }
+
+  //! the URL; true if it did not fit
+  static bool url(char* buf, size_t size, const RdoAbsObject& obj,
+		  long int min, long int max, unsigned int columns = 1)
+  {
+    RdoUrlBuffer u(buf, size);
+    RdoRequestBase::head(u, obj, path());
+    u.put("&rnd=").put(obj.randomization()).put("&col=").num(columns)
+      .put("&min=").num(min).put("&max=").num(max);
+    return u.overflow();
+  }
+};
+
+//! /decimal-fractions/: num values in [0,1] with a number of decimals
+template<unsigned int Base>
+class RdoRequest<kRdoFractions, Base> : public RdoRequestBase {
+public:
+  static const char* path() { return "/decimal-fractions/"; }
+
+  //! the URL; true if it did not fit
+  static bool url(char* buf, size_t size, const RdoAbsObject& obj,
+		  unsigned int decimals, unsigned int columns = 1)
+  {
+    RdoUrlBuffer u(buf, size);
+    head(u, obj, path());
+    u.put("&rnd=").put(obj.randomization()).put("&num=").num(obj.num()).put("&col=").num(columns)
+      .put("&dec=").num(decimals);
+    return u.overflow();
+  }
+
+  //! parse a null-terminated value spanning [first,last); true if malformed
+  static bool parse(const char* first, const char* last, double& val)
+  {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    std::from_chars_result r = std::from_chars(first, last, val);
+    return r.ec!=std::errc() || r.ptr!=last;
+#else
+    char* end = 0;
+    val = strtod(first, &end);
+    return end==first || end!=last;
+#endif
+  }
+
+  //! append the values of a block to block; with health, test them once parsed as
+  //! symbols of [0,nSymbols)
+  static void parse(struct RdoAbsObject::CurlMem cMem, double nSymbols,
+		    std::vector<double>& block, RdoHealth* health)
+  {
+    size_t start = block.size();
+    tokens(cMem.memory, cMem.size, [&](const char* first, const char* last){
+	double val = 0.;
+	bool bad = parse(first, last, val);
+	if(health){
+	  if(bad){ health->fail("parse check"); return false; }
+	  if(!(val>=0. && val<=1.)){ health->fail("range check"); return false; }
+	}
+	block.push_back(val);
+	return true;
+      });
+    // val * nSymbols + 0.5 is positive and below 2^63 (nSymbols is at most
+    // 10^18): a signed truncation rounds it, without floor()
+    unsigned long long top = (unsigned long long)nSymbols - 1;
+    if(health && !health->failed())
+      health->fill(block.begin() + start, block.end(), [nSymbols, top](double val){
+	  unsigned long long sym = (unsigned long long)(long long)(val * nSymbols + 0.5);
+	  return (sym < top) ? sym : top;
+	});
+  }
+};
+
+//! /strings/: num strings of a length from the allowed characters
+template<unsigned int Base>
+class RdoRequest<kRdoStrings, Base> : public RdoRequestBase {
+public:
+  static const char* path() { return "/strings/"; }
+
+  //! the URL; true if it did not fit
+  static bool url(char* buf, size_t size, const RdoAbsObject& obj, unsigned int length,
+		  bool digits, bool upper, bool lower, bool unique)
+  {
+    RdoUrlBuffer u(buf, size);
+    head(u, obj, path());
+    u.put("&rnd=").put(obj.randomization()).put("&num=").num(obj.num()).put("&len=").num(length)
+      .put("&digits=").onOff(digits).put("&upperalpha=").onOff(upper)
+      .put("&loweralpha=").onOff(lower).put("&unique=").onOff(unique);
+    return u.overflow();
+  }
+
+  /** Append the strings of a block to block; with health, check their
+      length and characters, symbol[c] being the symbol of character c
+      (-1 if not allowed).
+  */
+  static void parse(struct RdoAbsObject::CurlMem cMem, unsigned int length, const int* symbol,
+		    std::vector<std::string>& block, RdoHealth* health)
+  {
+    // symbols of the characters, tested a chunk at a time
+    unsigned char syms[1024];
+    size_t nSyms = 0;
+    auto test = [&](){
+      health->fill(syms, syms + nSyms, [](unsigned char s){ return (unsigned long long)s; });
+      nSyms = 0;
+    };
+    tokens(cMem.memory, cMem.size, [&](const char* first, const char* last){
+	if(health){
+	  if((size_t)(last - first)!=length){ health->fail("length check"); return false; }
+	  // local copies, as the char stores below could alias the captures
+	  const int* table = symbol;
+	  unsigned char* out = syms + nSyms;
+	  int bad = 0;
+	  for(const char* c=first; c<last; c++){
+	    int s = table[(unsigned char)*c];
+	    bad |= s;
+	    *out++ = (unsigned char)s;
+	    if(out==syms + sizeof(syms)){ nSyms = sizeof(syms); test(); out = syms; }
+	  }
+	  nSyms = out - syms;
+	  if(bad<0){ health->fail("alphabet check"); return false; }
+	}
+	block.push_back(std::string(first, last - first));
+	return true;
+      });
+    if(health && !health->failed()) test();
+  }
+};
+
+//! /quota/: the remaining bits, of an IP address or the caller's
+template<unsigned int Base>
+class RdoRequest<kRdoQuota, Base> : public RdoRequestBase {
+public:
+  static const char* path() { return "/quota/"; }
+
+  //! the URL; true if it did not fit
+  static bool url(char* buf, size_t size, const RdoAbsObject& obj, const char* ip = "")
+  {
+    RdoUrlBuffer u(buf, size);
+    head(u, obj, path());
+    if(ip && ip[0]) u.put("&ip=").put(ip);
+    return u.overflow();
+  }
+
+  //! parse the bits (0 if malformed); true if malformed
+  static bool parse(struct RdoAbsObject::CurlMem cMem, long int& bits)
+  {
+    bits = 0;
+    std::from_chars_result r = std::from_chars(cMem.memory, cMem.memory + cMem.size, bits);
+    if(r.ec!=std::errc()) bits = 0;
+    return r.ec!=std::errc();
+  }
+};
+
+//! the request type for a run-time base
+template<RdoKind Kind, class Fn>
+void RdoRequestBase::withBase(unsigned int base, Fn fn)
+{
+  switch(base){
+  case 2:  fn(RdoRequest<Kind, 2>()); break;
+  case 8:  fn(RdoRequest<Kind, 8>()); break;
+  case 16: fn(RdoRequest<Kind, 16>()); break;
+  default: fn(RdoRequest<Kind, 10>()); break;
+  }
+}
+
+#endif // RDOREQUEST
@@ -17,6 +17,9 @@ public:
 
 protected:
   virtual void buildUrl();
+  virtual unsigned int expectedNum() const { return (unsigned int)(max() - min() + 1); }
+  virtual bool coalescible() const { return false; }
+  virtual bool servedByDaemon() const { return false; }
 };
 
 #endif // RDOSEQUENCE
@@ -0,0 +1,77 @@
+/** \file RdoStatTest.hh
+    \brief Header for statistical tests class
+*/
+#ifndef RDOSTATTEST
+#define RDOSTATTEST
+
+#include <string>
+#include <vector>
+
+/** \struct RdoStatResult
+    \brief Result of a single statistical test.
+*/
+struct RdoStatResult {
+  std::string name;        //<! name of the test
+  double statistic;        //<! test statistic (chi-square, z-score, count, ...)
+  double dof;              //<! degrees of freedom (or expectation, see the test)
+  double pValue;           //<! probability of the statistic under the uniform hypothesis
+  unsigned long long n;    //<! number of samples used
+};
+
+/** \class RdoStatTest
+    \brief Battery of statistical tests for uniformly distributed symbols.
+
+    The data are symbols in [0,nSymbols), e.g. bytes (256 symbols), integers
+    shifted by their minimum (max-min+1 symbols) or decimal fractions scaled by
+    10^decimals. Bytes can be tested in place (e.g. over a memory-mapped file)
+    without copying.
+
+    The battery: frequency, runs, serial, poker, birthday spacings and
+    autocorrelation. runAll() spreads the tests over threads.
+*/
+class RdoStatTest {
+public:
+  RdoStatTest();
+  RdoStatTest(const RdoStatTest& other);
+  inline virtual ~RdoStatTest() {}
+
+  // data
+  void setBytes(const unsigned char* data, unsigned long long n);
+  void setBytes(std::vector<unsigned char>& data);
+  void setSymbols(std::vector<unsigned long long>& data, unsigned long long nSymbols);
+  unsigned long long size() const { return _n; }
+  unsigned long long nSymbols() const { return _nSymbols; }
+
+  // tests
+  RdoStatResult frequency() const;
+  RdoStatResult runs() const;
+  RdoStatResult serial() const;
+  RdoStatResult poker() const;
+  RdoStatResult birthdaySpacings() const;
+  RdoStatResult autocorrelation() const;
+  std::vector<RdoStatResult> runAll(unsigned int nThreads = 1) const;
+
+  // probabilities
+  static double chiSquareProb(double chi2, double dof);
+  static double normalProb(double z);
+  static double poissonProb(unsigned long long k, double mean);
+
+protected:
+  const unsigned char* _b8;                //<! byte symbols (owned or external)
+  std::vector<unsigned char> _v8;          //<! owned byte symbols
+  std::vector<unsigned long long> _v64;    //<! owned wide symbols
+  unsigned long long _n;                   //<! number of symbols
+  unsigned long long _nSymbols;            //<! number of possible symbols
+
+  // symbol i
+  unsigned long long sym(unsigned long long i) const { return _b8 ? _b8[i] : _v64[i]; }
+  // category of a symbol when the symbols are split into k (nearly) equal groups
+  unsigned long long category(unsigned long long s, unsigned long long k) const { return (s * k) / _nSymbols; }
+  // number of symbols in each of k categories
+  std::vector<double> categoryWidths(unsigned long long k) const;
+
+  static double gammaP(double a, double x);
+  static double gammaQ(double a, double x);
+};
+
+#endif // RDOSTATTEST
@@ -6,6 +6,7 @@
 
 #include <vector>
 #include "RdoAbsObject.hh"
+#include "RdoCacheView.hh"
 
 /** \class RdoStrings 
     \brief Get strings from random.org.
@@ -32,11 +33,19 @@ public:
 
   // get a random string from memory
   std::string rndm();
+  // take the next n strings from memory without copying (fewer at the end)
+  RdoCacheView<std::string> consume(unsigned int n);
 
-  // examine the cached strings
-  std::vector<std::string> cache() const { return _randData; }
+  // examine the cached strings: view() without copying, std::move(obj).cache() moves them out
+  std::vector<std::string> cache() const & { return _randData; }
+  std::vector<std::string> cache() && { std::vector<std::string> data; data.swap(_randData); _pos = 0; return data; }
+  RdoCacheView<std::string> view() const { return RdoCacheView<std::string>(_randData); }
+  unsigned int cacheSize() const { return _randData.size(); }
   unsigned int currentCachePossition() const { return _pos; }
 
+  // random bits a request costs from the quota
+  virtual unsigned long requestBits() const;
+
 protected:
   unsigned int _length; //<! length of each string
   bool _digits;         //<! allow digit characters
@@ -48,6 +57,9 @@ protected:
 
   virtual void buildUrl();
   virtual void parseMemory(struct RdoAbsObject::CurlMem cMem);
+  virtual bool coalescible() const { return true; }
+  virtual bool servedByDaemon() const { return !_unique; }
+  virtual bool fetchFromDaemon(RdoDaemon& daemon);
   static std::string boolToCode(bool b);
 };
 
@@ -0,0 +1,75 @@
+/** \file RdoTraceWriter.hh
+    \brief Header for Chrome trace writer class
+*/
+#ifndef RDOTRACEWRITER
+#define RDOTRACEWRITER
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include "RdoObserver.hh"
+
+/** \class RdoTraceWriter
+    \brief Observer recording the events of requests and in-memory caches
+    in the Chrome trace event format, to be viewed in chrome://tracing or
+    Perfetto.
+
+    Every observed object gets its own lane, named after the first URL it
+    requested. Requests and parsing are spans; connections (new or
+    reused), first bytes, chunks, refills and exhausted caches are
+    instants. Timestamps are in microseconds since the writer was made.
+    Thread-safe; events are kept in memory until written or cleared.
+
+    \code
+    RdoTraceWriter trace;
+    RdoIntegers ints;
+    ints.setObserver(&trace);
+    ...
+    trace.write("rdo.trace.json");
+    \endcode
+*/
+class RdoTraceWriter : public RdoObserver {
+public:
+  RdoTraceWriter();
+  RdoTraceWriter(const RdoTraceWriter& other);
+  inline virtual ~RdoTraceWriter() {}
+
+  virtual void requestStart(const RdoAbsObject& obj, Time t);
+  virtual void connected(const RdoAbsObject& obj, bool reused, Time t);
+  virtual void firstByte(const RdoAbsObject& obj, Time t);
+  virtual void chunk(const RdoAbsObject& obj, size_t bytes, Time t);
+  virtual void parseComplete(const RdoAbsObject& obj, bool rejected, Time start, Time end);
+  virtual void requestEnd(const RdoAbsObject& obj, bool failed, Time t);
+  virtual void cacheRefill(const RdoAbsObject& obj, Time t);
+  virtual void cacheExhausted(const RdoAbsObject& obj, Time t);
+
+  std::string json() const;
+  bool write(const char* fileName) const;
+  size_t size() const;
+  void clear();
+
+protected:
+  //! a recorded event
+  struct Event {
+    char ph;              //<! phase: 'X' span, 'i' instant
+    const char* name;     //<! event name (static)
+    unsigned int lane;    //<! lane (tid) of the object
+    double ts;            //<! start in us
+    double dur;           //<! duration in us (spans)
+    std::string args;     //<! JSON object members, may be empty
+  };
+
+  Time _t0;                                       //<! time origin
+  std::vector<Event> _events;                     //<! recorded events
+  std::map<const RdoAbsObject*, unsigned int> _lanes; //<! lane of every object
+  std::vector<std::string> _laneNames;            //<! name of every lane
+  std::map<const RdoAbsObject*, double> _open;    //<! start of open requests (us)
+  mutable std::mutex _mutex;                      //<! guards all of the above
+
+  double us(Time t) const;
+  unsigned int lane(const RdoAbsObject& obj);
+  void instant(const RdoAbsObject& obj, const char* name, Time t, const std::string& args);
+};
+
+#endif // RDOTRACEWRITER
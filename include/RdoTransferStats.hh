@@ -0,0 +1,69 @@
+/** \file RdoTransferStats.hh
+    \brief Header for rolling transfer statistics class
+*/
+#ifndef RDOTRANSFERSTATS
+#define RDOTRANSFERSTATS
+
+#include <vector>
+#include <ostream>
+#include <mutex>
+#include "RdoAbsObject.hh"
+
+/** \class RdoTransferStats
+    \brief Rolling aggregates of RdoAbsObject::TransferStats, e.g. of all
+    transfers made through an RdoClient (see RdoClient::transferStats).
+
+    Counts of transfers, failures, reused connections and bytes are kept
+    since the last reset; the timings of the most recent successful
+    transfers (the window) are kept for means and percentiles, so that
+    they follow the current state of the network and the server. Each
+    phase is aggregated on its own: mean().ttfb is the mean time to the
+    first byte, percentile(95).parse the 95th percentile of parse times.
+    Comparing ttfb and total with parse and wait tells server slowness
+    apart from our own overhead. Thread-safe.
+*/
+class RdoTransferStats {
+public:
+  RdoTransferStats(unsigned int window = 1000);
+  RdoTransferStats(const RdoTransferStats& other);
+  RdoTransferStats& operator=(const RdoTransferStats& other);
+  inline virtual ~RdoTransferStats() {}
+
+  // number of recent transfers kept for means and percentiles
+  void setWindow(unsigned int window = 1000);
+  unsigned int window() const;
+
+  // add a transfer
+  void add(const RdoAbsObject::TransferStats& stats);
+
+  // since the last reset
+  unsigned long nTransfers() const;
+  unsigned long nFailed() const;
+  unsigned long nReused() const;
+  unsigned long long bytes() const;
+  // over the window
+  unsigned int size() const;
+  RdoAbsObject::TransferStats mean() const;
+  RdoAbsObject::TransferStats percentile(double p) const;
+
+  void print(std::ostream& os) const;
+  static void printTransfer(std::ostream& os, const RdoAbsObject::TransferStats& stats);
+  void reset();
+
+protected:
+  unsigned int _window;                              //<! most transfers kept
+  std::vector<RdoAbsObject::TransferStats> _recent;  //<! ring of recent successful transfers
+  unsigned int _next;                                //<! ring position of the next one
+  unsigned long _nTransfers;                         //<! transfers since the reset
+  unsigned long _nFailed;                            //<! failed transfers since the reset
+  unsigned long _nReused;                            //<! transfers over reused connections
+  unsigned long long _bytes;                         //<! bytes since the reset
+  mutable std::mutex _mutex;                         //<! guards all of the above
+
+  static double phase(const RdoAbsObject::TransferStats& stats, unsigned int k);
+  static void setPhase(RdoAbsObject::TransferStats& stats, unsigned int k, double value);
+  //! number of timed phases (wait, dns, connect, tls, ttfb, total, parse)
+  static const unsigned int kPhases = 7;
+};
+
+#endif // RDOTRANSFERSTATS
@@ -0,0 +1,51 @@
+#!/bin/sh
+# loadtest.sh: end-to-end libRdO throughput against the local stand-in.
+# Starts bin/rdo-standin, runs the random-dot-org bench mix over an
+# increasing number of concurrent connections and stops the stand-in.
+# Failed requests (e.g. with -e) are reported by the bench, not fatal.
+#
+# Settings (environment or make variables):
+#   PORT          port of the stand-in                       (18080)
+#   WORKERS       concurrent connections to try              (1 4 16 64)
+#   REQUESTS      requests per run                           (1000)
+#   MIX           bench mix, type[:number],...               (bench default)
+#   STANDIN_ARGS  rdo-standin options, e.g. "-L 50 -e 0.01"  (none)
+#   OUTDIR        write bench-w<workers>.json there          (print tables)
+
+PORT=${PORT:-18080}
+WORKERS=${WORKERS:-"1 4 16 64"}
+REQUESTS=${REQUESTS:-1000}
+here=$(cd "$(dirname "$0")/.." && pwd)
+export LD_LIBRARY_PATH="$here/lib${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}"
+
+if [ ! -x "$here/bin/rdo-standin" ] || [ ! -x "$here/bin/random-dot-org" ]; then
+    echo "loadtest: build first (make)" >&2
+    exit 1
+fi
+
+"$here/bin/rdo-standin" -p "$PORT" $STANDIN_ARGS &
+standin=$!
+trap 'kill $standin 2>/dev/null; wait $standin 2>/dev/null' EXIT INT TERM
+# wait for the stand-in to listen
+tries=0
+until "$here/bin/random-dot-org" -X -H "localhost:$PORT" -n 1 integers >/dev/null 2>&1; do
+    tries=$((tries+1))
+    if [ $tries -ge 50 ]; then
+	echo "loadtest: rdo-standin did not start on port $PORT" >&2
+	exit 1
+    fi
+    sleep 0.1
+done
+
+for w in $WORKERS; do
+    if [ -n "$OUTDIR" ]; then
+	mkdir -p "$OUTDIR"
+	"$here/bin/random-dot-org" bench $MIX -X -H "localhost:$PORT" -W "$w" -R "$REQUESTS" \
+	    -F json -o "$OUTDIR/bench-w$w.json" 2>/dev/null
+	echo "workers $w: $OUTDIR/bench-w$w.json"
+    else
+	echo "=== workers $w"
+	"$here/bin/random-dot-org" bench $MIX -X -H "localhost:$PORT" -W "$w" -R "$REQUESTS" 2>/dev/null
+    fi
+done
+exit 0
@@ -0,0 +1,38 @@
+#!/bin/sh
+# rpccheck.sh: the JSON-RPC client (RdoJsonRpc) against the local stand-in.
+# Starts bin/rdo-standin, runs example-api-jsonrpc (generateIntegers,
+# generateBlobs and a batch of all four calls) and stops the stand-in;
+# fails if any call fails or returns data out of range.
+#
+# Settings (environment or make variables):
+#   PORT          port of the stand-in                       (18081)
+#   STANDIN_ARGS  rdo-standin options, e.g. "-L 50"           (none)
+
+PORT=${PORT:-18081}
+here=$(cd "$(dirname "$0")/.." && pwd)
+export LD_LIBRARY_PATH="$here/lib${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}"
+
+if [ ! -x "$here/bin/rdo-standin" ] || [ ! -x "$here/bin/example-api-jsonrpc" ]; then
+    echo "rpccheck: build first (make)" >&2
+    exit 1
+fi
+
+"$here/bin/rdo-standin" -p "$PORT" $STANDIN_ARGS 2>/dev/null &
+standin=$!
+trap 'kill $standin 2>/dev/null; wait $standin 2>/dev/null' EXIT INT TERM
+# wait for the stand-in to listen
+tries=0
+until "$here/bin/random-dot-org" -X -H "localhost:$PORT" -n 1 integers >/dev/null 2>&1; do
+    tries=$((tries+1))
+    if [ $tries -ge 50 ]; then
+	echo "rpccheck: rdo-standin did not start on port $PORT" >&2
+	exit 1
+    fi
+    sleep 0.1
+done
+
+if ! "$here/bin/example-api-jsonrpc" -X -H "localhost:$PORT" -n 100 -l 1 -u 1000; then
+    echo "rpccheck: failed" >&2
+    exit 1
+fi
+exit 0
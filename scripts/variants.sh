@@ -0,0 +1,46 @@
+#!/bin/sh
+# variants.sh: speedup of the build variants on the microbenchmarks.
+# Builds libRdO shared (the reference), static, static with LTO and
+# static with LTO and PGO in turn, runs rdo-bench on each and compares
+# every variant with the shared build through rdo-benchcmp. Variables
+# given to make (CXX, BENCHARGS, ...) are passed on; the tree is left
+# with the last variant built.
+#
+# Settings (environment or make variables):
+#   REPEAT     samples per benchmark           (5)
+#   BENCHARGS  more rdo-bench options/filters  (none)
+
+REPEAT=${REPEAT:-5}
+here=$(cd "$(dirname "$0")/.." && pwd)
+results="$here/out/variants"
+export LD_LIBRARY_PATH="$here/lib${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}"
+cd "$here" || exit 1
+
+# name and make arguments of every variant
+run() {
+    name=$1
+    shift
+    echo "*** Variant $name"
+    if [ "$1" = "pgo" ]; then
+	shift
+	make --no-print-directory pgo "$@" >/dev/null || exit 1
+	make --no-print-directory USE_PGO=1 "$@" bin/rdo-bench bin/rdo-benchcmp >/dev/null || exit 1
+    else
+	make --no-print-directory clean >/dev/null
+	make --no-print-directory "$@" all bin/rdo-bench >/dev/null || exit 1
+    fi
+    mkdir -p "$results"
+    bin/rdo-bench -r "$REPEAT" -f json -o "$results/$name.json" $BENCHARGS || exit 1
+}
+
+run shared
+run static USE_STATIC=1
+run static-lto USE_STATIC=1 USE_LTO=1
+run static-lto-pgo pgo USE_STATIC=1 USE_LTO=1
+
+for name in static static-lto static-lto-pgo; do
+    echo
+    echo "=== $name vs shared"
+    bin/rdo-benchcmp -t 0 "$results/shared.json" "$results/$name.json"
+done
+exit 0
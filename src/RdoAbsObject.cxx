@@ -20,49 +20,130 @@
 #include <stdlib.h> // general utilities
 #include <iostream> // for cout, cerr, clog
 #include <string.h> // for string utils like memcpy, &c.
+#include <math.h>   // ceil, log2
+#include <mutex>    // std::call_once
+#include <chrono>   // parse time
 #include "RdoAbsObject.hh"
+#include "RdoCoalescer.hh"
+#include "RdoCache.hh"
+#include "RdoDaemon.hh"
+#include "RdoClient.hh"
+#include "RdoRateLimiter.hh"
+#include "RdoMetrics.hh"
+#include "RdoObserver.hh"
 
 //_____________________________________________________________________________
 /** Default constructor. */
 RdoAbsObject::RdoAbsObject()
   : _scheme("https"), _rdoUrl("www.random.org"), _format("plain"), _rnd("new"),
-    _num(10), _url(0),
-    _cURL(0), _agent("libcurl-agent"), _proxy(""), _proxyType(""),
-    _inMemory(false), _outFileName(""), _append(false)
+    _num(10), _url(0), _postData(""),
+    _cURL(0), _headers(0), _agent("libcurl-agent"), _proxy(""), _proxyType(""),
+    _timeOut(120),
+    _inMemory(false), _outFileName(""), _append(false), _outString(0),
+    _healthTests(true), _rejectedBlocks(0), _blockRejected(false),
+    _coalescer(0), _cache(0), _daemon(0), _client(0), _limiter(0), _metrics(0), _draws(0),
+    _observer(0), _sinkHandle(0), _sinkFn(0), _sinkData(0), _sinkFirst(false)
 {
+  _transferMem.memory = 0;
+  _transferMem.size = 0;
+  _transferFile = 0;
+  memset(&_lastStats, 0, sizeof(_lastStats));
+  _statsOpen = false;
+
   // init the cURL session
-  curl_global_init(CURL_GLOBAL_ALL);
+  initCURL();
   _cURL = curl_easy_init();
 
   // allocate url memory
-  _url = new char[512];
-
-  // some default settings
-  setTimeOut();
+  _url = new char[kUrlSize];
+  _url[0] = '\0';
 }
 
 //_____________________________________________________________________________
 /** Copy constructor. */
 RdoAbsObject::RdoAbsObject(const RdoAbsObject& other)
   : _scheme(other._scheme), _rdoUrl(other._rdoUrl), _format(other._format),
-    _rnd(other._rnd), _num(other._num), _url(0),
-    _cURL(other._cURL), _agent(other._agent),
-    _proxy(other._proxy), _proxyType(other._proxyType),
+    _rnd(other._rnd), _num(other._num), _url(0), _postData(other._postData),
+    _cURL(0), _headers(0), _agent(other._agent),
+    _proxy(other._proxy), _proxyType(other._proxyType), _timeOut(other._timeOut),
     _inMemory(other._inMemory), _outFileName(other._outFileName),
-    _append(other._append)
+    _append(other._append), _outString(other._outString),
+    _healthTests(other._healthTests), _rejectedBlocks(other._rejectedBlocks),
+    _blockRejected(false),
+    _coalescer(other._coalescer), _cache(other._cache), _daemon(other._daemon),
+    _client(other._client), _limiter(other._limiter), _metrics(other._metrics), _draws(0),
+    _observer(other._observer), _sinkHandle(0), _sinkFn(0), _sinkData(0), _sinkFirst(false)
 {
-  sprintf(_url,"%s",other._url);
+  _transferMem.memory = 0;
+  _transferMem.size = 0;
+  _transferFile = 0;
+  memset(&_lastStats, 0, sizeof(_lastStats));
+  _statsOpen = false;
+
+  // own cURL session; options are applied at transfer time
+  initCURL();
+  _cURL = curl_easy_init();
+
+  // own url memory
+  _url = new char[kUrlSize];
+  strcpy(_url, other._url);
+}
+
+//_____________________________________________________________________________
+/** Assignment; copies the settings, keeps the own cURL session. */
+RdoAbsObject& RdoAbsObject::operator=(const RdoAbsObject& other)
+{
+  if(this==&other) return *this;
+  _scheme = other._scheme;
+  _rdoUrl = other._rdoUrl;
+  _format = other._format;
+  _rnd = other._rnd;
+  _num = other._num;
+  strcpy(_url, other._url);
+  _postData = other._postData;
+  _agent = other._agent;
+  _proxy = other._proxy;
+  _proxyType = other._proxyType;
+  _timeOut = other._timeOut;
+  _inMemory = other._inMemory;
+  _outFileName = other._outFileName;
+  _append = other._append;
+  _outString = other._outString;
+  _healthTests = other._healthTests;
+  _rejectedBlocks = other._rejectedBlocks;
+  _blockRejected = false;
+  _coalescer = other._coalescer;
+  _cache = other._cache;
+  _daemon = other._daemon;
+  _client = other._client;
+  _limiter = other._limiter;
+  flushDraws();
+  _metrics = other._metrics;
+  _observer = other._observer;
+  return *this;
 }
 
 //_____________________________________________________________________________
 /** Destructor. */
 RdoAbsObject::~RdoAbsObject()
 {
+  flushDraws();
   // free url memory
   if(_url) delete [] _url;  
-  // clean up CURL
+  // free POST headers and unfinished transfer data
+  if(_headers) curl_slist_free_all(_headers);
+  if(_transferMem.memory) free(_transferMem.memory);
+  if(_transferFile && _transferFile!=stdout) fclose(_transferFile);
+  // clean up CURL; the global state lives until the program exits
   curl_easy_cleanup(_cURL);
-  curl_global_cleanup();
+}
+
+//_____________________________________________________________________________
+/** Initialize libCURL once per process; curl_global_init is not thread-safe. */
+void RdoAbsObject::initCURL()
+{
+  static std::once_flag once;
+  std::call_once(once, [](){ curl_global_init(CURL_GLOBAL_ALL); });
 }
 
 //_____________________________________________________________________________
@@ -72,7 +153,6 @@ RdoAbsObject::~RdoAbsObject()
 void RdoAbsObject::setAgent(const char* agent)
 {
   _agent = std::string(agent);
-  curl_easy_setopt(_cURL, CURLOPT_USERAGENT, _agent.c_str());  
 }
 
 //_____________________________________________________________________________
@@ -83,7 +163,6 @@ void RdoAbsObject::setProxy(const char* proxy)
 {
   if(proxy && strlen(proxy)!=0){
     _proxy = std::string(proxy);
-    curl_easy_setopt(_cURL, CURLOPT_PROXY, _proxy.c_str());    
   }
 }
  
@@ -93,23 +172,12 @@ void RdoAbsObject::setProxyType(const char* proxyType)
 {
   if(proxyType && strlen(proxyType)!=0){
     std::string spt(proxyType);
-    if(spt=="HTTP"){
-      _proxyType = spt;
-      curl_easy_setopt(_cURL, CURLOPT_PROXYTYPE, CURLPROXY_HTTP);     
-    } else if(spt=="SOCKS4") {
+    if(spt=="HTTP" || spt=="SOCKS4" || spt=="SOCKS4a" || spt=="SOCKS5"){
       _proxyType = spt;
-      curl_easy_setopt(_cURL, CURLOPT_PROXYTYPE, CURLPROXY_SOCKS4); 
-    } else if(spt=="SOCKS4a") {
-      _proxyType = spt;
-      curl_easy_setopt(_cURL, CURLOPT_PROXYTYPE, CURLPROXY_SOCKS4A); 
-    } else if(spt=="SOCKS5") {
-      _proxyType = spt;    
-      curl_easy_setopt(_cURL, CURLOPT_PROXYTYPE, CURLPROXY_SOCKS5); 
     } else{
       std::cerr << "Error: RdoAbsObject::setProxyType: Unkown proxy type " << proxyType 
 		<< ", using HTTP" << std::endl;
       _proxyType = "HTTP";
-      curl_easy_setopt(_cURL, CURLOPT_PROXYTYPE, CURLPROXY_HTTP); 
     }
   }
 }
@@ -119,7 +187,48 @@ void RdoAbsObject::setProxyType(const char* proxyType)
 void RdoAbsObject::setTimeOut(unsigned int seconds)
 {
   if(seconds>0)
-    curl_easy_setopt(_cURL, CURLOPT_TIMEOUT, seconds);  
+    _timeOut = seconds;
+}
+
+//_____________________________________________________________________________
+/** Apply the connection options to a cURL session before a transfer. */
+void RdoAbsObject::applyOptions(CURL* cURL)
+{
+  curl_easy_setopt(cURL, CURLOPT_USERAGENT, _agent.c_str());
+  curl_easy_setopt(cURL, CURLOPT_PROXY, _proxy!="" ? _proxy.c_str() : (const char*)0);
+  long type = CURLPROXY_HTTP;
+  if(_proxyType=="SOCKS4") type = CURLPROXY_SOCKS4;
+  else if(_proxyType=="SOCKS4a") type = CURLPROXY_SOCKS4A;
+  else if(_proxyType=="SOCKS5") type = CURLPROXY_SOCKS5;
+  curl_easy_setopt(cURL, CURLOPT_PROXYTYPE, type);
+  curl_easy_setopt(cURL, CURLOPT_TIMEOUT, (long)_timeOut);
+}
+
+//_____________________________________________________________________________
+/** Download through a (thread-safe) client, with one cURL session per thread.
+    The client is not owned; pass 0 to use the object's own session again.
+*/
+void RdoAbsObject::setClient(RdoClient* client)
+{
+  _client = client;
+}
+
+//_____________________________________________________________________________
+/** The cURL session for the next transfer: the client's session of the 
+    calling thread, or the object's own session.
+*/
+CURL* RdoAbsObject::handle()
+{
+  return _client ? _client->handle() : _cURL;
+}
+
+//_____________________________________________________________________________
+/** Set the host (and optional :port) of the service, e.g. api.random.org 
+    or a local stand-in such as 127.0.0.1:8080.
+*/
+void RdoAbsObject::setRdoUrl(const char* rdoUrl)
+{
+  _rdoUrl = std::string(rdoUrl);
 }
 
 //_____________________________________________________________________________
@@ -187,15 +296,39 @@ void RdoAbsObject::setNum(unsigned int num)
 //_____________________________________________________________________________
 /** Set the url to use when downloading. 
     If no parameter is given, the derived buildUrl method is called.
+    If buildUrl also set a POST body (e.g. JSON-RPC), the request is a POST.
 */
 void RdoAbsObject::setUrl(const char* u)
 {
-  if(u && strlen(u)!=0) 
-    sprintf(_url,"%s",u);
+  if(u && strlen(u)!=0){
+    if(strlen(u) >= kUrlSize)
+      std::cerr << "Error: RdoAbsObject::setUrl: Url longer than " << kUrlSize - 1
+		<< " characters, truncated" << std::endl;
+    snprintf(_url, kUrlSize, "%s", u);
+  }
   else 
     buildUrl();
 
-  curl_easy_setopt(_cURL, CURLOPT_URL, _url);
+  prepareUrl(handle());
+}
+
+//_____________________________________________________________________________
+/** Apply the options and the url (and POST body) to a cURL session. */
+void RdoAbsObject::prepareUrl(CURL* cURL)
+{
+  applyOptions(cURL);
+  curl_easy_setopt(cURL, CURLOPT_URL, _url);
+
+  if(_postData!=""){
+    if(!_headers) _headers = curl_slist_append(_headers, "Content-Type: application/json");
+    curl_easy_setopt(cURL, CURLOPT_HTTPHEADER, _headers);
+    curl_easy_setopt(cURL, CURLOPT_POSTFIELDSIZE, (long)_postData.size());
+    curl_easy_setopt(cURL, CURLOPT_POSTFIELDS, _postData.c_str());
+  }
+  else{
+    curl_easy_setopt(cURL, CURLOPT_HTTPHEADER, (struct curl_slist*)0);
+    curl_easy_setopt(cURL, CURLOPT_HTTPGET, 1L);
+  }
 }
 
 //_____________________________________________________________________________
@@ -204,10 +337,15 @@ void RdoAbsObject::setUrl(const char* u)
 */
 bool RdoAbsObject::downloadToStdOut()
 {
+  // default (fwrite) callback to std::cout
+  CURL* cURL = handle();
+  setSink(cURL, 0, stdout);
   // set the libCURL url to download
   setUrl();
   // get it!
-  CURLcode res = curl_easy_perform(_cURL);
+  throttle();
+  CURLcode res = curl_easy_perform(cURL);
+  recordTransfer(cURL);
   // perform checks
   if(checkCURLcode(res)) return true;
   else return false;
@@ -244,25 +382,57 @@ bool RdoAbsObject::downloadToFile()
     return true;
   }
 
-  // pass file pointer to the callback function
-  curl_easy_setopt(_cURL, CURLOPT_WRITEDATA, fp);
+  // pass file pointer to the default (fwrite) callback function
+  CURL* cURL = handle();
+  setSink(cURL, 0, fp);
 
   // set the libCURL url to download
   setUrl();
 
   // get it!
-  CURLcode res = curl_easy_perform(_cURL);
+  throttle();
+  CURLcode res = curl_easy_perform(cURL);
+  recordTransfer(cURL);
 
   // close file
   fclose(fp);
 
   // perform checks
   if(checkCURLcode(res)) return true;
-  else if(checkHTTPcode()) return true;
+  else if(checkHTTPcode(cURL)) return true;
   //else if(checkBytesDnld()) return true;
   else return false;
 }
 
+//_____________________________________________________________________________
+/** Append the downloaded data, unparsed, to a string (not owned) instead of
+    writing them to a file or std::cout; pass 0 to write them again. 
+    Ignored if the data are kept in memory.
+*/
+void RdoAbsObject::setOutString(std::string* out)
+{
+  _outString = out;
+}
+
+//_____________________________________________________________________________
+/** Download the random data from random.org and append them to the
+    out-string. 
+    \return true if operation failed
+*/
+bool RdoAbsObject::downloadToString()
+{
+  if(!_outString){
+    std::cerr << "Error: RdoAbsObject::downloadToString: No out-string set" << std::endl;
+    return true;
+  }
+  struct CurlMem cMem;
+  bool failed = fetchMemory(&cMem);
+  if(!failed) failed = checkHTTPcode(handle());
+  if(!failed) _outString->append(cMem.memory, cMem.size);
+  if(cMem.memory) free(cMem.memory);
+  return failed;
+}
+
 //_____________________________________________________________________________
 /** Set flag to keep data in memory; don't write to file or std::cout. */
 void RdoAbsObject::setInMemory(bool inMem)
@@ -276,48 +446,408 @@ void RdoAbsObject::setInMemory(bool inMem)
 */
 bool RdoAbsObject::downloadToMemory()
 {
-  // initialize downloaded memory struct
+  // served by the local daemon?
+  if(_daemon && _rnd=="new" && servedByDaemon()){
+    bool failed = fetchFromDaemon(*_daemon);
+    if(_metrics && !failed){
+      _metrics->add(RdoMetrics::kDaemonFetches);
+      _metrics->add(RdoMetrics::kRefills);
+    }
+    if(_observer && !failed) _observer->cacheRefill(*this, RdoObserver::now());
+    return failed;
+  }
+  // merge with concurrent requests for the same data?
+  if(_coalescer && coalescible()) return _coalescer->download(*this);
+
+  // download and parse
   struct CurlMem cMem;
-  cMem.memory = (char*)malloc(1); // will be grown as needed by the WriteMemoryCallback method
-  cMem.size   = 0;                // no data at this point
+  bool failed = fetchMemory(&cMem);
+  if(!failed) failed = parseBlock(cMem);
+
+  // free downloaded memory
+  if(cMem.memory){
+    free(cMem.memory);
+    cMem.size = 0;
+  } 
+
+  return failed;  
+}
+
+//_____________________________________________________________________________
+/** Download the random data from random.org into cMem, without parsing it. 
+    cMem->memory is allocated with malloc and must be freed by the caller.
+    \return true if operation failed
+*/
+bool RdoAbsObject::fetchMemory(struct CurlMem* cMem)
+{
+  // initialize downloaded memory struct
+  cMem->memory = (char*)malloc(1); // will be grown as needed by the WriteMemoryCallback method
+  cMem->size   = 0;                // no data at this point
 
   // send all data to writeMemoryCallback function
-  curl_easy_setopt(_cURL, CURLOPT_WRITEFUNCTION, writeMemoryCallback);
+  CURL* cURL = handle();
   // we pass our 'CurlMem' struct to the callback function
-  curl_easy_setopt(_cURL, CURLOPT_WRITEDATA, (void*)&cMem);
+  setSink(cURL, writeMemoryCallback, (void*)cMem);
 
   // set the libCURL url to download
   setUrl();
 
   // get it!
-  CURLcode res = curl_easy_perform(_cURL);
-  // printf("%lu bytes retrieved\n", (long)cMem.size);
+  throttle();
+  CURLcode res = curl_easy_perform(cURL);
+  recordTransfer(cURL);
+  // printf("%lu bytes retrieved\n", (long)cMem->size);
 
   // perform checks
   if(checkCURLcode(res)) return true;
-  else if((long)cMem.size <= 0) return true;
+  else if((long)cMem->size <= 0) return true;
+  else return false;
+}
+
+//_____________________________________________________________________________
+/** Prepare a transfer on the object's own cURL session, to be driven by an
+    event loop (see RdoMulti) and finished with endTransfer(). The data go
+    to memory, the out-string, the output file or std::cout, as for 
+    downloadData(); the
+    coalescer, cache and daemon are not used on this path. If acquired, the
+    caller already took the rate limiter's tokens, after waiting seconds.
+    \return the session, or 0 if a transfer is already running or the
+    output file cannot be opened
+*/
+CURL* RdoAbsObject::beginTransfer(bool acquired, double waited)
+{
+  if(_transferMem.memory || _transferFile){
+    std::cerr << "Error: RdoAbsObject::beginTransfer: Transfer already running" << std::endl;
+    return 0;
+  }
+  if(_inMemory || _outString){
+    _transferMem.memory = (char*)malloc(1);
+    _transferMem.size = 0;
+    setSink(_cURL, writeMemoryCallback, (void*)&_transferMem);
+  }
   else{
-    // write to internal memory
-    parseMemory(cMem);
+    FILE* fp = stdout;
+    if(_outFileName!=""){
+      fp = fopen(_outFileName.c_str(), _append ? "a" : "w");
+      if(fp == NULL){
+	std::cerr << "Error: Failed to open file " << _outFileName.c_str() << std::endl;
+	return 0;
+      }
+    }
+    _transferFile = fp;
+    setSink(_cURL, 0, fp);
   }
+  buildUrl();
+  prepareUrl(_cURL);
+  throttle(acquired, waited);
+  return _cURL;
+}
 
-  // free downloaded memory
-  if(cMem.memory){
-    delete [] cMem.memory;
-    cMem.size = 0;
-  } 
+//_____________________________________________________________________________
+/** Finish a transfer started with beginTransfer(): check the data and, in
+    memory, parse them (or append them to the out-string).
+    \return true if operation failed
+*/
+bool RdoAbsObject::endTransfer(CURLcode res)
+{
+  recordTransfer(_cURL);
+
+  // to a file or std::cout
+  if(_transferFile){
+    FILE* fp = _transferFile;
+    _transferFile = 0;
+    if(fp!=stdout) fclose(fp);
+    else fflush(fp);
+    bool failed = checkCURLcode(res) || checkHTTPcode(_cURL);
+    finishStats(failed);
+    return failed;
+  }
+
+  // to memory
+  struct CurlMem cMem = _transferMem;
+  _transferMem.memory = 0;
+  _transferMem.size = 0;
+
+  bool failed = checkCURLcode(res) || (long)cMem.size <= 0;
+  if(!failed && !_inMemory){
+    // raw, to the out-string
+    failed = checkHTTPcode(_cURL);
+    if(!failed) _outString->append(cMem.memory, cMem.size);
+  }
+  else if(!failed) failed = parseBlock(cMem);
+  if(cMem.memory) free(cMem.memory);
+  finishStats(failed);
+  return failed;
+}
+
+//_____________________________________________________________________________
+/** Parse a downloaded block into internal memory. 
+    \return true if the block was rejected
+*/
+bool RdoAbsObject::parseBlock(struct CurlMem cMem)
+{
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  _blockRejected = false;
+  parseMemory(cMem);
+  std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+  if(_statsOpen) _lastStats.parse = std::chrono::duration<double>(t1 - t0).count();
+  if(_metrics) _metrics->add(_blockRejected ? RdoMetrics::kRejected : RdoMetrics::kRefills);
+  if(_observer){
+    _observer->parseComplete(*this, _blockRejected, t0, t1);
+    if(!_blockRejected) _observer->cacheRefill(*this, t1);
+  }
+  return _blockRejected;
+}
+
+//_____________________________________________________________________________
+/** Merge in-memory downloads with concurrent requests for the same data 
+    (same url apart from num) from other objects sharing the coalescer. 
+    The coalescer is not owned; pass 0 to download on our own again.
+*/
+void RdoAbsObject::setCoalescer(RdoCoalescer* coalescer)
+{
+  _coalescer = coalescer;
+}
+
+//_____________________________________________________________________________
+/** Throttle the requests to random.org (also those made for other objects
+    sharing a coalescer) with a rate limiter shared with other objects and 
+    threads. The limiter is not owned; pass 0 to disable.
+*/
+void RdoAbsObject::setRateLimiter(RdoRateLimiter* limiter)
+{
+  _limiter = limiter;
+}
+
+//_____________________________________________________________________________
+/** Count transfers, bytes, timings, refills and draws in a metrics registry
+    shared with other objects and threads. The registry is not owned; pass
+    0 to stop counting.
+*/
+void RdoAbsObject::setMetrics(RdoMetrics* metrics)
+{
+  flushDraws();
+  _metrics = metrics;
+}
+
+//_____________________________________________________________________________
+/** Add the draws counted by countDraw() to the registry. */
+void RdoAbsObject::flushDraws()
+{
+  if(_metrics && _draws) _metrics->add(RdoMetrics::kRndm, _draws);
+  _draws = 0;
+}
+
+//_____________________________________________________________________________
+/** Report the requests and in-memory cache events of this object to an
+    observer shared with other objects and threads. The observer is not
+    owned; pass 0 to stop reporting.
+*/
+void RdoAbsObject::setObserver(RdoObserver* observer)
+{
+  _observer = observer;
+}
+
+//_____________________________________________________________________________
+/** Wait for the rate limiter, if any, before a request, unless the caller
+    already acquired its tokens after waiting seconds, then tell the
+    observer that the request starts.
+*/
+void RdoAbsObject::throttle(bool acquired, double waited)
+{
+  if(acquired) _lastStats.wait = waited;
+  else _lastStats.wait = _limiter ? _limiter->acquire(requestBits()) : 0.;
+  if(_observer) _observer->requestStart(*this, RdoObserver::now());
+}
 
-  // return failed
-  return false;  
+//_____________________________________________________________________________
+/** Take the timing and size of the transfer just performed on cURL from
+    libcurl into the last transfer stats; the parse time and the outcome
+    follow with parseBlock() and finishStats().
+*/
+void RdoAbsObject::recordTransfer(CURL* cURL)
+{
+  curl_off_t dns = 0, connect = 0, tls = 0, ttfb = 0, total = 0, bytes = 0;
+  long connects = 0;
+  curl_easy_getinfo(cURL, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+  curl_easy_getinfo(cURL, CURLINFO_CONNECT_TIME_T, &connect);
+  curl_easy_getinfo(cURL, CURLINFO_APPCONNECT_TIME_T, &tls);
+  curl_easy_getinfo(cURL, CURLINFO_STARTTRANSFER_TIME_T, &ttfb);
+  curl_easy_getinfo(cURL, CURLINFO_TOTAL_TIME_T, &total);
+  curl_easy_getinfo(cURL, CURLINFO_SIZE_DOWNLOAD_T, &bytes);
+  curl_easy_getinfo(cURL, CURLINFO_NUM_CONNECTS, &connects);
+
+  // libcurl times are cumulative, in microseconds
+  _lastStats.dns = dns * 1e-6;
+  _lastStats.connect = (connect > dns) ? (connect - dns) * 1e-6 : 0.;
+  _lastStats.tls = (tls > connect) ? (tls - connect) * 1e-6 : 0.;
+  _lastStats.ttfb = ttfb * 1e-6;
+  _lastStats.total = total * 1e-6;
+  _lastStats.parse = 0.;
+  _lastStats.bytes = (bytes > 0) ? (unsigned long)bytes : 0;
+  _lastStats.reused = (connects == 0);
+  _lastStats.failed = false;
+  _statsOpen = true;
+  if(_observer) _observer->transferEnd(*this, RdoObserver::now());
+}
+
+//_____________________________________________________________________________
+/** Close the last transfer stats with the outcome of the download and add
+    them to the client's aggregates, if any.
+*/
+void RdoAbsObject::finishStats(bool failed)
+{
+  if(!_statsOpen) return;
+  _statsOpen = false;
+  _lastStats.failed = failed;
+  if(_client) _client->transferStats().add(_lastStats);
+  if(_observer) _observer->requestEnd(*this, failed, RdoObserver::now());
+  if(_metrics){
+    _metrics->add(RdoMetrics::kRequests);
+    if(failed) _metrics->add(RdoMetrics::kFailures);
+    _metrics->add(RdoMetrics::kBytes, _lastStats.bytes);
+    _metrics->observe(RdoMetrics::kDownloadSeconds, _lastStats.total);
+    _metrics->observe(RdoMetrics::kFirstByteSeconds, _lastStats.ttfb);
+    if(!failed && _lastStats.parse > 0.) _metrics->observe(RdoMetrics::kParseSeconds, _lastStats.parse);
+  }
+}
+
+//_____________________________________________________________________________
+/** Random bits needed for one of nValues equally likely values. */
+unsigned int RdoAbsObject::bitsPerValue(double nValues)
+{
+  if(nValues <= 1.) return 0;
+  return (unsigned int)ceil(log2(nValues) - 1e-9);
 }
 
 //_____________________________________________________________________________
-/** Genericc download data. */
+/** Genericc download data. The timing and size of the transfer, if one
+    was made, are kept in lastTransferStats() and added to the client's
+    aggregates.
+*/
 bool RdoAbsObject::downloadData()
 {
-  if(_inMemory) return downloadToMemory();
-  else if(_outFileName!="") return downloadToFile();
-  else return downloadToStdOut();
+  _statsOpen = false;
+  bool failed = false;
+  if(cached()) failed = downloadCached();
+  else if(_inMemory) failed = downloadToMemory();
+  else if(_outString) failed = downloadToString();
+  else if(_outFileName!="") failed = downloadToFile();
+  else failed = downloadToStdOut();
+  finishStats(failed);
+  return failed;
+}
+
+//_____________________________________________________________________________
+/** Get fresh (randomization "new") in-memory data from a local rdo-entropyd 
+    daemon instead of random.org, for the types the daemon serves. 
+    The daemon connection is not owned; pass 0 to use random.org again.
+*/
+void RdoAbsObject::setDaemon(RdoDaemon* daemon)
+{
+  _daemon = daemon;
+}
+
+//_____________________________________________________________________________
+/** Get the data from the daemon; implemented by the types for which
+    servedByDaemon() is true.
+    \return true if operation failed
+*/
+bool RdoAbsObject::fetchFromDaemon(RdoDaemon& /*daemon*/)
+{
+  std::cerr << "Error: RdoAbsObject::fetchFromDaemon: Not served by rdo-entropyd" << std::endl;
+  return true;
+}
+
+//_____________________________________________________________________________
+/** Serve deterministic downloads (id. and date. randomizations) from a cache 
+    shared with other objects. The cache is not owned; pass 0 to disable.
+*/
+void RdoAbsObject::setUrlCache(RdoCache* cache)
+{
+  _cache = cache;
+}
+
+//_____________________________________________________________________________
+/** Is the next download served through the cache? */
+bool RdoAbsObject::cached()
+{
+  if(!_cache || _postData!="") return false;
+  buildUrl();
+  return _postData=="" && RdoCache::cacheable(_url);
+}
+
+//_____________________________________________________________________________
+/** Download through the cache; only a miss goes to random.org. 
+    Data that fail the HTTP check or the health tests are not kept.
+    \return true if operation failed
+*/
+bool RdoAbsObject::downloadCached()
+{
+  std::string key(_url);
+  std::string data;
+  bool hit = _cache->get(key, data);
+  if(_metrics) _metrics->add(hit ? RdoMetrics::kUrlHits : RdoMetrics::kUrlMisses);
+
+  // miss: download
+  if(!hit){
+    struct CurlMem cMem;
+    bool failed = fetchMemory(&cMem);
+    if(!failed) failed = checkHTTPcode(handle());
+    if(!failed) data.assign(cMem.memory, cMem.size);
+    if(cMem.memory) free(cMem.memory);
+    if(failed) return true;
+  }
+
+  // in memory
+  if(_inMemory){
+    std::string block(data);
+    struct CurlMem cMem;
+    cMem.memory = &block[0];
+    cMem.size = block.size();
+    if(parseBlock(cMem)){
+      if(hit) _cache->erase(key);
+      return true;
+    }
+  }
+  // or to a string
+  else if(_outString) _outString->append(data);
+  // or to file/stdout
+  else{
+    FILE* fp = stdout;
+    if(_outFileName!="") fp = fopen(_outFileName.c_str(), _append ? "a" : "w");
+    if(fp == NULL){
+      std::cerr << "Error: Failed to open file " << _outFileName.c_str() << std::endl;
+      return true;
+    }
+    fwrite(data.data(), 1, data.size(), fp);
+    if(fp!=stdout) fclose(fp);
+    else fflush(fp);
+  }
+
+  if(!hit) _cache->put(key, data);
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Run health tests on downloaded blocks before they are added to memory.
+    Blocks failing the tests (e.g. truncated, garbled or non-random responses) 
+    are rejected and counted. On by default.
+*/
+void RdoAbsObject::setHealthTests(bool health)
+{
+  _healthTests = health;
+}
+
+//_____________________________________________________________________________
+/** Reject the block being parsed; called by parseMemory implementations. 
+    The block is counted and the download is reported as failed.
+*/
+void RdoAbsObject::rejectBlock(const char* where, const char* reason)
+{
+  std::cerr << "Error: " << where << ": Rejected block, failed " << reason << std::endl;
+  _rejectedBlocks++;
+  _blockRejected = true;
 }
 
 //_____________________________________________________________________________
@@ -344,6 +874,64 @@ size_t RdoAbsObject::writeMemoryCallback(void *contents, size_t size, size_t nme
   return realsize;
 }
 
+//_____________________________________________________________________________
+/** Send the data of a transfer on cURL to fn with data (fn 0 for fwrite to
+    the FILE* data). With an observer, the data pass through
+    observedWriteCallback first and libcurl reports ready connections.
+*/
+void RdoAbsObject::setSink(CURL* cURL, size_t (*fn)(void*, size_t, size_t, void*), void* data)
+{
+  if(!_observer){
+    curl_easy_setopt(cURL, CURLOPT_WRITEFUNCTION, (curl_write_callback)fn);
+    curl_easy_setopt(cURL, CURLOPT_WRITEDATA, data);
+#if LIBCURL_VERSION_NUM >= 0x075000
+    curl_easy_setopt(cURL, CURLOPT_PREREQFUNCTION, (curl_prereq_callback)0);
+#endif
+    return;
+  }
+  _sinkHandle = cURL;
+  _sinkFn = fn;
+  _sinkData = data;
+  _sinkFirst = true;
+  curl_easy_setopt(cURL, CURLOPT_WRITEFUNCTION, observedWriteCallback);
+  curl_easy_setopt(cURL, CURLOPT_WRITEDATA, (void*)this);
+#if LIBCURL_VERSION_NUM >= 0x075000
+  curl_easy_setopt(cURL, CURLOPT_PREREQFUNCTION, connectedCallback);
+  curl_easy_setopt(cURL, CURLOPT_PREREQDATA, (void*)this);
+#endif
+}
+
+//_____________________________________________________________________________
+/** static write callback for observed transfers: report the first byte and
+    the chunk, then pass the data on.
+*/
+size_t RdoAbsObject::observedWriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
+{
+  RdoAbsObject* obj = (RdoAbsObject*)userp;
+  RdoObserver::Time t = RdoObserver::now();
+  if(obj->_sinkFirst){
+    obj->_sinkFirst = false;
+    obj->_observer->firstByte(*obj, t);
+  }
+  obj->_observer->chunk(*obj, size * nmemb, t);
+  if(obj->_sinkFn) return obj->_sinkFn(contents, size, nmemb, obj->_sinkData);
+  return fwrite(contents, size, nmemb, (FILE*)obj->_sinkData);
+}
+
+//_____________________________________________________________________________
+/** static libcurl callback when the connection of an observed transfer is
+    ready, just before the request is sent.
+*/
+int RdoAbsObject::connectedCallback(void* userp, char* /*remoteIp*/, char* /*localIp*/, 
+				    int /*remotePort*/, int /*localPort*/)
+{
+  RdoAbsObject* obj = (RdoAbsObject*)userp;
+  long connects = 0;
+  curl_easy_getinfo(obj->_sinkHandle, CURLINFO_NUM_CONNECTS, &connects);
+  obj->_observer->connected(*obj, connects==0, RdoObserver::now());
+  return 0; // CURL_PREREQFUNC_OK
+}
+
 //_____________________________________________________________________________
 /** Check returned cURL code. 
     \return true if cURL operation failed
@@ -361,10 +949,10 @@ bool RdoAbsObject::checkCURLcode(CURLcode res)
 /** Check returned HTTP response code. 
     \return true if HTTP get request failed
 */
-bool RdoAbsObject::checkHTTPcode()
+bool RdoAbsObject::checkHTTPcode(CURL* cURL)
 {
-  unsigned int responseCode;
-  curl_easy_getinfo(_cURL, CURLINFO_RESPONSE_CODE, &responseCode);
+  long responseCode = 0;
+  curl_easy_getinfo(cURL, CURLINFO_RESPONSE_CODE, &responseCode);
   if(responseCode != 200){
     std::cerr << "Error: random.org returned HTTP status = " << responseCode << std::endl;
     return true;
@@ -380,9 +968,9 @@ bool RdoAbsObject::checkBytesDnld()
 {
   // Pass a pointer to a double to receive the total amount of bytes that were downloaded. 
   // The amount is only for the latest transfer and will be reset again for each new transfer. 
-  double nBytes;
-  curl_easy_getinfo(_cURL, CURLINFO_SIZE_DOWNLOAD, &nBytes);
-  if(nBytes <= 0.){
+  curl_off_t nBytes = 0;
+  curl_easy_getinfo(handle(), CURLINFO_SIZE_DOWNLOAD_T, &nBytes);
+  if(nBytes <= 0){
     std::cerr << "Error: random.org returned zero bytes" << std::endl;
     return true;
   }
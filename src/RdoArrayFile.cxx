@@ -0,0 +1,311 @@
+/** \file RdoArrayFile.cxx
+    \brief Source for typed binary (raw and NumPy .npy) output class
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>     // fixed-width integers
+#include <string.h>     // strerror, memcpy
+#include <errno.h>      // errno
+#include <fcntl.h>      // open
+#include <unistd.h>     // close
+#include <sys/uio.h>    // writev
+#include <iostream>     // for cout, cerr, clog
+#include <sstream>      // header dictionary
+#include "RdoArrayFile.hh"
+
+//_____________________________________________________________________________
+/** Default constructor. */
+RdoArrayFile::RdoArrayFile(const char* fileName, const char* format)
+  : _fileName(fileName), _format("npy"), _columns(1), _append(false), _fd(-1)
+{
+  setFormat(format);
+}
+
+//_____________________________________________________________________________
+/** Copy constructor. */
+RdoArrayFile::RdoArrayFile(const RdoArrayFile& other)
+  : _fileName(other._fileName), _format(other._format),
+    _columns(other._columns), _append(other._append), _fd(-1)
+{}
+
+//_____________________________________________________________________________
+/** Destructor; ends writing in pieces. */
+RdoArrayFile::~RdoArrayFile()
+{
+  end();
+}
+
+//_____________________________________________________________________________
+/** Set the output file; empty for std::cout. */
+void RdoArrayFile::setFileName(const char* fileName)
+{
+  _fileName = std::string(fileName);
+}
+
+//_____________________________________________________________________________
+/** Set the format: raw-i32, raw-i64, raw-f64 or npy.
+    \return true if the format is unknown (the format is not changed)
+*/
+bool RdoArrayFile::setFormat(const char* format)
+{
+  if(!knownFormat(format)){
+    std::cerr << "Error: RdoArrayFile::setFormat: Unknown format " << format << std::endl;
+    return true;
+  }
+  _format = std::string(format);
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Is format one of raw-i32, raw-i64, raw-f64 and npy? */
+bool RdoArrayFile::knownFormat(const char* format)
+{
+  std::string f(format);
+  return (f=="raw-i32" || f=="raw-i64" || f=="raw-f64" || f=="npy");
+}
+
+//_____________________________________________________________________________
+/** Set the number of columns (the second dimension of the npy shape). */
+void RdoArrayFile::setColumns(unsigned int columns)
+{
+  _columns = columns > 0 ? columns : 1;
+}
+
+//_____________________________________________________________________________
+/** Set the append-to-file flag; not allowed for npy. */
+void RdoArrayFile::setAppend(bool append)
+{
+  _append = append;
+}
+
+//_____________________________________________________________________________
+/** Write integers; raw-i32 fails for values outside the 32-bit range.
+    \return true if failed
+*/
+bool RdoArrayFile::write(RdoCacheView<long int> data)
+{
+  std::string buffer;
+  if(_format=="raw-i32"){
+    for(unsigned int k=0; k<data.size(); k++){
+      if(data[k] < INT32_MIN || data[k] > INT32_MAX){
+	std::cerr << "Error: RdoArrayFile::write: " << data[k] << " does not fit raw-i32" << std::endl;
+	return true;
+      }
+    }
+    convert(data, buffer, "i32");
+  }
+  else if(_format=="raw-f64") convert(data, buffer, "f64");
+  else if(sizeof(long int)!=8) convert(data, buffer, "i64");
+
+  std::string header;
+  if(_format=="npy" && _fd < 0) header = npyHeader(std::string(1, byteOrder()).append("i8").c_str(), data.size(), _columns);
+  if(buffer.empty() && !data.empty())
+    return writeBuffer(header, (const char*)&data[0], data.size() * sizeof(long int));
+  return writeBuffer(header, buffer.data(), buffer.size());
+}
+
+//_____________________________________________________________________________
+/** Write integers stored narrower than long int (see RdoIntegers::width());
+    they are widened while converting, only as wide as the format asks.
+    \return true if failed
+*/
+bool RdoArrayFile::write(const RdoIntegerView& data)
+{
+  if(data.width()==sizeof(long int)) return write(data.as<long int>());
+  std::string buffer, header;
+  if(_format=="npy" && _fd < 0) header = npyHeader(std::string(1, byteOrder()).append("i8").c_str(), data.size(), _columns);
+  std::string to = (_format=="npy") ? "i64" : _format.substr(4);
+  data.visit([&](auto values){ convert(values, buffer, to); });
+  return writeBuffer(header, buffer.data(), buffer.size());
+}
+
+//_____________________________________________________________________________
+/** Write fractions; only raw-f64 and npy.
+    \return true if failed
+*/
+bool RdoArrayFile::write(RdoCacheView<double> data)
+{
+  if(_format=="raw-i32" || _format=="raw-i64"){
+    std::cerr << "Error: RdoArrayFile::write: Fractions need raw-f64 or npy, not " << _format.c_str() << std::endl;
+    return true;
+  }
+  std::string header;
+  if(_format=="npy" && _fd < 0) header = npyHeader(std::string(1, byteOrder()).append("f8").c_str(), data.size(), _columns);
+  return writeBuffer(header, data.empty() ? 0 : (const char*)&data[0], data.size() * sizeof(double));
+}
+
+//_____________________________________________________________________________
+/** Write bytes (values in [0,255]); uint8 for npy.
+    \return true if failed
+*/
+bool RdoArrayFile::writeBytes(RdoCacheView<unsigned char> data)
+{
+  std::string buffer, header;
+  if(_format=="npy"){
+    if(_fd < 0) header = npyHeader("|u1", data.size(), _columns);
+    return writeBuffer(header, (const char*)data.data(), data.size());
+  }
+  convert(data, buffer, _format.substr(4));
+  return writeBuffer(header, buffer.data(), buffer.size());
+}
+
+//_____________________________________________________________________________
+/** Start writing in pieces: open the output and, for npy, write the header
+    for n values of type (integers, fractions or bytes) in all; every
+    write() until end() appends one piece, which must add up to n values.
+    \return true if failed
+*/
+bool RdoArrayFile::begin(const char* type, unsigned long n)
+{
+  std::string t(type);
+  std::string header;
+  if(_format=="npy"){
+    if(t=="integers") header = npyHeader(std::string(1, byteOrder()).append("i8").c_str(), n, _columns);
+    else if(t=="fractions") header = npyHeader(std::string(1, byteOrder()).append("f8").c_str(), n, _columns);
+    else if(t=="bytes") header = npyHeader("|u1", n, _columns);
+    else {
+      std::cerr << "Error: RdoArrayFile::begin: Unknown type " << type << std::endl;
+      return true;
+    }
+  }
+  end();
+  if(writeBuffer(header, 0, 0)) return true;
+  // later pieces go after what is there now
+  if(_fileName!=""){
+    _fd = open(_fileName.c_str(), O_WRONLY | O_APPEND);
+    if(_fd < 0){
+      std::cerr << "Error: Failed to open file " << _fileName.c_str() << ": " << strerror(errno) << std::endl;
+      return true;
+    }
+  }
+  else _fd = 1;
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Stop writing in pieces and close the output.
+    \return true if failed
+*/
+bool RdoArrayFile::end()
+{
+  int fd = _fd;
+  _fd = -1;
+  return (fd > 1 && close(fd)!=0);
+}
+
+//_____________________________________________________________________________
+/** NumPy .npy version 1.0 header: magic, version, length and the padded
+    dictionary, so that the data start at a multiple of 64 bytes.
+*/
+std::string RdoArrayFile::npyHeader(const char* descr, unsigned long n, unsigned int columns)
+{
+  std::ostringstream dict;
+  dict << "{'descr': '" << descr << "', 'fortran_order': False, 'shape': (";
+  if(columns > 1 && n % columns == 0) dict << n / columns << ", " << columns << ")";
+  else dict << n << ",)";
+  dict << ", }";
+
+  std::string d = dict.str();
+  size_t total = 10 + d.size() + 1;
+  d.append((64 - total % 64) % 64, ' ');
+  d += '\n';
+
+  std::string header("\x93NUMPY\x01\x00", 8);
+  header += (char)(d.size() & 0xff);
+  header += (char)((d.size() >> 8) & 0xff);
+  return header + d;
+}
+
+//_____________________________________________________________________________
+/** Convert data to the type to (i32, i64, f64 or u8) into buffer, in
+    native byte order; the type is picked once, not per value.
+*/
+template<class T>
+void RdoArrayFile::convert(RdoCacheView<T> data, std::string& buffer, const std::string& to)
+{
+  if(to=="i32") copy<int32_t>(data, buffer);
+  else if(to=="i64") copy<int64_t>(data, buffer);
+  else if(to=="f64") copy<double>(data, buffer);
+  else copy<uint8_t>(data, buffer);
+}
+
+//_____________________________________________________________________________
+/** Copy data into buffer as values of type To. */
+template<class To, class T>
+void RdoArrayFile::copy(RdoCacheView<T> data, std::string& buffer)
+{
+  buffer.resize(data.size() * sizeof(To));
+  char* p = &buffer[0];
+  for(size_t k=0; k<data.size(); k++, p+=sizeof(To)){
+    To v = (To)data[k];
+    memcpy(p, &v, sizeof(To));
+  }
+}
+
+//_____________________________________________________________________________
+/** Write header and data with a single writev (continued if it is cut short).
+    \return true if failed
+*/
+bool RdoArrayFile::writeBuffer(const std::string& header, const char* data, size_t size)
+{
+  if(_append && _format=="npy"){
+    std::cerr << "Error: RdoArrayFile::writeBuffer: Cannot append to an npy file" << std::endl;
+    return true;
+  }
+  int fd = (_fd >= 0) ? _fd : 1;
+  if(_fd < 0 && _fileName!=""){
+    fd = open(_fileName.c_str(), O_WRONLY | O_CREAT | (_append ? O_APPEND : O_TRUNC), 0644);
+    if(fd < 0){
+      std::cerr << "Error: Failed to open file " << _fileName.c_str() << ": " << strerror(errno) << std::endl;
+      return true;
+    }
+  }
+  else std::cout.flush();
+
+  struct iovec iov[2];
+  iov[0].iov_base = (void*)header.data();
+  iov[0].iov_len = header.size();
+  iov[1].iov_base = (void*)data;
+  iov[1].iov_len = size;
+  int first = (header.empty()) ? 1 : 0;
+  bool failed = false;
+  while(first < 2){
+    ssize_t n = writev(fd, iov + first, 2 - first);
+    if(n < 0){
+      if(errno==EINTR) continue;
+      std::cerr << "Error: RdoArrayFile::writeBuffer: " << strerror(errno) << std::endl;
+      failed = true;
+      break;
+    }
+    // skip what went out
+    while(first < 2 && (size_t)n >= iov[first].iov_len){ n -= iov[first].iov_len; first++; }
+    if(first < 2){
+      iov[first].iov_base = (char*)iov[first].iov_base + n;
+      iov[first].iov_len -= n;
+    }
+  }
+  if(fd!=1 && fd!=_fd && close(fd)!=0) failed = true;
+  return failed;
+}
+
+//_____________________________________________________________________________
+/** Byte order character of this machine for npy descr: '<' or '>'. */
+char RdoArrayFile::byteOrder()
+{
+  uint16_t one = 1;
+  return (*(const char*)&one) ? '<' : '>';
+}
@@ -19,14 +19,19 @@
 */
 #include <stdlib.h>     // general utilities
 #include <iostream>     // for cout, cerr, clog
-#include <string.h>     // string handling functions (memset, strtok)
+#include <string.h>     // string handling functions (memset)
+#include "RdoHealth.hh"
+#include "RdoDaemon.hh"
+#include "RdoMetrics.hh"
+#include "RdoObserver.hh"
+#include "RdoRequest.hh"
 #include "RdoBytes.hh"
 
 //_____________________________________________________________________________
 /** Default constructor. */
 RdoBytes::RdoBytes()
   : RdoAbsObject(),
-    _base("10"), _columns(1),
+    _base(10), _columns(1),
     _randData(0), _pos(0)
 {}
 
@@ -46,17 +51,29 @@ void RdoBytes::setBase(const char* base)
 {
   std::string b(base);
   if(b=="2" || b=="binary")
-    _base = "2";
+    _base = 2;
   else if(b=="8" || b=="octal")
-    _base = "8";
+    _base = 8;
   else if(b=="10" || b=="decimal")
-    _base = "10";
+    _base = 10;
   else if(b=="16" || b=="hexadecimal")
-    _base = "16";
+    _base = 16;
   else{
     std::cerr << "Error: RdoBytes::setBase: Unkonwn base = " << base
 	      << " requested, using base = 10" << std::endl;
-    _base = "10";
+    _base = 10;
+  }
+}
+
+//_____________________________________________________________________________
+/** Base number system of each integer: "2", "8", "10" or "16". */
+const char* RdoBytes::base() const
+{
+  switch(_base){
+  case 2:  return "2";
+  case 8:  return "8";
+  case 16: return "16";
+  default: return "10";
   }
 }
 
@@ -71,8 +88,13 @@ void RdoBytes::setColumns(unsigned int columns)
 /** Build the URL for checking the quota. */
 void RdoBytes::buildUrl()
 {
-  sprintf(_url,"%s://%s/integers/?format=%s&rnd=%s&num=%d&col=%d&min=0&max=255&base=%s", 
-	  scheme(), rdoUrl(), format(), randomization(), num(), columns(), base());
+  bool overflow = false;
+  RdoRequestBase::withBase<kRdoIntegers>(_base, [&](auto req){
+      overflow = decltype(req)::url(_url, kUrlSize, *this, 0, 255, _columns);
+    });
+  if(overflow)
+    std::cerr << "Error: RdoBytes::buildUrl: Url longer than " << kUrlSize - 1
+	      << " characters, truncated" << std::endl;
 }
 
 //_____________________________________________________________________________
@@ -81,20 +103,44 @@ unsigned int RdoBytes::rndm()
 {
   unsigned int dsize = _randData.size();
   if(dsize==0){
+    if(metrics()) metrics()->add(RdoMetrics::kEmpty);
+    if(observer()) observer()->cacheExhausted(*this, RdoObserver::now());
     std::cerr << "Warning: RdoBytes::rndm: No data in memory" << std::endl;
     return 0;
   } 
 
   if(_pos >= dsize){
+    if(metrics()) metrics()->add(RdoMetrics::kWraps);
+    if(observer()) observer()->cacheExhausted(*this, RdoObserver::now());
     std::cerr << "Warning: RdoBytes::rndm: Exceeded random cache size, begining to repeat!" << std::endl;
     _pos = 0;
   }
   unsigned int val = _randData[_pos];	
   _pos++;
+  countDraw();
   
   return val;
 }
 
+//_____________________________________________________________________________
+/** Take the next n numbers from memory without copying, as a view that is
+    valid until the next download. Unlike rndm(), consume() does not wrap
+    around: at the end of the cache the view is shorter, or empty.
+*/
+RdoCacheView<unsigned char> RdoBytes::consume(unsigned int n)
+{
+  unsigned int dsize = _randData.size();
+  unsigned int first = (_pos < dsize) ? _pos : dsize;
+  unsigned int count = (n < dsize - first) ? n : dsize - first;
+  if(count < n){
+    if(dsize==0 && metrics()) metrics()->add(RdoMetrics::kEmpty);
+    if(observer()) observer()->cacheExhausted(*this, RdoObserver::now());
+  }
+  _pos = first + count;
+  countDraws(count);
+  return RdoCacheView<unsigned char>(_randData.data() + first, count);
+}
+
 //_____________________________________________________________________________
 /** Parse the integers into memory. */
 void RdoBytes::parseMemory(struct RdoAbsObject::CurlMem cMem)
@@ -111,14 +157,44 @@ void RdoBytes::parseMemory(struct RdoAbsObject::CurlMem cMem)
     return;
   }
 
-  // parse the memory
-  char delim = '\n';
-  char* token = strtok(cMem.memory,&delim) ;
-  while(token){
-    _randData.push_back(strtoul(token,NULL,atoi(base())));
-    token = strtok(0,&delim) ; 
-  }  
+  // health tests on this block
+  bool check = healthTests();
+  RdoHealth health;
+  if(check) health.begin(256., num());
 
-  if(_randData.size()<num())
+  // parse the memory, with the parser for the base
+  std::vector<unsigned char> block;
+  block.reserve(num());
+  RdoRequestBase::withBase<kRdoIntegers>(_base, [&](auto req){
+      decltype(req)::parse(cMem, 0, 255, block, check ? &health : 0);
+    });
+  if(check && block.size()!=num()) health.fail("count check");
+  if(check && health.end()){
+    rejectBlock("RdoBytes::parseMemory", health.reason());
+    return;
+  }
+  _randData.insert(_randData.end(), block.begin(), block.end());
+
+  if(block.size()<num())
     std::cerr << "Warning: RdoBytes::parseMemory: Parsed fewer numbers than downloaded" << std::endl;    
 }
+
+//_____________________________________________________________________________
+/** Get the bytes from an rdo-entropyd daemon. 
+    \return true if operation failed
+*/
+bool RdoBytes::fetchFromDaemon(RdoDaemon& daemon)
+{
+  unsigned int k = daemon.addBytes(num());
+  if(daemon.request()) return true;
+  const std::vector<unsigned char>& data = daemon.bytes(k);
+  _randData.insert(_randData.end(), data.begin(), data.end());
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Random bits a request costs: 8 per byte. */
+unsigned long RdoBytes::requestBits() const
+{
+  return (unsigned long)num() * 8;
+}
@@ -0,0 +1,365 @@
+/** \file RdoCache.cxx
+    \brief Source for deterministic data cache class
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>      // file i/o
+#include <stdint.h>     // fixed width integers
+#include <string.h>     // string handling functions
+#include <ctype.h>      // isdigit
+#include <unistd.h>     // getpid
+#include <dirent.h>     // opendir
+#include <utime.h>      // utime
+#include <sys/stat.h>   // stat, mkdir
+#include <iostream>     // for cout, cerr, clog
+#include <vector>
+#include <algorithm>    // sort
+#include <atomic>
+#include "RdoCache.hh"
+
+// record file magic and version
+static const char kMagic[4] = {'R','D','O','C'};
+static const uint32_t kVersion = 1;
+// record file name suffix
+static const char* kSuffix = ".rdoc";
+
+//_____________________________________________________________________________
+/** Default constructor. */
+RdoCache::RdoCache(const char* dir, unsigned long maxMemBytes, unsigned long maxDiskBytes)
+  : _dir(""), _maxMem(maxMemBytes), _maxDisk(maxDiskBytes),
+    _memBytes(0), _diskBytes(0), _memHits(0), _diskHits(0), _misses(0)
+{
+  if(dir && strlen(dir)!=0) setDirectory(dir);
+}
+
+//_____________________________________________________________________________
+/** Copy constructor; copies the settings and the memory entries. */
+RdoCache::RdoCache(const RdoCache& other)
+  : _dir(other._dir), _maxMem(other._maxMem), _maxDisk(other._maxDisk),
+    _lru(other._lru), _memBytes(other._memBytes), _diskBytes(other._diskBytes),
+    _memHits(other._memHits), _diskHits(other._diskHits), _misses(other._misses)
+{
+  for(LruList::iterator it=_lru.begin(); it!=_lru.end(); ++it) _index[it->first] = it;
+}
+
+//_____________________________________________________________________________
+/** Set (and create) the directory of the disk cache; empty for memory only.
+    \return true if the directory can not be used
+*/
+bool RdoCache::setDirectory(const char* dir)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _dir = "";
+  _diskBytes = 0;
+  if(!dir || strlen(dir)==0) return false;
+
+  struct stat st;
+  if(stat(dir, &st)!=0 && mkdir(dir, 0700)!=0){
+    std::cerr << "Error: RdoCache::setDirectory: Can not create " << dir << std::endl;
+    return true;
+  }
+  if(stat(dir, &st)!=0 || !S_ISDIR(st.st_mode)){
+    std::cerr << "Error: RdoCache::setDirectory: Not a directory " << dir << std::endl;
+    return true;
+  }
+  _dir = std::string(dir);
+  pruneDisk();
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Set the memory bound in bytes. */
+void RdoCache::setMaxMemBytes(unsigned long maxBytes)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _maxMem = maxBytes;
+  evictMem();
+}
+
+//_____________________________________________________________________________
+/** Set the disk bound in bytes. */
+void RdoCache::setMaxDiskBytes(unsigned long maxBytes)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _maxDisk = maxBytes;
+  pruneDisk();
+}
+
+//_____________________________________________________________________________
+/** Is the download with this url deterministic, i.e. is its randomization
+    id.identifier or date.YYYY-MM-DD?
+*/
+bool RdoCache::cacheable(const char* url)
+{
+  const char* rnd = url ? strstr(url, "rnd=") : 0;
+  if(!rnd) return false;
+  rnd += 4;
+  size_t len = strcspn(rnd, "&");
+
+  if(len > 3 && strncmp(rnd, "id.", 3)==0) return true;
+  if(len==15 && strncmp(rnd, "date.", 5)==0){
+    const char* d = rnd + 5;
+    for(int k=0; k<10; k++){
+      if(k==4 || k==7){ if(d[k]!='-') return false; }
+      else if(!isdigit((unsigned char)d[k])) return false;
+    }
+    return true;
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Look up the data for url, in memory and then on disk.
+    \return true if found
+*/
+bool RdoCache::get(const std::string& url, std::string& data)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  // memory
+  std::map<std::string, LruList::iterator>::iterator it = _index.find(url);
+  if(it!=_index.end()){
+    _lru.splice(_lru.begin(), _lru, it->second);
+    data = it->second->second;
+    _memHits++;
+    return true;
+  }
+
+  // disk
+  if(_dir!="" && readFile(url, data)){
+    putMem(url, data);
+    _diskHits++;
+    return true;
+  }
+
+  _misses++;
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Store the data for url in memory and on disk. */
+void RdoCache::put(const std::string& url, const std::string& data)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  putMem(url, data);
+  if(_dir!="" && !writeFile(url, data) && _diskBytes > _maxDisk) pruneDisk();
+}
+
+//_____________________________________________________________________________
+/** Remove the data for url, e.g. when it turned out to be bad. */
+void RdoCache::erase(const std::string& url)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  eraseMem(url);
+  if(_dir!=""){
+    std::string file = fileName(url);
+    struct stat st;
+    if(stat(file.c_str(), &st)==0 && remove(file.c_str())==0)
+      _diskBytes -= std::min(_diskBytes, (unsigned long)st.st_size);
+  }
+}
+
+//_____________________________________________________________________________
+/** Remove all entries from memory and disk. */
+void RdoCache::clear()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _lru.clear();
+  _index.clear();
+  _memBytes = 0;
+  if(_dir!=""){
+    unsigned long maxDisk = _maxDisk;
+    _maxDisk = 0;
+    pruneDisk();
+    _maxDisk = maxDisk;
+  }
+}
+
+//_____________________________________________________________________________
+/** Insert into the memory list and evict the least recently used entries. */
+void RdoCache::putMem(const std::string& url, const std::string& data)
+{
+  eraseMem(url);
+  if(url.size() + data.size() > _maxMem) return;
+  _lru.push_front(std::make_pair(url, data));
+  _index[url] = _lru.begin();
+  _memBytes += url.size() + data.size();
+  evictMem();
+}
+
+//_____________________________________________________________________________
+/** Evict the least recently used memory entries above the bound. */
+void RdoCache::evictMem()
+{
+  while(_memBytes > _maxMem){
+    LruList::iterator last = --_lru.end();
+    _memBytes -= last->first.size() + last->second.size();
+    _index.erase(last->first);
+    _lru.erase(last);
+  }
+}
+
+//_____________________________________________________________________________
+/** Remove from the memory list. */
+void RdoCache::eraseMem(const std::string& url)
+{
+  std::map<std::string, LruList::iterator>::iterator it = _index.find(url);
+  if(it==_index.end()) return;
+  _memBytes -= it->second->first.size() + it->second->second.size();
+  _lru.erase(it->second);
+  _index.erase(it);
+}
+
+//_____________________________________________________________________________
+/** Read and verify the record file of url; a hit refreshes its time stamp.
+    \return true if found
+*/
+bool RdoCache::readFile(const std::string& url, std::string& data)
+{
+  std::string file = fileName(url);
+  FILE* fp = fopen(file.c_str(), "rb");
+  if(!fp) return false;
+
+  char magic[4];
+  uint32_t version = 0, keyLen = 0;
+  uint64_t len = 0, sum = 0;
+  bool ok = (fread(magic, 1, 4, fp)==4 && memcmp(magic, kMagic, 4)==0 &&
+	     fread(&version, sizeof(version), 1, fp)==1 && version==kVersion &&
+	     fread(&keyLen, sizeof(keyLen), 1, fp)==1 && keyLen==url.size() &&
+	     fread(&len, sizeof(len), 1, fp)==1);
+  if(ok){
+    std::string key(keyLen, '\0');
+    ok = (fread(&key[0], 1, keyLen, fp)==keyLen && key==url);
+  }
+  if(ok){
+    // the length must match the file, before anything is allocated for it
+    struct stat st;
+    uint64_t rest = sizeof(magic) + sizeof(version) + sizeof(keyLen) + sizeof(len) + keyLen + sizeof(sum);
+    ok = (fstat(fileno(fp), &st)==0 && (uint64_t)st.st_size >= rest && len==(uint64_t)st.st_size - rest);
+  }
+  if(ok){
+    data.resize(len);
+    ok = (len==0 || fread(&data[0], 1, len, fp)==len) &&
+      fread(&sum, sizeof(sum), 1, fp)==1 && sum==hash(data.data(), data.size());
+  }
+  fclose(fp);
+
+  if(!ok){
+    std::cerr << "Warning: RdoCache::readFile: Ignoring corrupt or colliding record " << file << std::endl;
+    data = "";
+    return false;
+  }
+  utime(file.c_str(), 0);
+  return true;
+}
+
+//_____________________________________________________________________________
+/** Write the record file of url (via a temporary file, so readers never see half a record).
+    The temporary file is unique to the process and the call, so writers of
+    the same record in other caches or threads do not mix.
+    \return true if failed
+*/
+bool RdoCache::writeFile(const std::string& url, const std::string& data)
+{
+  static std::atomic<unsigned long> nWrites(0);
+  std::string file = fileName(url);
+  char tmp[48];
+  snprintf(tmp, sizeof(tmp), ".%d.%lu.tmp", (int)getpid(), nWrites++);
+  std::string tmpFile = file + tmp;
+
+  FILE* fp = fopen(tmpFile.c_str(), "wb");
+  if(!fp){
+    std::cerr << "Error: RdoCache::writeFile: Failed to open file " << tmpFile << std::endl;
+    return true;
+  }
+  uint32_t keyLen = url.size();
+  uint64_t len = data.size();
+  uint64_t sum = hash(data.data(), data.size());
+  bool ok = (fwrite(kMagic, 1, 4, fp)==4 &&
+	     fwrite(&kVersion, sizeof(kVersion), 1, fp)==1 &&
+	     fwrite(&keyLen, sizeof(keyLen), 1, fp)==1 &&
+	     fwrite(&len, sizeof(len), 1, fp)==1 &&
+	     fwrite(url.data(), 1, keyLen, fp)==keyLen &&
+	     (len==0 || fwrite(data.data(), 1, len, fp)==len) &&
+	     fwrite(&sum, sizeof(sum), 1, fp)==1);
+  if(fclose(fp)!=0) ok = false;
+
+  // replace any previous record
+  struct stat st;
+  unsigned long old = (stat(file.c_str(), &st)==0) ? st.st_size : 0;
+  if(!ok || rename(tmpFile.c_str(), file.c_str())!=0){
+    std::cerr << "Error: RdoCache::writeFile: Failed to write file " << file << std::endl;
+    remove(tmpFile.c_str());
+    return true;
+  }
+  _diskBytes += 4 + sizeof(kVersion) + sizeof(keyLen) + sizeof(len) + keyLen + len + sizeof(sum);
+  _diskBytes -= std::min(_diskBytes, old);
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Recount the disk cache and remove the least recently used records above the bound. */
+void RdoCache::pruneDisk()
+{
+  if(_dir=="") return;
+  DIR* d = opendir(_dir.c_str());
+  if(!d) return;
+
+  // (time stamp, size, name) of the records
+  std::vector<std::pair<time_t, std::pair<unsigned long, std::string> > > files;
+  unsigned long total = 0;
+  size_t nSuffix = strlen(kSuffix);
+  struct dirent* entry;
+  while((entry = readdir(d))){
+    size_t n = strlen(entry->d_name);
+    if(n <= nSuffix || strcmp(entry->d_name + n - nSuffix, kSuffix)!=0) continue;
+    std::string file = _dir + "/" + entry->d_name;
+    struct stat st;
+    if(stat(file.c_str(), &st)!=0) continue;
+    files.push_back(std::make_pair(st.st_mtime, std::make_pair((unsigned long)st.st_size, file)));
+    total += st.st_size;
+  }
+  closedir(d);
+
+  // oldest first
+  std::sort(files.begin(), files.end());
+  for(size_t k=0; k<files.size() && total > _maxDisk; k++){
+    if(remove(files[k].second.second.c_str())==0) total -= files[k].second.first;
+  }
+  _diskBytes = total;
+}
+
+//_____________________________________________________________________________
+/** Record file name of url. */
+std::string RdoCache::fileName(const std::string& url) const
+{
+  char name[32];
+  snprintf(name, sizeof(name), "/%016llx", hash(url.data(), url.size()));
+  return _dir + name + kSuffix;
+}
+
+//_____________________________________________________________________________
+/** 64-bit FNV-1a hash. */
+unsigned long long RdoCache::hash(const char* data, size_t n)
+{
+  unsigned long long h = 14695981039346656037ULL;
+  for(size_t k=0; k<n; k++){
+    h ^= (unsigned char)data[k];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
@@ -0,0 +1,78 @@
+/** \file RdoCacheView.cxx
+    \brief Source for read-only views of in-memory caches
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>     // memcpy
+#include "RdoCacheView.hh"
+
+// widening kernels get an AVX2 clone, picked at load time, where the
+// compiler and the loader support it
+#if defined(__x86_64__) && defined(__linux__) && \
+  ((defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 6) || (defined(__clang__) && __clang_major__ >= 14))
+#define RDO_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define RDO_CLONES
+#endif
+
+//! values per block: fixed-length loops, which the compiler vectorizes at -O2
+static const size_t kBlock = 16;
+//! values per chunk of vector(), widened in L1 before going to the vector
+static const size_t kChunk = 256;
+
+//_____________________________________________________________________________
+//! widen n values stored as T into dst
+template<class T>
+static inline void WidenBlocks(const T* src, size_t n, long int* dst)
+{
+  size_t k = 0;
+  for(; k + kBlock <= n; k += kBlock)
+    for(size_t j=0; j<kBlock; j++) dst[k+j] = src[k+j];
+  for(; k<n; k++) dst[k] = src[k];
+}
+
+RDO_CLONES static void Widen(const int8_t* src, size_t n, long int* dst) { WidenBlocks(src, n, dst); }
+RDO_CLONES static void Widen(const int16_t* src, size_t n, long int* dst) { WidenBlocks(src, n, dst); }
+RDO_CLONES static void Widen(const int32_t* src, size_t n, long int* dst) { WidenBlocks(src, n, dst); }
+static void Widen(const long int* src, size_t n, long int* dst) { memcpy(dst, src, n * sizeof(long int)); }
+
+//_____________________________________________________________________________
+/** Widened copy of the values. They are widened a chunk at a time into a
+    buffer, so the vector is written once, without being zeroed first.
+*/
+std::vector<long int> RdoIntegerView::vector() const
+{
+  if(_width==sizeof(long int)) return as<long int>().vector();
+  std::vector<long int> values;
+  values.reserve(_size);
+  visit([&](auto v){
+      long int chunk[kChunk];
+      for(size_t first=0; first<v.size(); first+=kChunk){
+	size_t n = (v.size() - first < kChunk) ? v.size() - first : kChunk;
+	Widen(v.data() + first, n, chunk);
+	values.insert(values.end(), chunk, chunk + n);
+      }
+    });
+  return values;
+}
+
+//_____________________________________________________________________________
+/** Widen the values into dst, which holds size() long ints. */
+void RdoIntegerView::widen(long int* dst) const
+{
+  visit([&](auto v){ Widen(v.data(), v.size(), dst); });
+}
@@ -0,0 +1,240 @@
+/** \file RdoClient.cxx
+    \brief Source for thread-safe client class
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "RdoAbsObject.hh"
+#include "RdoClient.hh"
+
+//_____________________________________________________________________________
+/** Default constructor. */
+RdoClient::RdoClient()
+  : _id(newId())
+{}
+
+//_____________________________________________________________________________
+/** Copy constructor; the copy starts without sessions or statistics. */
+RdoClient::RdoClient(const RdoClient& /*other*/)
+  : _id(newId())
+{}
+
+//_____________________________________________________________________________
+/** Move constructor; takes over the sessions and statistics. */
+RdoClient::RdoClient(RdoClient&& other)
+  : _id(0), _stats(other._stats)
+{
+  other._stats.reset();
+  std::lock_guard<std::mutex> lock(other._mutex);
+  _id = other._id;
+  _shared.swap(other._shared);
+  other._id = newId();
+}
+
+//_____________________________________________________________________________
+/** Assignment; releases the own sessions, copies nothing. */
+RdoClient& RdoClient::operator=(const RdoClient& other)
+{
+  if(this!=&other) release();
+  return *this;
+}
+
+//_____________________________________________________________________________
+/** Move assignment; releases the own sessions and takes over the other's,
+    with the statistics.
+*/
+RdoClient& RdoClient::operator=(RdoClient&& other)
+{
+  if(this==&other) return *this;
+  release();
+  _stats = other._stats;
+  other._stats.reset();
+  std::lock(_mutex, other._mutex);
+  std::lock_guard<std::mutex> lock1(_mutex, std::adopt_lock);
+  std::lock_guard<std::mutex> lock2(other._mutex, std::adopt_lock);
+  _id = other._id;
+  _shared.swap(other._shared);
+  other._id = newId();
+  return *this;
+}
+
+//_____________________________________________________________________________
+/** Destructor; releases the sessions of all threads. */
+RdoClient::~RdoClient()
+{
+  release();
+}
+
+//_____________________________________________________________________________
+/** Release the sessions not held by a thread and let go of the shared data;
+    threads free the sessions they hold when they exit or next need a new
+    one, and the shared data goes with the last of them. The client gets a
+    new id, so threads will create new sessions on their next transfer.
+*/
+void RdoClient::release()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  if(_shared){
+    std::lock_guard<std::mutex> guard(_shared->mutex);
+    _shared->alive = false;
+    for(unsigned int k=0; k<_shared->idle.size(); k++) curl_easy_cleanup(_shared->idle[k]);
+    _shared->nHandles -= _shared->idle.size();
+    _shared->idle.clear();
+  }
+  _shared.reset();
+  _id = newId();
+}
+
+//_____________________________________________________________________________
+/** A new, never reused, client id. */
+unsigned long RdoClient::newId()
+{
+  static std::atomic<unsigned long> next(1);
+  return next++;
+}
+
+//_____________________________________________________________________________
+/** The cURL session of the calling thread; handed back by an exited thread
+    or created on first use.
+*/
+CURL* RdoClient::handle()
+{
+  Holder& h = holder();
+  std::map<unsigned long, Session>::iterator it = h.sessions.find(_id);
+  if(it!=h.sessions.end()) return it->second.handle;
+  h.prune();
+
+  Session session;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    RdoAbsObject::initCURL();
+    if(!_shared) _shared = std::make_shared<Shared>();
+    session.shared = _shared;
+  }
+  Shared& shared = *session.shared;
+  std::lock_guard<std::mutex> guard(shared.mutex);
+  if(!shared.idle.empty()){
+    session.handle = shared.idle.back();
+    shared.idle.pop_back();
+  }
+  else{
+    session.handle = curl_easy_init();
+    curl_easy_setopt(session.handle, CURLOPT_SHARE, shared.share);
+    shared.nHandles++;
+  }
+  h.sessions[_id] = session;
+  return session.handle;
+}
+
+//_____________________________________________________________________________
+/** Number of sessions, held by threads or waiting for the next new thread. */
+unsigned long RdoClient::nHandles() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  if(!_shared) return 0;
+  std::lock_guard<std::mutex> guard(_shared->mutex);
+  return _shared->nHandles;
+}
+
+//_____________________________________________________________________________
+/** The calling thread's sessions. */
+RdoClient::Holder& RdoClient::holder()
+{
+  static thread_local Holder tHolder;
+  return tHolder;
+}
+
+//_____________________________________________________________________________
+/** Shared data with DNS, TLS sessions and connections shared. */
+RdoClient::Shared::Shared()
+  : share(curl_share_init()), nHandles(0), alive(true)
+{
+  curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockShared);
+  curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockShared);
+  curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+}
+
+//_____________________________________________________________________________
+/** Destructor; every session was freed before. */
+RdoClient::Shared::~Shared()
+{
+  for(unsigned int k=0; k<idle.size(); k++) curl_easy_cleanup(idle[k]);
+  curl_share_cleanup(share);
+}
+
+//_____________________________________________________________________________
+/** Take back a session of an exiting thread for the next new thread, or
+    free it if the client is gone.
+*/
+void RdoClient::Shared::giveBack(CURL* handle)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if(alive) idle.push_back(handle);
+  else{
+    curl_easy_cleanup(handle);
+    nHandles--;
+  }
+}
+
+//_____________________________________________________________________________
+/** Destructor; the thread exits and hands its sessions back. */
+RdoClient::Holder::~Holder()
+{
+  for(std::map<unsigned long, Session>::iterator it = sessions.begin(); it!=sessions.end(); ++it)
+    it->second.shared->giveBack(it->second.handle);
+}
+
+//_____________________________________________________________________________
+/** Free the sessions of clients that are gone. */
+void RdoClient::Holder::prune()
+{
+  for(std::map<unsigned long, Session>::iterator it = sessions.begin(); it!=sessions.end(); ){
+    if(it->second.shared->alive){ ++it; continue; }
+    it->second.shared->giveBack(it->second.handle);
+    it = sessions.erase(it);
+  }
+}
+
+//_____________________________________________________________________________
+/** Download obj with the calling thread's session. Safe to call from
+    many threads at once, for different objects.
+    \return true if operation failed
+*/
+bool RdoClient::downloadData(RdoAbsObject& obj)
+{
+  RdoClient* previous = obj.client();
+  obj.setClient(this);
+  bool failed = obj.downloadData();
+  obj.setClient(previous);
+  return failed;
+}
+
+//_____________________________________________________________________________
+/** Lock callback for the cURL share. */
+void RdoClient::lockShared(CURL* /*handle*/, curl_lock_data data, curl_lock_access /*access*/, void* shared)
+{
+  ((Shared*)shared)->locks[data].lock();
+}
+
+//_____________________________________________________________________________
+/** Unlock callback for the cURL share. */
+void RdoClient::unlockShared(CURL* /*handle*/, curl_lock_data data, void* shared)
+{
+  ((Shared*)shared)->locks[data].unlock();
+}
@@ -0,0 +1,195 @@
+/** \file RdoCoalescer.cxx
+    \brief Source for request coalescing class
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>     // general utilities
+#include <string.h>     // string handling functions
+#include <iostream>     // for cout, cerr, clog
+#include <chrono>       // time window
+#include "RdoCoalescer.hh"
+
+//_____________________________________________________________________________
+/** Default constructor. */
+RdoCoalescer::RdoCoalescer(unsigned int windowMs, unsigned int maxNum)
+  : _windowMs(windowMs), _maxNum(maxNum), _requests(0), _downloads(0)
+{}
+
+//_____________________________________________________________________________
+/** Copy constructor; copies the settings, not the pending requests. */
+RdoCoalescer::RdoCoalescer(const RdoCoalescer& other)
+  : _windowMs(other._windowMs), _maxNum(other._maxNum),
+    _requests(other._requests.load()), _downloads(other._downloads.load())
+{}
+
+//_____________________________________________________________________________
+/** Set the time window (in milliseconds) during which requests are merged. */
+void RdoCoalescer::setWindow(unsigned int windowMs)
+{
+  _windowMs = windowMs;
+}
+
+//_____________________________________________________________________________
+/** Set the largest number of values in a merged request. */
+void RdoCoalescer::setMaxNum(unsigned int maxNum)
+{
+  _maxNum = maxNum;
+}
+
+//_____________________________________________________________________________
+/** Key of a request: the url without the num parameter. */
+std::string RdoCoalescer::key(RdoAbsObject& obj)
+{
+  obj.buildUrl();
+  std::string url(obj.url());
+  size_t pos = url.find("num=");
+  if(pos==std::string::npos) return url;
+  size_t end = url.find('&', pos);
+  if(end==std::string::npos) return url.substr(0, pos);
+  return url.substr(0, pos) + url.substr(end + 1);
+}
+
+//_____________________________________________________________________________
+/** Download (in memory) for obj, merging with concurrent requests for the same data.
+    \return true if operation failed
+*/
+bool RdoCoalescer::download(RdoAbsObject& obj)
+{
+  _requests++;
+
+  // fresh, small requests only
+  if(obj.num()==0 || obj.num() >= _maxNum || strcmp(obj.randomization(), "new")!=0)
+    return downloadDirect(obj);
+
+  std::string k = key(obj);
+  std::shared_ptr<Group> group;
+  unsigned int idx = 0;
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    // join an open group
+    std::map<std::string, std::shared_ptr<Group> >::iterator it = _open.find(k);
+    if(it!=_open.end() && it->second->num + obj.num() <= _maxNum){
+      group = it->second;
+      idx = group->members.size();
+      group->members.push_back(&obj);
+      group->num += obj.num();
+      if(group->num >= _maxNum) _cond.notify_all();
+
+      // wait for the leader to download and split the data
+      while(!group->done) _cond.wait(lock);
+    }
+    // or open a new group and lead it for the time window
+    else{
+      group = std::make_shared<Group>();
+      group->members.push_back(&obj);
+      group->num = obj.num();
+      group->done = false;
+      group->failed = false;
+      _open[k] = group;
+
+      std::chrono::steady_clock::time_point deadline =
+	std::chrono::steady_clock::now() + std::chrono::milliseconds(_windowMs);
+      while(group->num < _maxNum && _cond.wait_until(lock, deadline)!=std::cv_status::timeout) {}
+
+      // close the group
+      it = _open.find(k);
+      if(it!=_open.end() && it->second==group) _open.erase(it);
+    }
+  }
+
+  // leader
+  if(idx==0){
+    // nobody joined
+    if(group->members.size()==1) return downloadDirect(obj);
+    return downloadMerged(obj, group);
+  }
+
+  // follower
+  if(group->failed) return true;
+  struct RdoAbsObject::CurlMem cMem;
+  cMem.memory = &group->chunks[idx][0];
+  cMem.size = group->chunks[idx].size();
+  return obj.parseBlock(cMem);
+}
+
+//_____________________________________________________________________________
+/** Download and parse for a single object.
+    \return true if operation failed
+*/
+bool RdoCoalescer::downloadDirect(RdoAbsObject& obj)
+{
+  _downloads++;
+
+  struct RdoAbsObject::CurlMem cMem;
+  bool failed = obj.fetchMemory(&cMem);
+  if(!failed) failed = obj.parseBlock(cMem);
+  if(cMem.memory) free(cMem.memory);
+  return failed;
+}
+
+//_____________________________________________________________________________
+/** Download the merged request of a group with obj as leader, split
+    the lines among the members and parse the leader's share.
+    \return true if operation failed
+*/
+bool RdoCoalescer::downloadMerged(RdoAbsObject& obj, std::shared_ptr<Group> group)
+{
+  _downloads++;
+
+  // download the total with the leader's handle
+  unsigned int num = obj.num();
+  obj.setNum(group->num);
+  struct RdoAbsObject::CurlMem cMem;
+  bool failed = obj.fetchMemory(&cMem);
+  obj.setNum(num);
+
+  // split the lines
+  std::vector<std::string> chunks(group->members.size());
+  if(!failed){
+    const char* p = cMem.memory;
+    const char* end = cMem.memory + cMem.size;
+    for(unsigned int m=0; m<group->members.size() && !failed; m++){
+      const char* begin = p;
+      for(unsigned int n=group->members[m]->num(); n>0; n--){
+	const char* eol = (const char*)memchr(p, '\n', end - p);
+	if(!eol){
+	  std::cerr << "Error: RdoCoalescer::downloadMerged: Too few values in merged download" << std::endl;
+	  failed = true;
+	  break;
+	}
+	p = eol + 1;
+      }
+      chunks[m].assign(begin, p - begin);
+    }
+  }
+  if(cMem.memory) free(cMem.memory);
+
+  // hand over to the members
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    group->chunks.swap(chunks);
+    group->failed = failed;
+    group->done = true;
+  }
+  _cond.notify_all();
+  if(failed) return true;
+
+  cMem.memory = &group->chunks[0][0];
+  cMem.size = group->chunks[0].size();
+  return obj.parseBlock(cMem);
+}
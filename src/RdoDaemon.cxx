@@ -0,0 +1,313 @@
+/** \file RdoDaemon.cxx
+    \brief Source for rdo-entropyd client class
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>     // getenv
+#include <string.h>     // string handling functions
+#include <errno.h>      // errno
+#include <unistd.h>     // read, write, close, geteuid
+#include <poll.h>       // poll
+#include <sys/stat.h>   // mkdir, lstat
+#include <sys/socket.h> // socket
+#include <sys/un.h>     // sockaddr_un
+#include <iostream>     // for cout, cerr, clog
+#include "RdoDaemon.hh"
+
+//_____________________________________________________________________________
+/** Default constructor; an empty socket means defaultSocket(). */
+RdoDaemon::RdoDaemon(const char* socket)
+  : _fd(-1)
+{
+  setSocket(socket);
+}
+
+//_____________________________________________________________________________
+/** Copy constructor; copies the socket and queued requests, not the connection. */
+RdoDaemon::RdoDaemon(const RdoDaemon& other)
+  : _socket(other._socket), _fd(-1), _items(other._items),
+    _bytes(other._bytes), _integers(other._integers), _fractions(other._fractions)
+{}
+
+//_____________________________________________________________________________
+/** Destructor. */
+RdoDaemon::~RdoDaemon()
+{
+  disconnect();
+}
+
+//_____________________________________________________________________________
+/** Set the path of the daemon socket; an empty path means defaultSocket(). */
+void RdoDaemon::setSocket(const char* socket)
+{
+  disconnect();
+  if(socket && strlen(socket)!=0) _socket = std::string(socket);
+  else _socket = defaultSocket();
+}
+
+//_____________________________________________________________________________
+/** Default socket path: $RDO_ENTROPYD_SOCKET, or privateSocket(). */
+std::string RdoDaemon::defaultSocket()
+{
+  const char* env = getenv("RDO_ENTROPYD_SOCKET");
+  if(env && strlen(env)!=0) return std::string(env);
+  return privateSocket();
+}
+
+//_____________________________________________________________________________
+/** Socket path in a directory of the user's own:
+    $XDG_RUNTIME_DIR/rdo-entropyd.sock, or /tmp/rdo-entropyd-[uid]/rdo-entropyd.sock.
+*/
+std::string RdoDaemon::privateSocket()
+{
+  const char* env = getenv("XDG_RUNTIME_DIR");
+  if(env && strlen(env)!=0) return std::string(env) + "/rdo-entropyd.sock";
+  return std::string("/tmp/rdo-entropyd-") + std::to_string((unsigned long)geteuid()) + "/rdo-entropyd.sock";
+}
+
+//_____________________________________________________________________________
+/** Check that the directory of a socket is a real directory owned by the
+    user and closed to everyone else (mode 0700); create it first if asked.
+    \return true if failed
+*/
+bool RdoDaemon::checkPrivateDir(const std::string& socket, bool create)
+{
+  size_t slash = socket.rfind('/');
+  std::string dir = (slash==std::string::npos) ? "." : (slash==0) ? "/" : socket.substr(0, slash);
+  if(create && mkdir(dir.c_str(), 0700)!=0 && errno!=EEXIST){
+    std::cerr << "Error: RdoDaemon::checkPrivateDir: Failed to create " << dir
+	      << ": " << strerror(errno) << std::endl;
+    return true;
+  }
+  struct stat st;
+  if(lstat(dir.c_str(), &st)!=0){
+    std::cerr << "Error: RdoDaemon::checkPrivateDir: " << dir << ": " << strerror(errno) << std::endl;
+    return true;
+  }
+  if(!S_ISDIR(st.st_mode) || st.st_uid!=geteuid() || (st.st_mode & 077)!=0){
+    std::cerr << "Error: RdoDaemon::checkPrivateDir: " << dir
+	      << " is not a directory of this user with mode 0700" << std::endl;
+    return true;
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Connect to the daemon.
+    \return true if failed
+*/
+bool RdoDaemon::connect()
+{
+  if(_fd >= 0) return false;
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(_socket.size() >= sizeof(addr.sun_path)){
+    std::cerr << "Error: RdoDaemon::connect: Socket path too long " << _socket << std::endl;
+    return true;
+  }
+  strcpy(addr.sun_path, _socket.c_str());
+  if(_socket==privateSocket() && checkPrivateDir(_socket)) return true;
+
+  _fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if(_fd < 0 || ::connect(_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0){
+    std::cerr << "Error: RdoDaemon::connect: Failed to connect to " << _socket
+	      << ": " << strerror(errno) << std::endl;
+    disconnect();
+    return true;
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Close the connection. */
+void RdoDaemon::disconnect()
+{
+  if(_fd >= 0) close(_fd);
+  _fd = -1;
+}
+
+//_____________________________________________________________________________
+/** Queue n random bytes. */
+unsigned int RdoDaemon::addBytes(uint32_t n)
+{
+  return addItem(kBytes, n, 0, 255);
+}
+
+//_____________________________________________________________________________
+/** Queue n random integers in [min,max]. */
+unsigned int RdoDaemon::addIntegers(uint32_t n, int64_t min, int64_t max)
+{
+  return addItem(kIntegers, n, min, max);
+}
+
+//_____________________________________________________________________________
+/** Queue n random fractions in [0,1) with 53 random bits each. */
+unsigned int RdoDaemon::addFractions(uint32_t n)
+{
+  return addItem(kFractions, n, 0, 0);
+}
+
+//_____________________________________________________________________________
+/** Queue an item. */
+unsigned int RdoDaemon::addItem(uint32_t type, uint32_t n, int64_t min, int64_t max)
+{
+  RdoDaemonItem item;
+  item.type = type;
+  item.n = n;
+  item.min = min;
+  item.max = max;
+  _items.push_back(item);
+  return _items.size() - 1;
+}
+
+//_____________________________________________________________________________
+/** Clear the queued requests. */
+void RdoDaemon::clearRequests()
+{
+  _items.clear();
+}
+
+//_____________________________________________________________________________
+/** Send the queued requests as one batch and read the results.
+    The queue is cleared. A connection the daemon closed while idle is
+    re-opened before sending; a batch is never sent twice, since the daemon
+    may have drawn its bytes before the reply was lost, so a connection
+    lost after sending fails the request.
+    \return true if failed
+*/
+bool RdoDaemon::request()
+{
+  _bytes.assign(_items.size(), std::vector<unsigned char>());
+  _integers.assign(_items.size(), std::vector<long int>());
+  _fractions.assign(_items.size(), std::vector<double>());
+  if(_items.empty()) return false;
+  if(_items.size() > kMaxItems){
+    std::cerr << "Error: RdoDaemon::request: Too many requests in batch (" << _items.size() << ")" << std::endl;
+    clearRequests();
+    return true;
+  }
+  uint64_t total = 0;
+  for(unsigned int k=0; k<_items.size(); k++) total += dataSize(_items[k]);
+  if(total > kMaxBytes){
+    std::cerr << "Error: RdoDaemon::request: Batch too large (" << total << " bytes, at most "
+	      << kMaxBytes << ")" << std::endl;
+    clearRequests();
+    return true;
+  }
+
+  RdoDaemonHeader head;
+  head.magic = kMagic;
+  head.status = 0;
+  head.nItems = _items.size();
+
+  // an idle connection has nothing to read: readable means closed (or out of step)
+  if(_fd >= 0){
+    struct pollfd pfd = {_fd, POLLIN, 0};
+    if(poll(&pfd, 1, 0)!=0) disconnect();
+  }
+
+  // send once
+  bool failed = connect() ||
+    writeAll(_fd, &head, sizeof(head)) ||
+    writeAll(_fd, &_items[0], _items.size() * sizeof(RdoDaemonItem)) ||
+    readAll(_fd, &head, sizeof(head));
+  if(failed){
+    disconnect();
+    std::cerr << "Error: RdoDaemon::request: Lost connection to " << _socket << std::endl;
+    clearRequests();
+    return true;
+  }
+  if(head.magic!=kMagic || head.status!=kOk || head.nItems!=_items.size()){
+    std::cerr << "Error: RdoDaemon::request: Daemon returned status " << head.status
+	      << (head.status==kUnavailable ? " (pool exhausted)" : "") << std::endl;
+    if(head.magic!=kMagic) disconnect();
+    clearRequests();
+    return true;
+  }
+
+  // data
+  for(unsigned int k=0; k<_items.size() && !failed; k++){
+    const RdoDaemonItem& item = _items[k];
+    if(item.type==kBytes){
+      _bytes[k].resize(item.n);
+      failed = readAll(_fd, _bytes[k].data(), item.n);
+    }
+    else if(item.type==kIntegers){
+      std::vector<int64_t> v(item.n);
+      failed = readAll(_fd, v.data(), item.n * sizeof(int64_t));
+      _integers[k].assign(v.begin(), v.end());
+    }
+    else if(item.type==kFractions){
+      _fractions[k].resize(item.n);
+      failed = readAll(_fd, _fractions[k].data(), item.n * sizeof(double));
+    }
+  }
+  clearRequests();
+  if(failed){
+    std::cerr << "Error: RdoDaemon::request: Truncated response from " << _socket << std::endl;
+    disconnect();
+  }
+  return failed;
+}
+
+//_____________________________________________________________________________
+/** Bytes of response data for an item: n bytes, or n int64_t integers or
+    doubles; 0 for an unknown type.
+*/
+uint64_t RdoDaemon::dataSize(const RdoDaemonItem& item)
+{
+  if(item.type==kBytes) return item.n;
+  if(item.type==kIntegers) return (uint64_t)item.n * sizeof(int64_t);
+  if(item.type==kFractions) return (uint64_t)item.n * sizeof(double);
+  return 0;
+}
+
+//_____________________________________________________________________________
+/** Write size bytes to a socket.
+    \return true if failed
+*/
+bool RdoDaemon::writeAll(int fd, const void* data, size_t size)
+{
+  const char* p = (const char*)data;
+  while(size > 0){
+    ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+    if(n < 0 && errno==EINTR) continue;
+    if(n <= 0) return true;
+    p += n;
+    size -= n;
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Read size bytes from a socket.
+    \return true if failed (or the peer closed the connection)
+*/
+bool RdoDaemon::readAll(int fd, void* data, size_t size)
+{
+  char* p = (char*)data;
+  while(size > 0){
+    ssize_t n = read(fd, p, size);
+    if(n < 0 && errno==EINTR) continue;
+    if(n <= 0) return true;
+    p += n;
+    size -= n;
+  }
+  return false;
+}
@@ -0,0 +1,192 @@
+/** \file RdoHealth.cxx
+    \brief Source for health tests class
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cmath>        // math functions
+#include "RdoHealth.hh"
+
+// false positive probability per sample for the RCT and APT (SP 800-90B allows 2^-20 to 2^-40)
+static const double kLog2Alpha = -40.;
+// one-sided normal quantile for the chi-square test (alpha ~ 1e-9)
+static const double kChiSquareZ = 6.0;
+// maximum number of chi-square frequency bins
+static const unsigned int kMaxBins = 256;
+// minimum expected count per chi-square bin
+static const unsigned int kMinPerBin = 5;
+
+//_____________________________________________________________________________
+/** Default constructor. */
+RdoHealth::RdoHealth()
+  : _nSymbols(0), _active(false), _n(0), _failed(false), _reason(""),
+    _rctLast(0), _rctCount(0), _rctCutoff(0),
+    _aptFirst(0), _aptIdx(0), _aptCount(0), _aptWindow(0), _aptCutoff(0),
+    _binScale(0), _binMul(0), _nBins(0), _bins(0), _chi2(0)
+{}
+
+//_____________________________________________________________________________
+/** Copy constructor. */
+RdoHealth::RdoHealth(const RdoHealth& other)
+  : _nSymbols(other._nSymbols), _active(other._active), _n(other._n),
+    _failed(other._failed), _reason(other._reason),
+    _rctLast(other._rctLast), _rctCount(other._rctCount), _rctCutoff(other._rctCutoff),
+    _aptFirst(other._aptFirst), _aptIdx(other._aptIdx), _aptCount(other._aptCount),
+    _aptWindow(other._aptWindow), _aptCutoff(other._aptCutoff),
+    _binScale(other._binScale), _binMul(other._binMul), _nBins(other._nBins), _bins(other._bins),
+    _chi2(other._chi2)
+{}
+
+//_____________________________________________________________________________
+/** Start a new block.
+    \param nSymbols number of possible (equally likely) symbols per sample
+    \param nExpected number of samples expected in the block (sets the chi-square binning)
+*/
+void RdoHealth::begin(double nSymbols, unsigned long nExpected)
+{
+  _nSymbols = nSymbols;
+  _n = 0;
+  _failed = false;
+  _reason = "";
+  _chi2 = 0;
+
+  // a single symbol carries no entropy: only the range checks of the caller apply
+  _active = (nSymbols >= 2.);
+  if(!_active){
+    _nBins = 0;
+    return;
+  }
+
+  // min-entropy per sample of a uniform source
+  double h = log2(nSymbols);
+
+  // repetition count test
+  _rctLast = ~0ULL;
+  _rctCount = 0;
+  _rctCutoff = rctCutoff(h);
+
+  // adaptive proportion test
+  _aptIdx = 0;
+  _aptCount = 0;
+  _aptWindow = (nSymbols < 2.5) ? 1024 : 512;
+  _aptCutoff = aptCutoff(h, _aptWindow);
+
+  // chi-square binning
+  double nb = kMaxBins;
+  if(nSymbols < nb) nb = floor(nSymbols);
+  if(nExpected/kMinPerBin < nb) nb = nExpected/kMinPerBin;
+  _nBins = (nb >= 2.) ? (unsigned int)nb : 0;
+  _binScale = _nBins / nSymbols;
+  _binMul = (unsigned long long)ldexp(_binScale, 63);
+  _bins.assign(_nBins * kLanes, 0);
+}
+
+//_____________________________________________________________________________
+/** Flag the block as failed; only the first reason is kept. */
+void RdoHealth::fail(const char* reason)
+{
+  if(!_failed){
+    _failed = true;
+    _reason = std::string(reason);
+  }
+}
+
+//_____________________________________________________________________________
+/** Finish the block and run the chi-square frequency test.
+    \return true if the block failed any of the tests
+*/
+bool RdoHealth::end()
+{
+  if(_n==0) fail("empty block");
+  if(_failed || !_active || _nBins==0) return _failed;
+
+  // chi-square on the bin frequencies
+  _chi2 = 0;
+  double lo = 0;
+  for(unsigned int b=0; b<_nBins; b++){
+    // first symbol of the next bin, consistent with bin() where symbols are exact
+    double hi = _nSymbols;
+    if(b+1 < _nBins){
+      hi = ceil((b+1) / _binScale);
+      if(_nSymbols < 4503599627370496.){
+	while(hi > 0 && bin((unsigned long long)hi - 1) > b) hi -= 1;
+	while(bin((unsigned long long)hi) <= b) hi += 1;
+      }
+    }
+    double expected = _n * (hi - lo) / _nSymbols;
+    lo = hi;
+    unsigned long count = 0;
+    for(unsigned int l=0; l<kLanes; l++) count += _bins[b*kLanes + l];
+    double diff = count - expected;
+    _chi2 += diff * diff / expected;
+  }
+  if(_chi2 > chiSquareCritical(_nBins-1)) fail("chi-square frequency test");
+
+  return _failed;
+}
+
+//_____________________________________________________________________________
+/** Repetition count test cutoff; SP 800-90B section 4.4.1.
+    \param entropy min-entropy per sample in bits
+*/
+unsigned int RdoHealth::rctCutoff(double entropy)
+{
+  return 1 + (unsigned int)ceil(-kLog2Alpha / entropy);
+}
+
+//_____________________________________________________________________________
+/** Adaptive proportion test cutoff; SP 800-90B section 4.4.2.
+    Smallest count of the first symbol in a window whose probability is below alpha.
+    \param entropy min-entropy per sample in bits
+    \param window window size
+*/
+unsigned int RdoHealth::aptCutoff(double entropy, unsigned int window)
+{
+  // the first sample is not counted by the binomial; B(window-1, p)
+  unsigned int n = window - 1;
+  double p = pow(2., -entropy);
+  double alpha = pow(2., kLog2Alpha);
+
+  // binomial probabilities by recurrence, up to where the upper tail is negligible
+  std::vector<double> pmf;
+  pmf.reserve(64);
+  pmf.push_back(exp(n * log1p(-p)));
+  double mean = n * p;
+  for(unsigned int k=0; k<n; k++){
+    double next = pmf[k] * (n-k) / (k+1.) * p / (1.-p);
+    if(k > mean && next < alpha * 1e-6) break;
+    pmf.push_back(next);
+  }
+
+  // sum the upper tail until it exceeds alpha
+  double tail = 0;
+  for(unsigned int k=pmf.size(); k-->0; ){
+    tail += pmf[k];
+    if(tail > alpha) return k + 2;
+  }
+  return 2;
+}
+
+//_____________________________________________________________________________
+/** Chi-square critical value (Wilson-Hilferty approximation).
+    \param dof degrees of freedom
+*/
+double RdoHealth::chiSquareCritical(unsigned int dof)
+{
+  double v = 2. / (9. * dof);
+  double c = 1. - v + kChiSquareZ * sqrt(v);
+  return dof * c * c * c;
+}
@@ -19,7 +19,12 @@
 */
 #include <stdlib.h>     // general utilities
 #include <iostream>     // for cout, cerr, clog
-#include <string.h>     // string handling functions (memset, strtok)
+#include <string.h>     // string handling functions (memset)
+#include "RdoHealth.hh"
+#include "RdoDaemon.hh"
+#include "RdoMetrics.hh"
+#include "RdoObserver.hh"
+#include "RdoRequest.hh"
 #include "RdoIntegers.hh"
 
 //_____________________________________________________________________________
@@ -27,8 +32,8 @@
 RdoIntegers::RdoIntegers()
   : RdoAbsObject(),
     _min(1), _max(1e4),
-    _base("10"), _columns(1),
-    _randData(0), _pos(0)
+    _base(10), _columns(1),
+    _randData(0), _size(0), _width(widthFor(1, 1e4)), _pos(0)
 {}
 
 //_____________________________________________________________________________
@@ -37,7 +42,8 @@ RdoIntegers::RdoIntegers(const RdoIntegers& other)
   : RdoAbsObject(other),
     _min(other._min), _max(other._max),
     _base(other._base), _columns(other._columns),
-    _randData(other._randData), _pos(other._pos)
+    _randData(other._randData), _size(other._size),
+    _width(other._width), _pos(other._pos)
 {}
 
 //_____________________________________________________________________________
@@ -45,6 +51,7 @@ RdoIntegers::RdoIntegers(const RdoIntegers& other)
 void RdoIntegers::setMin(long int min)
 {
   _min = min;
+  if(_size==0) _width = widthFor(_min, _max);
 }
 
 //_____________________________________________________________________________
@@ -52,6 +59,7 @@ void RdoIntegers::setMin(long int min)
 void RdoIntegers::setMax(long int max)
 {
   _max = max;
+  if(_size==0) _width = widthFor(_min, _max);
 }
 
 //_____________________________________________________________________________
@@ -70,17 +78,29 @@ void RdoIntegers::setBase(const char* base)
 {
   std::string b(base);
   if(b=="2" || b=="binary")
-    _base = "2";
+    _base = 2;
   else if(b=="8" || b=="octal")
-    _base = "8";
+    _base = 8;
   else if(b=="10" || b=="decimal")
-    _base = "10";
+    _base = 10;
   else if(b=="16" || b=="hexadecimal")
-    _base = "16";
+    _base = 16;
   else{
     std::cerr << "Error: RdoIntegers::setBase: Unkonwn base = " << base
 	      << " requested, using base = 10" << std::endl;
-    _base = "10";
+    _base = 10;
+  }
+}
+
+//_____________________________________________________________________________
+/** Base number system of each integer: "2", "8", "10" or "16". */
+const char* RdoIntegers::base() const
+{
+  switch(_base){
+  case 2:  return "2";
+  case 8:  return "8";
+  case 16: return "16";
+  default: return "10";
   }
 }
 
@@ -95,31 +115,151 @@ void RdoIntegers::setColumns(unsigned int columns)
 /** Build the URL for checking the quota. */
 void RdoIntegers::buildUrl()
 {
-  sprintf(_url,"%s://%s/integers/?format=%s&rnd=%s&num=%d&col=%d&min=%ld&max=%ld&base=%s", 
-	  scheme(), rdoUrl(), format(), randomization(), num(), columns(), min(), max(), base());
+  bool overflow = false;
+  RdoRequestBase::withBase<kRdoIntegers>(_base, [&](auto req){
+      overflow = decltype(req)::url(_url, kUrlSize, *this, _min, _max, _columns);
+    });
+  if(overflow)
+    std::cerr << "Error: RdoIntegers::buildUrl: Url longer than " << kUrlSize - 1
+	      << " characters, truncated" << std::endl;
 }
 
 //_____________________________________________________________________________
 /** Get a random integer from memory. */
 long int RdoIntegers::rndm()
 {
-  unsigned int dsize = _randData.size();
-  if(dsize==0){
-    std::cerr << "Warning: RdoIntegers::rndm: No data in memory" << std::endl;
-    return 0;
-  } 
-
-  long int val = 0;
-  if(_pos >= dsize){
+  if(_pos >= _size){
+    if(_size==0){
+      if(metrics()) metrics()->add(RdoMetrics::kEmpty);
+      if(observer()) observer()->cacheExhausted(*this, RdoObserver::now());
+      std::cerr << "Warning: RdoIntegers::rndm: No data in memory" << std::endl;
+      return 0;
+    }
+    if(metrics()) metrics()->add(RdoMetrics::kWraps);
+    if(observer()) observer()->cacheExhausted(*this, RdoObserver::now());
     std::cerr << "Warning: RdoIntegers::rndm: Exceeded random cache size, begining to repeat!" << std::endl;
     _pos = 0;
   }
-  val = _randData[_pos];	
+  long int val = RdoIntegerView::loadWord((const char*)_randData.data() + _pos * _width, _width);
   _pos++;
+  countDraw();
   
   return val;
 }
 
+//_____________________________________________________________________________
+/** Take the next n numbers from memory without copying, as a view that is
+    valid until the next download. Unlike rndm(), consume() does not wrap
+    around: at the end of the cache the view is shorter, or empty.
+*/
+RdoIntegerView RdoIntegers::consume(unsigned int n)
+{
+  unsigned int dsize = _size;
+  unsigned int first = (_pos < dsize) ? _pos : dsize;
+  unsigned int count = (n < dsize - first) ? n : dsize - first;
+  if(count < n){
+    if(dsize==0 && metrics()) metrics()->add(RdoMetrics::kEmpty);
+    if(observer()) observer()->cacheExhausted(*this, RdoObserver::now());
+  }
+  _pos = first + count;
+  countDraws(count);
+  return view().sub(first, count);
+}
+
+//_____________________________________________________________________________
+/** Take the numbers out of memory as long int, leaving it empty: a move if
+    they are stored 8 bytes wide, else a widened copy (and the narrow
+    storage is freed).
+*/
+std::vector<long int> RdoIntegers::cache() &&
+{
+  std::vector<long int> data;
+  if(_width==sizeof(long int)){
+    data.swap(_randData);
+    data.resize(_size);
+  }
+  else{
+    data = view().vector();
+    std::vector<long int>().swap(_randData);
+  }
+  clearData();
+  return data;
+}
+
+//_____________________________________________________________________________
+/** Bytes needed per integer for values in [min,max]: 1, 2, 4 or 8. */
+unsigned int RdoIntegers::widthFor(long int min, long int max)
+{
+  if(min >= INT8_MIN && max <= INT8_MAX) return 1;
+  if(min >= INT16_MIN && max <= INT16_MAX) return 2;
+  if(min >= INT32_MIN && max <= INT32_MAX) return 4;
+  return sizeof(long int);
+}
+
+//_____________________________________________________________________________
+/** Add a block of integers to memory, as narrow as the block and the
+    numbers already in memory allow; widens the numbers in memory if needed.
+*/
+void RdoIntegers::store(const std::vector<long int>& block)
+{
+  if(block.empty()) return;
+  long int lo = _min, hi = _max;
+  for(size_t k=0; k<block.size(); k++){
+    if(block[k] < lo) lo = block[k];
+    if(block[k] > hi) hi = block[k];
+  }
+  unsigned int width = widthFor(lo, hi);
+
+  if(_size==0) _width = width;
+  else if(width > _width){
+    // widen the numbers in memory
+    std::vector<long int> data = view().vector();
+    _size = 0;
+    _width = width;
+    append(data.data(), data.size());
+  }
+  append(block.data(), block.size());
+}
+
+//_____________________________________________________________________________
+//! narrow n values into dst, in fixed-length blocks the compiler vectorizes
+template<class T>
+static void Narrow(const long int* src, size_t n, T* dst)
+{
+  const size_t block = 16;
+  size_t k = 0;
+  for(; k + block <= n; k += block)
+    for(size_t j=0; j<block; j++) dst[k+j] = (T)src[k+j];
+  for(; k<n; k++) dst[k] = (T)src[k];
+}
+
+//_____________________________________________________________________________
+/** Append n values, which fit the current width, to the numbers in memory. */
+void RdoIntegers::append(const long int* values, size_t n)
+{
+  // a word more than the numbers fill: rndm() reads whole words
+  size_t size = _size + n;
+  _randData.resize((size * _width + sizeof(long int) - 1) / sizeof(long int) + 1);
+  char* p = (char*)_randData.data() + (size_t)_size * _width;
+  switch(_width){
+  case 1:  Narrow(values, n, (int8_t*)p); break;
+  case 2:  Narrow(values, n, (int16_t*)p); break;
+  case 4:  Narrow(values, n, (int32_t*)p); break;
+  default: memcpy(p, values, n * sizeof(long int)); break;
+  }
+  _size = size;
+}
+
+//_____________________________________________________________________________
+/** Drop the integers in memory (keeping the allocation for the next block). */
+void RdoIntegers::clearData()
+{
+  _randData.clear();
+  _size = 0;
+  _width = widthFor(_min, _max);
+  _pos = 0;
+}
+
 //_____________________________________________________________________________
 /** Parse the integers into memory. */
 void RdoIntegers::parseMemory(struct RdoAbsObject::CurlMem cMem)
@@ -136,14 +276,43 @@ void RdoIntegers::parseMemory(struct RdoAbsObject::CurlMem cMem)
     return;
   }
 
-  // parse the memory
-  char delim = '\n';
-  char* token = strtok(cMem.memory,&delim) ;
-  while(token){
-    _randData.push_back(strtol(token,NULL,atoi(base())));
-    token = strtok(0,&delim) ; 
-  }  
+  // health tests on this block
+  bool check = healthTests();
+  RdoHealth health;
+  if(check) health.begin(double(_max) - double(_min) + 1., expectedNum());
 
-  if(_randData.size()<num())
+  // parse the memory, with the parser for the base
+  std::vector<long int> block;
+  block.reserve(expectedNum());
+  RdoRequestBase::withBase<kRdoIntegers>(_base, [&](auto req){
+      decltype(req)::parse(cMem, _min, _max, block, check ? &health : 0);
+    });
+  if(check && block.size()!=expectedNum()) health.fail("count check");
+  if(check && health.end()){
+    rejectBlock("RdoIntegers::parseMemory", health.reason());
+    return;
+  }
+  store(block);
+
+  if(block.size()<expectedNum())
     std::cerr << "Warning: RdoIntegers::parseMemory: Parsed fewer numbers than downloaded" << std::endl;    
 }
+
+//_____________________________________________________________________________
+/** Get the integers from an rdo-entropyd daemon. 
+    \return true if operation failed
+*/
+bool RdoIntegers::fetchFromDaemon(RdoDaemon& daemon)
+{
+  unsigned int k = daemon.addIntegers(num(), min(), max());
+  if(daemon.request()) return true;
+  store(daemon.integers(k));
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Random bits a request costs: ceil(log2(range)) per integer. */
+unsigned long RdoIntegers::requestBits() const
+{
+  return (unsigned long)expectedNum() * bitsPerValue((double)_max - (double)_min + 1.);
+}
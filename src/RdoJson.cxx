@@ -0,0 +1,333 @@
+/** \file RdoJson.cxx
+    \brief Source for in-place JSON decoder class
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>     // general utilities
+#include <stdio.h>      // snprintf
+#include <string.h>     // string handling functions
+#include "RdoJson.hh"
+
+//_____________________________________________________________________________
+/** Default constructor. */
+RdoJson::RdoJson()
+  : _text(0), _tokens(0), _error("")
+{}
+
+//_____________________________________________________________________________
+/** Copy constructor; shares the (not owned) text buffer. */
+RdoJson::RdoJson(const RdoJson& other)
+  : _text(other._text), _tokens(other._tokens), _error(other._error)
+{}
+
+//_____________________________________________________________________________
+/** Record a parse error.
+    \return true (failed)
+*/
+bool RdoJson::fail(const char* what, size_t pos)
+{
+  char msg[128];
+  snprintf(msg, sizeof(msg), "%s at offset %lu", what, (unsigned long)pos);
+  _error = std::string(msg);
+  _tokens.clear();
+  return true;
+}
+
+//_____________________________________________________________________________
+/** Decode a mutable text buffer of length len; text[len] must be writable (e.g. a NUL).
+    \return true if the text is not valid JSON
+*/
+bool RdoJson::parse(char* text, size_t len)
+{
+  _text = text;
+  _tokens.clear();
+  _tokens.reserve(len / 8 + 1);
+  _error = "";
+
+  // open containers and their number of child tokens
+  std::vector<int> stack;
+  std::vector<int> nChild;
+
+  size_t pos = 0;
+  while(pos < len){
+    char c = text[pos];
+    if(c==' ' || c=='\t' || c=='\n' || c=='\r' || c==',' || c==':'){
+      pos++;
+      continue;
+    }
+
+    // closing a container
+    if(c=='}' || c==']'){
+      if(stack.empty()) return fail("unexpected closing bracket", pos);
+      Token& t = _tokens[stack.back()];
+      if((c=='}') != (t.type==kObject)) return fail("mismatched bracket", pos);
+      if(t.type==kObject && (nChild.back() % 2)) return fail("object key without value", pos);
+      t.end = pos + 1;
+      t.skip = (int)_tokens.size();
+      stack.pop_back();
+      nChild.pop_back();
+      pos++;
+      continue;
+    }
+
+    // a new token
+    if(stack.empty() && !_tokens.empty()) return fail("trailing characters", pos);
+    Token t;
+    t.size = 0;
+    t.skip = (int)_tokens.size() + 1;
+    if(c=='{' || c=='['){
+      t.type = (c=='{') ? kObject : kArray;
+      t.start = pos;
+      t.end = pos;
+      pos++;
+    }
+    else if(c=='"'){
+      t.type = kString;
+      t.start = ++pos;
+      while(pos < len && text[pos]!='"'){
+	if(text[pos]=='\\') pos++;
+	pos++;
+      }
+      if(pos >= len) return fail("unterminated string", t.start);
+      t.end = pos++;
+    }
+    else if(c=='-' || (c>='0' && c<='9') || c=='t' || c=='f' || c=='n'){
+      t.type = kPrimitive;
+      t.start = pos;
+      while(pos < len && text[pos]!=',' && text[pos]!=']' && text[pos]!='}' && text[pos]!=':' &&
+	    text[pos]!=' ' && text[pos]!='\t' && text[pos]!='\n' && text[pos]!='\r') pos++;
+      t.end = pos;
+    }
+    else return fail("unexpected character", pos);
+
+    // register with the parent container
+    if(!stack.empty()){
+      Token& parent = _tokens[stack.back()];
+      bool isKey = (parent.type==kObject && (nChild.back() % 2)==0);
+      if(isKey && t.type!=kString) return fail("object key is not a string", t.start);
+      if(parent.type==kArray || isKey) parent.size++;
+      nChild.back()++;
+    }
+    _tokens.push_back(t);
+    if(t.type==kObject || t.type==kArray){
+      stack.push_back((int)_tokens.size() - 1);
+      nChild.push_back(0);
+    }
+  }
+  if(!stack.empty()) return fail("unterminated container", len);
+  if(_tokens.empty()) return fail("empty document", 0);
+
+  // terminate strings and primitives in place
+  for(size_t k=0; k<_tokens.size(); k++){
+    Token& t = _tokens[k];
+    if(t.type==kString) t.end = unescape(t.start, t.end);
+    if(t.type==kString || t.type==kPrimitive) text[t.end] = '\0';
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Unescape the string [start,end) in place.
+    \return new end offset
+*/
+size_t RdoJson::unescape(size_t start, size_t end)
+{
+  // nothing to do without back-slashes
+  char* s = _text;
+  size_t r = start;
+  while(r < end && s[r]!='\\') r++;
+  size_t w = r;
+
+  while(r < end){
+    char c = s[r++];
+    if(c!='\\'){
+      s[w++] = c;
+      continue;
+    }
+    c = s[r++];
+    switch(c){
+    case 'b': s[w++] = '\b'; break;
+    case 'f': s[w++] = '\f'; break;
+    case 'n': s[w++] = '\n'; break;
+    case 'r': s[w++] = '\r'; break;
+    case 't': s[w++] = '\t'; break;
+    case 'u': {
+      if(r + 4 > end){ r = end; break; }
+      char hex[5] = {s[r], s[r+1], s[r+2], s[r+3], 0};
+      unsigned long cp = strtoul(hex, 0, 16);
+      r += 4;
+      // surrogate pair
+      if(cp >= 0xD800 && cp < 0xDC00 && r + 6 <= end && s[r]=='\\' && s[r+1]=='u'){
+	char lo[5] = {s[r+2], s[r+3], s[r+4], s[r+5], 0};
+	unsigned long cl = strtoul(lo, 0, 16);
+	if(cl >= 0xDC00 && cl < 0xE000){
+	  cp = 0x10000 + ((cp - 0xD800) << 10) + (cl - 0xDC00);
+	  r += 6;
+	}
+      }
+      // utf-8
+      if(cp < 0x80) s[w++] = (char)cp;
+      else if(cp < 0x800){
+	s[w++] = (char)(0xC0 | (cp >> 6));
+	s[w++] = (char)(0x80 | (cp & 0x3F));
+      }
+      else if(cp < 0x10000){
+	s[w++] = (char)(0xE0 | (cp >> 12));
+	s[w++] = (char)(0x80 | ((cp >> 6) & 0x3F));
+	s[w++] = (char)(0x80 | (cp & 0x3F));
+      }
+      else{
+	s[w++] = (char)(0xF0 | (cp >> 18));
+	s[w++] = (char)(0x80 | ((cp >> 12) & 0x3F));
+	s[w++] = (char)(0x80 | ((cp >> 6) & 0x3F));
+	s[w++] = (char)(0x80 | (cp & 0x3F));
+      }
+      break;
+    }
+    default: s[w++] = c; break; // '"', '\\' and '/'
+    }
+  }
+  return w;
+}
+
+//_____________________________________________________________________________
+/** Value of key in an object.
+    \return token index, or -1 if not found
+*/
+int RdoJson::find(int obj, const char* key) const
+{
+  if(type(obj)!=kObject) return -1;
+  int k = obj + 1;
+  for(int c=0; c<_tokens[obj].size; c++){
+    if(strcmp(str(k), key)==0) return k + 1;
+    k = _tokens[k+1].skip;
+  }
+  return -1;
+}
+
+//_____________________________________________________________________________
+/** Element idx of an array.
+    \return token index, or -1 if out of range
+*/
+int RdoJson::at(int arr, int idx) const
+{
+  if(type(arr)!=kArray || idx<0 || idx>=_tokens[arr].size) return -1;
+  int k = arr + 1;
+  for(int c=0; c<idx; c++) k = _tokens[k].skip;
+  return k;
+}
+
+//_____________________________________________________________________________
+/** Integer value of a primitive or string token. */
+long int RdoJson::asLong(int i, int base) const
+{
+  return strtol(str(i), 0, base);
+}
+
+//_____________________________________________________________________________
+/** Floating-point value of a primitive or string token. */
+double RdoJson::asDouble(int i) const
+{
+  return strtod(str(i), 0);
+}
+
+//_____________________________________________________________________________
+/** Boolean value of a primitive token. */
+bool RdoJson::asBool(int i) const
+{
+  return type(i)==kPrimitive && str(i)[0]=='t';
+}
+
+//_____________________________________________________________________________
+/** Is the token a null primitive (or missing)? */
+bool RdoJson::isNull(int i) const
+{
+  return type(i)==kNone || (type(i)==kPrimitive && str(i)[0]=='n');
+}
+
+//_____________________________________________________________________________
+/** Decode base64 text of length len in place.
+    \param decoded number of decoded bytes written to the start of text
+    \return true if text is not valid base64
+*/
+bool RdoJson::decodeBase64(char* text, size_t len, size_t* decoded)
+{
+  // reverse alphabet; 64 marks padding, 65 white space, 66 invalid
+  static const struct Table {
+    unsigned char v[256];
+    Table(){
+      const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+      memset(v, 66, sizeof(v));
+      for(int k=0; k<64; k++) v[(unsigned char)alphabet[k]] = k;
+      v[(unsigned char)'='] = 64;
+      v[(unsigned char)'\n'] = v[(unsigned char)'\r'] = 65;
+      v[(unsigned char)' '] = v[(unsigned char)'\t'] = 65;
+    }
+  } table;
+
+  unsigned char* s = reinterpret_cast<unsigned char*>(text);
+  size_t w = 0;
+  unsigned long acc = 0;
+  int nAcc = 0, nPad = 0;
+  for(size_t r=0; r<len; r++){
+    unsigned char v = table.v[s[r]];
+    if(v==65) continue;
+    if(v==66) return true;
+    if(v==64){ nPad++; continue; }
+    if(nPad) return true;
+    acc = (acc << 6) | v;
+    if(++nAcc == 4){
+      s[w++] = (unsigned char)(acc >> 16);
+      s[w++] = (unsigned char)(acc >> 8);
+      s[w++] = (unsigned char)acc;
+      acc = 0;
+      nAcc = 0;
+    }
+  }
+  // trailing partial quantum
+  if(nAcc==1 || nPad > 2) return true;
+  if(nAcc==2){
+    s[w++] = (unsigned char)(acc >> 4);
+  }
+  else if(nAcc==3){
+    s[w++] = (unsigned char)(acc >> 10);
+    s[w++] = (unsigned char)(acc >> 2);
+  }
+  *decoded = w;
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Append s as a quoted and escaped JSON string to out. */
+void RdoJson::quote(std::string& out, const char* s)
+{
+  out += '"';
+  for(; *s; s++){
+    unsigned char c = *s;
+    if(c=='"' || c=='\\'){
+      out += '\\';
+      out += c;
+    }
+    else if(c < 0x20){
+      char esc[8];
+      snprintf(esc, sizeof(esc), "\\u%04x", c);
+      out += esc;
+    }
+    else out += c;
+  }
+  out += '"';
+}
@@ -0,0 +1,304 @@
+/** \file RdoJsonRpc.cxx
+    \brief Source for JSON-RPC (api.random.org) class
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>     // general utilities
+#include <stdio.h>      // snprintf
+#include <iostream>     // for cout, cerr, clog
+#include <string.h>     // string handling functions
+#include <cmath>        // math functions
+#include "RdoJson.hh"
+#include "RdoHealth.hh"
+#include "RdoRequest.hh"
+#include "RdoJsonRpc.hh"
+
+//_____________________________________________________________________________
+/** Default constructor. */
+RdoJsonRpc::RdoJsonRpc()
+  : RdoAbsObject(),
+    _apiKey(""), _calls(0), _results(0),
+    _bitsLeft(-1), _requestsLeft(-1)
+{
+  setRdoUrl("api.random.org");
+  setInMemory(true);
+}
+
+//_____________________________________________________________________________
+/** Copy constructor. */
+RdoJsonRpc::RdoJsonRpc(const RdoJsonRpc& other)
+  : RdoAbsObject(other),
+    _apiKey(other._apiKey), _calls(other._calls), _results(other._results),
+    _bitsLeft(other._bitsLeft), _requestsLeft(other._requestsLeft)
+{}
+
+//_____________________________________________________________________________
+/** Set the api.random.org key used for all calls. */
+void RdoJsonRpc::setApiKey(const char* apiKey)
+{
+  _apiKey = std::string(apiKey);
+}
+
+//_____________________________________________________________________________
+/** Queue a call; results are reset. */
+unsigned int RdoJsonRpc::addCall(const Call& call)
+{
+  _calls.push_back(call);
+  _results.clear();
+  return _calls.size() - 1;
+}
+
+//_____________________________________________________________________________
+/** Queue a generateIntegers call for n integers in [min,max]. */
+unsigned int RdoJsonRpc::addIntegers(unsigned int n, long int min, long int max, bool replacement)
+{
+  char params[256];
+  snprintf(params, sizeof(params), "\"n\":%u,\"min\":%ld,\"max\":%ld,\"replacement\":%s",
+	   n, min, max, replacement ? "true" : "false");
+  Call call = {"generateIntegers", params, min, max, 0, 0, ""};
+  return addCall(call);
+}
+
+//_____________________________________________________________________________
+/** Queue a generateDecimalFractions call for n fractions in [0,1). */
+unsigned int RdoJsonRpc::addDecimalFractions(unsigned int n, unsigned int decimals, bool replacement)
+{
+  char params[256];
+  snprintf(params, sizeof(params), "\"n\":%u,\"decimalPlaces\":%u,\"replacement\":%s",
+	   n, decimals, replacement ? "true" : "false");
+  Call call = {"generateDecimalFractions", params, 0, 0, decimals, 0, ""};
+  return addCall(call);
+}
+
+//_____________________________________________________________________________
+/** Queue a generateStrings call for n strings of length characters. */
+unsigned int RdoJsonRpc::addStrings(unsigned int n, unsigned int length, const char* characters, bool replacement)
+{
+  char params[256];
+  snprintf(params, sizeof(params), "\"n\":%u,\"length\":%u,\"replacement\":%s,\"characters\":",
+	   n, length, replacement ? "true" : "false");
+  std::string p(params);
+  RdoJson::quote(p, characters);
+  Call call = {"generateStrings", p, 0, 0, 0, length, characters};
+  return addCall(call);
+}
+
+//_____________________________________________________________________________
+/** Queue a generateBlobs call for n blobs of size bits (a multiple of 8). */
+unsigned int RdoJsonRpc::addBlobs(unsigned int n, unsigned int bits)
+{
+  char params[256];
+  snprintf(params, sizeof(params), "\"n\":%u,\"size\":%u,\"format\":\"base64\"", n, bits);
+  Call call = {"generateBlobs", params, 0, 0, 0, bits/8, ""};
+  return addCall(call);
+}
+
+//_____________________________________________________________________________
+/** Remove all queued calls and their results. */
+void RdoJsonRpc::clearCalls()
+{
+  _calls.clear();
+  _results.clear();
+}
+
+//_____________________________________________________________________________
+/** Build the URL and the JSON-RPC request (a batch for more than one call). */
+void RdoJsonRpc::buildUrl()
+{
+  RdoUrlBuffer u(_url, kUrlSize);
+  u.put(scheme()).put("://").put(rdoUrl()).put("/json-rpc/4/invoke");
+
+  if(_calls.empty())
+    std::cerr << "Error: RdoJsonRpc::buildUrl: No calls queued" << std::endl;
+
+  _postData = "";
+  if(_calls.size() > 1) _postData += "[";
+  for(unsigned int k=0; k<_calls.size(); k++){
+    char id[32];
+    snprintf(id, sizeof(id), "%u", k);
+    if(k) _postData += ",";
+    _postData += "{\"jsonrpc\":\"2.0\",\"method\":\"" + _calls[k].method + "\",\"params\":{\"apiKey\":";
+    RdoJson::quote(_postData, apiKey());
+    _postData += "," + _calls[k].params + "},\"id\":" + id + "}";
+  }
+  if(_calls.size() > 1) _postData += "]";
+
+  // fresh results for this request
+  _results.assign(_calls.size(), RdoJsonRpcResult());
+  for(unsigned int k=0; k<_calls.size(); k++){
+    _results[k].method = _calls[k].method;
+    _results[k].done = false;
+    _results[k].errorCode = 0;
+    _results[k].bitsUsed = 0;
+    _results[k].advisoryDelay = 0;
+  }
+}
+
+//_____________________________________________________________________________
+/** Decode the JSON-RPC response(s) in place into the typed results. */
+void RdoJsonRpc::parseMemory(struct RdoAbsObject::CurlMem cMem)
+{
+  // check for some memory
+  if(cMem.size <= 0){
+    std::cerr << "Error: RdoJsonRpc::parseMemory: No data in memory" << std::endl;
+    return;
+  }
+
+  RdoJson json;
+  if(json.parse(cMem.memory, cMem.size)){
+    std::cerr << "Error: RdoJsonRpc::parseMemory: " << json.error() << std::endl;
+    rejectBlock("RdoJsonRpc::parseMemory", "JSON decoding");
+    return;
+  }
+
+  // single response or batch
+  int nResp = (json.type(0)==RdoJson::kArray) ? json.children(0) : 1;
+  int resp = (json.type(0)==RdoJson::kArray) ? json.first(0) : 0;
+  bool failed = false;
+  for(int r=0; r<nResp; r++, resp = json.next(resp)){
+    int idTok = json.find(resp, "id");
+    long int id = json.isNull(idTok) ? -1 : json.asLong(idTok);
+    if(id < 0 || id >= (long int)_calls.size()){
+      std::cerr << "Error: RdoJsonRpc::parseMemory: Response without a valid id" << std::endl;
+      failed = true;
+      continue;
+    }
+    const Call& call = _calls[id];
+    RdoJsonRpcResult& res = _results[id];
+    res.done = true;
+
+    // error response
+    int err = json.find(resp, "error");
+    if(err >= 0 && !json.isNull(err)){
+      res.errorCode = json.asLong(json.find(err, "code"));
+      res.error = std::string(json.str(json.find(err, "message")));
+      std::cerr << "Error: RdoJsonRpc::parseMemory: " << call.method.c_str() << " returned error "
+		<< res.errorCode << ": " << res.error.c_str() << std::endl;
+      failed = true;
+      continue;
+    }
+
+    // result
+    int result = json.find(resp, "result");
+    int data = json.find(json.find(result, "random"), "data");
+    if(json.type(data)!=RdoJson::kArray){
+      std::cerr << "Error: RdoJsonRpc::parseMemory: " << call.method.c_str() << " returned no data" << std::endl;
+      failed = true;
+      continue;
+    }
+    if(json.find(result, "bitsUsed") >= 0)      res.bitsUsed = json.asLong(json.find(result, "bitsUsed"));
+    if(json.find(result, "advisoryDelay") >= 0) res.advisoryDelay = json.asLong(json.find(result, "advisoryDelay"));
+    if(json.find(result, "bitsLeft") >= 0)      _bitsLeft = json.asLong(json.find(result, "bitsLeft"));
+    if(json.find(result, "requestsLeft") >= 0)  _requestsLeft = json.asLong(json.find(result, "requestsLeft"));
+
+    // typed data, with health tests
+    bool check = healthTests();
+    RdoHealth health;
+    int n = json.children(data);
+    int v = json.first(data);
+    if(call.method=="generateIntegers"){
+      if(check) health.begin(double(call.max) - double(call.min) + 1., n);
+      res.integers.reserve(n);
+      for(int k=0; k<n; k++, v = json.next(v)){
+	long int val = json.asLong(v);
+	if(check){
+	  if(json.type(v)!=RdoJson::kPrimitive){ health.fail("parse check"); break; }
+	  if(val<call.min || val>call.max){ health.fail("range check"); break; }
+	  health.fill((unsigned long long)(val - call.min));
+	}
+	res.integers.push_back(val);
+      }
+    }
+    else if(call.method=="generateDecimalFractions"){
+      double nSymbols = pow(10., (call.decimals<18) ? call.decimals : 18);
+      if(check) health.begin(nSymbols, n);
+      res.fractions.reserve(n);
+      for(int k=0; k<n; k++, v = json.next(v)){
+	double val = json.asDouble(v);
+	if(check){
+	  if(json.type(v)!=RdoJson::kPrimitive){ health.fail("parse check"); break; }
+	  if(!(val>=0. && val<=1.)){ health.fail("range check"); break; }
+	  double sym = floor(val * nSymbols + 0.5);
+	  if(sym >= nSymbols) sym = nSymbols - 1.;
+	  health.fill((unsigned long long)sym);
+	}
+	res.fractions.push_back(val);
+      }
+    }
+    else if(call.method=="generateStrings"){
+      int symbol[256];
+      for(int c=0; c<256; c++) symbol[c] = -1;
+      int nSymbols = 0;
+      for(unsigned int c=0; c<call.chars.size(); c++)
+	if(symbol[(unsigned char)call.chars[c]] < 0) symbol[(unsigned char)call.chars[c]] = nSymbols++;
+      if(check) health.begin(nSymbols, (unsigned long)n * call.size);
+      res.strings.reserve(n);
+      for(int k=0; k<n; k++, v = json.next(v)){
+	if(check){
+	  if(json.type(v)!=RdoJson::kString || json.length(v)!=call.size){ health.fail("length check"); break; }
+	  const char* s = json.str(v);
+	  for(unsigned int c=0; c<call.size; c++){
+	    int sym = symbol[(unsigned char)s[c]];
+	    if(sym < 0){ health.fail("alphabet check"); break; }
+	    health.fill(sym);
+	  }
+	  if(health.failed()) break;
+	}
+	res.strings.push_back(std::string(json.str(v), json.length(v)));
+      }
+    }
+    else if(call.method=="generateBlobs"){
+      if(check) health.begin(256., (unsigned long)n * call.size);
+      res.blobs.reserve(n);
+      for(int k=0; k<n; k++, v = json.next(v)){
+	size_t nBytes = 0;
+	char* s = const_cast<char*>(json.str(v));
+	if(RdoJson::decodeBase64(s, json.length(v), &nBytes)){
+	  health.fail("base64 decoding");
+	  break;
+	}
+	const unsigned char* b = reinterpret_cast<const unsigned char*>(s);
+	if(check){
+	  if(nBytes != call.size){ health.fail("length check"); break; }
+	  for(size_t c=0; c<nBytes; c++) health.fill(b[c]);
+	}
+	res.blobs.push_back(std::vector<unsigned char>(b, b + nBytes));
+      }
+    }
+
+    // reject this call's data if it failed
+    if((check && health.end()) || health.failed()){
+      res.integers.clear();
+      res.fractions.clear();
+      res.strings.clear();
+      res.blobs.clear();
+      res.error = std::string(health.reason());
+      char where[128];
+      snprintf(where, sizeof(where), "RdoJsonRpc::parseMemory: %s (call %ld)", call.method.c_str(), id);
+      rejectBlock(where, health.reason());
+    }
+  }
+
+  // every call must have been answered
+  for(unsigned int k=0; k<_results.size(); k++){
+    if(!_results[k].done){
+      std::cerr << "Error: RdoJsonRpc::parseMemory: No response to call " << k << std::endl;
+      failed = true;
+    }
+  }
+  if(failed) rejectBlock("RdoJsonRpc::parseMemory", "JSON-RPC response check");
+}
@@ -0,0 +1,248 @@
+/** \file RdoMetrics.cxx
+    \brief Source for metrics registry class
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>      // rename
+#include <string.h>     // strerror, strncmp
+#include <errno.h>      // errno
+#include <math.h>       // NAN, isnan
+#include <unistd.h>     // write, close
+#include <sys/socket.h> // socket
+#include <sys/un.h>     // sockaddr_un
+#include <iostream>     // for cout, cerr, clog
+#include <fstream>      // writeFile
+#include <sstream>      // text
+#include <iomanip>      // setprecision
+#include "RdoMetrics.hh"
+
+// names and help of the counters, gauges and histograms (in enum order)
+static const char* kCounterNames[][2] = {
+  {"rdo_requests_total",        "Transfers to random.org."},
+  {"rdo_request_failures_total","Failed transfers to random.org."},
+  {"rdo_downloaded_bytes_total","Bytes downloaded from random.org."},
+  {"rdo_cache_refills_total",   "Blocks added to in-memory caches."},
+  {"rdo_blocks_rejected_total", "Blocks rejected by the health tests."},
+  {"rdo_url_cache_hits_total",  "Downloads served by the URL cache."},
+  {"rdo_url_cache_misses_total","URL cache misses."},
+  {"rdo_daemon_fetches_total",  "In-memory refills from rdo-entropyd."},
+  {"rdo_rndm_total",            "Values drawn from in-memory caches."},
+  {"rdo_rndm_wraps_total",      "Draws past the end of a cache, beginning to repeat."},
+  {"rdo_rndm_empty_total",      "Draws from an empty cache."},
+  {"rdo_entropyd_served_bytes_total", "Bytes served to rdo-entropyd clients."}
+};
+static const char* kGaugeNames[][2] = {
+  {"rdo_quota_bits",            "Remaining random.org quota in bits, as last downloaded."},
+  {"rdo_entropyd_pool_bytes",   "Bytes in the rdo-entropyd pool."}
+};
+static const char* kHistNames[][2] = {
+  {"rdo_download_seconds",      "Time of whole transfers."},
+  {"rdo_first_byte_seconds",    "Time to the first response byte."},
+  {"rdo_parse_seconds",         "Time parsing downloaded blocks."}
+};
+// upper bucket edges in seconds; the last bucket is +Inf
+static const double kEdges[RdoMetrics::kBuckets-1] = {
+  1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2,
+  0.1, 0.25, 0.5, 1., 2.5, 5., 10., 30.
+};
+
+//_____________________________________________________________________________
+/** Default constructor; all zero, gauges unset. */
+RdoMetrics::RdoMetrics()
+{
+  reset();
+}
+
+//_____________________________________________________________________________
+/** Copy constructor; a snapshot of the other's values. */
+RdoMetrics::RdoMetrics(const RdoMetrics& other)
+{
+  reset();
+  for(unsigned int c=0; c<kNCounters; c++)
+    _counters[c][0].value.store(other.counter((Counter)c), std::memory_order_relaxed);
+  for(unsigned int g=0; g<kNGauges; g++) setGauge((Gauge)g, other.gauge((Gauge)g));
+  for(unsigned int h=0; h<kNHistograms; h++){
+    for(unsigned int k=0; k<kBuckets; k++)
+      _hists[h].buckets[k].store(other._hists[h].buckets[k].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    _hists[h].count.store(other._hists[h].count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    _hists[h].sumNs.store(other._hists[h].sumNs.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+}
+
+//_____________________________________________________________________________
+/** Add an observation (in seconds) to a histogram. */
+void RdoMetrics::observe(Histogram h, double seconds)
+{
+  if(seconds < 0.) seconds = 0.;
+  unsigned int k = 0;
+  while(k < kBuckets-1 && seconds > kEdges[k]) k++;
+  Hist& hist = _hists[h];
+  hist.buckets[k].fetch_add(1, std::memory_order_relaxed);
+  hist.count.fetch_add(1, std::memory_order_relaxed);
+  hist.sumNs.fetch_add((unsigned long long)(seconds * 1e9), std::memory_order_relaxed);
+}
+
+//_____________________________________________________________________________
+/** Value of a counter, summed over the shards. */
+unsigned long long RdoMetrics::counter(Counter c) const
+{
+  unsigned long long sum = 0;
+  for(unsigned int s=0; s<kShards; s++) sum += _counters[c][s].value.load(std::memory_order_relaxed);
+  return sum;
+}
+
+//_____________________________________________________________________________
+/** Number of observations of a histogram. */
+unsigned long long RdoMetrics::count(Histogram h) const
+{
+  return _hists[h].count.load(std::memory_order_relaxed);
+}
+
+//_____________________________________________________________________________
+/** Sum of the observations of a histogram, in seconds. */
+double RdoMetrics::sum(Histogram h) const
+{
+  return _hists[h].sumNs.load(std::memory_order_relaxed) * 1e-9;
+}
+
+//_____________________________________________________________________________
+/** Upper edge of histogram bucket k in seconds; infinite for the last. */
+double RdoMetrics::bucketEdge(unsigned int k)
+{
+  return (k < kBuckets-1) ? kEdges[k] : INFINITY;
+}
+
+//_____________________________________________________________________________
+/** All metrics in the Prometheus text exposition format (version 0.0.4);
+    gauges that were never set are left out.
+*/
+std::string RdoMetrics::text() const
+{
+  std::ostringstream os;
+  os << std::setprecision(10);
+  for(unsigned int c=0; c<kNCounters; c++){
+    os << "# HELP " << kCounterNames[c][0] << " " << kCounterNames[c][1] << "\n";
+    os << "# TYPE " << kCounterNames[c][0] << " counter\n";
+    os << kCounterNames[c][0] << " " << counter((Counter)c) << "\n";
+  }
+  for(unsigned int g=0; g<kNGauges; g++){
+    double v = gauge((Gauge)g);
+    if(isnan(v)) continue;
+    os << "# HELP " << kGaugeNames[g][0] << " " << kGaugeNames[g][1] << "\n";
+    os << "# TYPE " << kGaugeNames[g][0] << " gauge\n";
+    os << kGaugeNames[g][0] << " " << v << "\n";
+  }
+  for(unsigned int h=0; h<kNHistograms; h++){
+    const char* name = kHistNames[h][0];
+    os << "# HELP " << name << " " << kHistNames[h][1] << "\n";
+    os << "# TYPE " << name << " histogram\n";
+    unsigned long long cumulative = 0;
+    for(unsigned int k=0; k<kBuckets; k++){
+      cumulative += _hists[h].buckets[k].load(std::memory_order_relaxed);
+      os << name << "_bucket{le=\"";
+      if(k < kBuckets-1) os << kEdges[k];
+      else os << "+Inf";
+      os << "\"} " << cumulative << "\n";
+    }
+    os << name << "_sum " << sum((Histogram)h) << "\n";
+    os << name << "_count " << count((Histogram)h) << "\n";
+  }
+  return os.str();
+}
+
+//_____________________________________________________________________________
+/** Replace the file path with the metrics (written to path.tmp, then renamed,
+    so readers never see a partial file).
+    \return true if failed
+*/
+bool RdoMetrics::writeFile(const char* path) const
+{
+  std::string tmp = std::string(path) + ".tmp";
+  std::ofstream ofs(tmp.c_str());
+  if(!ofs.is_open()){
+    std::cerr << "Error: RdoMetrics::writeFile: Failed to open file " << tmp.c_str() << std::endl;
+    return true;
+  }
+  ofs << text();
+  ofs.close();
+  if(ofs.fail() || rename(tmp.c_str(), path)!=0){
+    std::cerr << "Error: RdoMetrics::writeFile: Failed to write " << path << ": " << strerror(errno) << std::endl;
+    return true;
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Write the metrics to a listening Unix domain socket, then close it.
+    \return true if failed
+*/
+bool RdoMetrics::sendTo(const char* socketPath) const
+{
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(strlen(socketPath) >= sizeof(addr.sun_path)){
+    std::cerr << "Error: RdoMetrics::sendTo: Socket path too long " << socketPath << std::endl;
+    return true;
+  }
+  strcpy(addr.sun_path, socketPath);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr))!=0){
+    std::cerr << "Error: RdoMetrics::sendTo: Failed to connect to " << socketPath << ": " << strerror(errno) << std::endl;
+    if(fd >= 0) close(fd);
+    return true;
+  }
+  std::string data = text();
+  size_t done = 0;
+  while(done < data.size()){
+    ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+    if(n < 0 && errno==EINTR) continue;
+    if(n <= 0){
+      std::cerr << "Error: RdoMetrics::sendTo: " << strerror(errno) << std::endl;
+      close(fd);
+      return true;
+    }
+    done += n;
+  }
+  close(fd);
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Write the metrics to "unix:/path/to/socket" (sendTo) or to a file (writeFile).
+    \return true if failed
+*/
+bool RdoMetrics::write(const char* where) const
+{
+  if(strncmp(where, "unix:", 5)==0) return sendTo(where + 5);
+  return writeFile(where);
+}
+
+//_____________________________________________________________________________
+/** Zero the counters and histograms and unset the gauges. */
+void RdoMetrics::reset()
+{
+  for(unsigned int c=0; c<kNCounters; c++)
+    for(unsigned int s=0; s<kShards; s++) _counters[c][s].value.store(0, std::memory_order_relaxed);
+  for(unsigned int g=0; g<kNGauges; g++) _gauges[g].store(NAN, std::memory_order_relaxed);
+  for(unsigned int h=0; h<kNHistograms; h++){
+    for(unsigned int k=0; k<kBuckets; k++) _hists[h].buckets[k].store(0, std::memory_order_relaxed);
+    _hists[h].count.store(0, std::memory_order_relaxed);
+    _hists[h].sumNs.store(0, std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,410 @@
+/** \file RdoMulti.cxx
+    \brief Source for concurrent transfers (curl_multi) class
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>     // for cout, cerr, clog
+#include <vector>       // poll set
+#include <errno.h>      // EINTR
+#include <poll.h>       // poll
+#include "RdoAbsObject.hh"
+#include "RdoRateLimiter.hh"
+#include "RdoMulti.hh"
+
+//_____________________________________________________________________________
+/** Default constructor. */
+RdoMulti::RdoMulti()
+  : _multi(0), _maxConnections(0),
+    _socketMode(false), _timerSet(false)
+{
+  RdoAbsObject::initCURL();
+  _multi = curl_multi_init();
+}
+
+//_____________________________________________________________________________
+/** Copy constructor; copies the settings, not the running transfers. */
+RdoMulti::RdoMulti(const RdoMulti& other)
+  : _multi(0), _maxConnections(0),
+    _socketMode(false), _timerSet(false)
+{
+  RdoAbsObject::initCURL();
+  _multi = curl_multi_init();
+  setMaxConnections(other._maxConnections);
+  if(other._socketMode) setSocketMode(other._onSocket, other._onTimer);
+}
+
+//_____________________________________________________________________________
+/** Destructor; abandons running and rate-limited transfers without calling
+    their callbacks.
+*/
+RdoMulti::~RdoMulti()
+{
+  // the caller's event loop may already be gone
+  _onSocket = SocketCallback();
+  _onTimer = TimerCallback();
+  for(std::map<CURL*, Transfer>::iterator it=_transfers.begin(); it!=_transfers.end(); ++it){
+    curl_multi_remove_handle(_multi, it->first);
+    it->second.obj->endTransfer(CURLE_ABORTED_BY_CALLBACK);
+  }
+  curl_multi_cleanup(_multi);
+}
+
+//_____________________________________________________________________________
+/** Limit the total number of open connections; further transfers queue. */
+void RdoMulti::setMaxConnections(long n)
+{
+  _maxConnections = n;
+  curl_multi_setopt(_multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, n);
+}
+
+//_____________________________________________________________________________
+/** Start a download of obj (to memory, its output file or std::cout, as
+    for downloadData); done is called when it finished. If the object's
+    rate limiter has no tokens for it now, the download waits in the loop
+    instead; a failure to start it then goes to done.
+    \return true if the download could not be started
+*/
+bool RdoMulti::add(RdoAbsObject& obj, Callback done)
+{
+  RdoRateLimiter* limiter = obj.rateLimiter();
+  if(!limiter) return start(obj, done, false, 0.);
+
+  // keep the order of the transfers behind the same limiter
+  bool behind = false;
+  for(std::deque<Deferred>::const_iterator it=_deferred.begin(); it!=_deferred.end(); ++it){
+    if(it->obj == &obj){
+      std::cerr << "Error: RdoMulti::add: Transfer already waiting" << std::endl;
+      return true;
+    }
+    if(it->limiter == limiter) behind = true;
+  }
+  if(!behind && limiter->tryAcquire(obj.requestBits())) return start(obj, done, true, 0.);
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point at = now;
+  if(!behind){
+    double wait = limiter->nextAvailable(obj.requestBits());
+    at += std::chrono::microseconds((long)(wait*1e6) + 1000);
+  }
+  Deferred d;
+  d.obj = &obj;
+  d.done = done;
+  d.limiter = limiter;
+  d.since = now;
+  bool rearm = _deferred.empty() || at < _retry;
+  _deferred.push_back(d);
+  if(rearm && !behind){
+    _retry = at;
+    if(_onTimer) _onTimer(timeoutMs());
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Start the download of obj on the multi session; the rate limiter's
+    tokens were already taken, after waiting seconds, if acquired.
+    \return true if the download could not be started
+*/
+bool RdoMulti::start(RdoAbsObject& obj, Callback done, bool acquired, double waited)
+{
+  CURL* cURL = obj.beginTransfer(acquired, waited);
+  if(!cURL) return true;
+
+  CURLMcode res = curl_multi_add_handle(_multi, cURL);
+  if(res != CURLM_OK){
+    std::cerr << "Error: RdoMulti::add: " << curl_multi_strerror(res) << std::endl;
+    obj.endTransfer(CURLE_FAILED_INIT);
+    return true;
+  }
+  Transfer& t = _transfers[cURL];
+  t.obj = &obj;
+  t.done = done;
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Drive the transfers without blocking and finish the completed ones.
+    \return number of transfers still running
+*/
+unsigned int RdoMulti::perform()
+{
+  if(_socketMode) return timeoutAction();
+  if(deferredMs()==0) startDeferred();
+  int running = 0;
+  curl_multi_perform(_multi, &running);
+  complete();
+  return pending();
+}
+
+//_____________________________________________________________________________
+/** Wait up to timeoutMs for activity on the transfers, then perform().
+    \return number of transfers still running
+*/
+unsigned int RdoMulti::wait(int timeoutMs)
+{
+  if(!pending()) return 0;
+  if(_socketMode) return waitSockets(timeoutMs);
+  long due = deferredMs();
+  if(due >= 0 && (timeoutMs < 0 || due < timeoutMs)) timeoutMs = (int)due;
+  int numfds = 0;
+  curl_multi_poll(_multi, 0, 0, timeoutMs, &numfds);
+  return perform();
+}
+
+//_____________________________________________________________________________
+/** Run the loop until all transfers (including ones added by callbacks) are
+    done, or for at most timeoutMs milliseconds if timeoutMs >= 0.
+    \return true if timed out
+*/
+bool RdoMulti::run(int timeoutMs)
+{
+  std::chrono::steady_clock::time_point deadline =
+    std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+  perform();
+  while(pending()){
+    int wait = 1000;
+    if(timeoutMs >= 0){
+      long left = std::chrono::duration_cast<std::chrono::milliseconds>
+	(deadline - std::chrono::steady_clock::now()).count();
+      if(left <= 0) return true;
+      if(left < wait) wait = (int)left;
+    }
+    this->wait(wait);
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Start the waiting transfers whose rate limiter now has tokens, in order
+    per limiter, and set the time of the next try for the others.
+*/
+void RdoMulti::startDeferred()
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::vector<Deferred> ready;
+  std::vector<double> waits;
+  std::vector<RdoRateLimiter*> blocked;
+  double next = -1.;
+  std::deque<Deferred>::iterator it = _deferred.begin();
+  while(it != _deferred.end()){
+    bool isBlocked = false;
+    for(unsigned int k=0; k<blocked.size(); k++) isBlocked |= (blocked[k] == it->limiter);
+    if(!isBlocked){
+      double waited = std::chrono::duration<double>(now - it->since).count();
+      unsigned long bits = it->obj->requestBits();
+      if(it->limiter->tryAcquire(bits, waited)){
+	ready.push_back(*it);
+	waits.push_back(waited);
+	it = _deferred.erase(it);
+	continue;
+      }
+      blocked.push_back(it->limiter);
+      double wait = it->limiter->nextAvailable(bits);
+      if(next < 0. || wait < next) next = wait;
+    }
+    ++it;
+  }
+  if(!_deferred.empty())
+    _retry = now + std::chrono::microseconds((long)(next*1e6) + 1000);
+
+  // a failure to start goes to the callback, which may add new transfers
+  for(unsigned int k=0; k<ready.size(); k++){
+    if(start(*ready[k].obj, ready[k].done, true, waits[k]) && ready[k].done)
+      ready[k].done(*ready[k].obj, true);
+  }
+}
+
+//_____________________________________________________________________________
+/** Milliseconds until the waiting transfers are tried again; 0 if overdue,
+    -1 if none wait.
+*/
+long RdoMulti::deferredMs() const
+{
+  if(_deferred.empty()) return -1;
+  long left = std::chrono::duration_cast<std::chrono::milliseconds>
+    (_retry - std::chrono::steady_clock::now()).count();
+  return left > 0 ? left : 0;
+}
+
+//_____________________________________________________________________________
+/** Finish the completed transfers: parse their data and call their callbacks. */
+void RdoMulti::complete()
+{
+  CURLMsg* msg = 0;
+  int left = 0;
+  while((msg = curl_multi_info_read(_multi, &left))){
+    if(msg->msg != CURLMSG_DONE) continue;
+    CURL* cURL = msg->easy_handle;
+    CURLcode res = msg->data.result;
+
+    std::map<CURL*, Transfer>::iterator it = _transfers.find(cURL);
+    if(it==_transfers.end()) continue;
+    Transfer t = it->second;
+    _transfers.erase(it);
+    curl_multi_remove_handle(_multi, cURL);
+
+    // the callback may add new transfers, even for the same object
+    bool failed = t.obj->endTransfer(res);
+    if(t.done) t.done(*t.obj, failed);
+  }
+}
+
+//_____________________________________________________________________________
+/** Switch to socket mode, for driving the loop from an external event loop.
+    onSocket is called whenever a socket must be watched for other events
+    or no longer (kRemove); onTimer whenever timeoutAction() must be called
+    after a delay (or, for -1, need not). Either may be empty and the state
+    polled with sockets() and timeoutMs() instead. run() and wait() still
+    work, with poll(2). Must be set while no transfer is running or waiting.
+    \return true if failed
+*/
+bool RdoMulti::setSocketMode(SocketCallback onSocket, TimerCallback onTimer)
+{
+  if(pending()){
+    std::cerr << "Error: RdoMulti::setSocketMode: transfers are running" << std::endl;
+    return true;
+  }
+  _onSocket = onSocket;
+  _onTimer = onTimer;
+  if(_socketMode) return false;
+  curl_multi_setopt(_multi, CURLMOPT_SOCKETFUNCTION, socketCallback);
+  curl_multi_setopt(_multi, CURLMOPT_SOCKETDATA, this);
+  curl_multi_setopt(_multi, CURLMOPT_TIMERFUNCTION, timerCallback);
+  curl_multi_setopt(_multi, CURLMOPT_TIMERDATA, this);
+  _socketMode = true;
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Milliseconds until timeoutAction() is due, for libCURL or the transfers
+    waiting for their rate limiter; 0 if overdue, -1 if none.
+*/
+long RdoMulti::timeoutMs() const
+{
+  long left = -1;
+  if(_timerSet){
+    left = std::chrono::duration_cast<std::chrono::milliseconds>
+      (_deadline - std::chrono::steady_clock::now()).count();
+    if(left < 0) left = 0;
+  }
+  long due = deferredMs();
+  if(due >= 0 && (left < 0 || due < left)) left = due;
+  return left;
+}
+
+//_____________________________________________________________________________
+/** Report events (kIn, kOut, kError) on a watched socket; finishes the
+    transfers that completed.
+    \return number of transfers still running
+*/
+unsigned int RdoMulti::socketAction(curl_socket_t fd, int events)
+{
+  int mask = 0;
+  if(events & kIn) mask |= CURL_CSELECT_IN;
+  if(events & kOut) mask |= CURL_CSELECT_OUT;
+  if(events & kError) mask |= CURL_CSELECT_ERR;
+  int running = 0;
+  CURLMcode res = curl_multi_socket_action(_multi, fd, mask, &running);
+  if(res != CURLM_OK)
+    std::cerr << "Error: RdoMulti::socketAction: " << curl_multi_strerror(res) << std::endl;
+  complete();
+  return pending();
+}
+
+//_____________________________________________________________________________
+/** Report that the time-out requested by the loop expired: start the
+    transfers whose rate limiter has tokens now and let libCURL act on
+    its own time-out.
+    \return number of transfers still running
+*/
+unsigned int RdoMulti::timeoutAction()
+{
+  bool retry = (deferredMs()==0);
+  bool curlDue = _timerSet && _deadline <= std::chrono::steady_clock::now();
+  if(retry) startDeferred();
+  if(curlDue || !retry){
+    _timerSet = false;
+    socketAction(CURL_SOCKET_TIMEOUT, 0);
+  }
+  if(_onTimer && (retry || !_deferred.empty())) _onTimer(timeoutMs());
+  return pending();
+}
+
+//_____________________________________________________________________________
+/** Socket mode wait(): poll the watched sockets until activity, the loop's
+    time-out or timeoutMs, and act on what happened.
+    \return number of transfers still running
+*/
+unsigned int RdoMulti::waitSockets(int timeoutMs)
+{
+  long due = this->timeoutMs();
+  int wait = timeoutMs;
+  if(due >= 0 && (wait < 0 || due < wait)) wait = (int)due;
+
+  std::vector<struct pollfd> fds;
+  for(std::map<curl_socket_t, int>::const_iterator it=_sockets.begin(); it!=_sockets.end(); ++it){
+    struct pollfd pfd;
+    pfd.fd = it->first;
+    pfd.events = ((it->second & kIn) ? POLLIN : 0) | ((it->second & kOut) ? POLLOUT : 0);
+    pfd.revents = 0;
+    fds.push_back(pfd);
+  }
+  if(fds.empty() && wait < 0) wait = 1000;
+
+  int n = poll(fds.empty() ? 0 : &fds[0], fds.size(), wait);
+  if(n < 0 && errno != EINTR){
+    std::cerr << "Error: RdoMulti::waitSockets: poll failed" << std::endl;
+    return pending();
+  }
+  for(unsigned int k=0; n>0 && k<fds.size(); k++){
+    if(!fds[k].revents) continue;
+    int events = 0;
+    if(fds[k].revents & (POLLIN | POLLHUP)) events |= kIn;
+    if(fds[k].revents & POLLOUT) events |= kOut;
+    if(fds[k].revents & (POLLERR | POLLNVAL)) events |= kError;
+    socketAction(fds[k].fd, events);
+  }
+  if(this->timeoutMs()==0) timeoutAction();
+  return pending();
+}
+
+//_____________________________________________________________________________
+/** libCURL socket callback: record the socket's events, tell the caller. */
+int RdoMulti::socketCallback(CURL* /*cURL*/, curl_socket_t fd, int what, void* multi, void* /*socketp*/)
+{
+  RdoMulti* self = (RdoMulti*)multi;
+  int events = kRemove;
+  if(what == CURL_POLL_REMOVE) self->_sockets.erase(fd);
+  else {
+    events = ((what & CURL_POLL_IN) ? kIn : 0) | ((what & CURL_POLL_OUT) ? kOut : 0);
+    self->_sockets[fd] = events;
+  }
+  if(self->_onSocket) self->_onSocket(fd, events);
+  return 0;
+}
+
+//_____________________________________________________________________________
+/** libCURL timer callback: record the time-out, tell the caller. */
+int RdoMulti::timerCallback(CURLM* /*cURLM*/, long ms, void* multi)
+{
+  RdoMulti* self = (RdoMulti*)multi;
+  self->_timerSet = (ms >= 0);
+  if(ms >= 0) self->_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+  // the waiting transfers share the caller's timer
+  if(self->_onTimer) self->_onTimer(self->_deferred.empty() ? ms : self->timeoutMs());
+  return 0;
+}
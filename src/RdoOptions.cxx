@@ -26,10 +26,12 @@
 RdoOptions::RdoOptions()
   : help(false), pLevel(0),
     agent("libcurl-agent"), useHTTPS(true),
-    proxy(""), proxyType(""),
+    proxy(""), proxyType(""), timeout(120),
+    host("www.random.org"), socket(""), pool(1<<20), metrics(""), trace(""),
     outFile(""), append(false),
-    format("plain"), rnd("new"), columns(1), num(10),
-    type(""), quota(false), ip(""),
+    format("plain"), outFormat(""), rnd("new"), columns(1), num(10),
+    type(""), input(""), stream(false), limit(0), workers(2), requests(100), reportFormat("table"),
+    quota(false), ip(""),
     min(1), max(1e4), base("10"),
     length(8), digits(false), upper(false), lower(true), unique(false)
 {}
@@ -39,10 +41,12 @@ RdoOptions::RdoOptions()
 RdoOptions::RdoOptions(int argc, char** argv)
   : help(false), pLevel(0),
     agent("libcurl-agent"), useHTTPS(true),
-    proxy(""), proxyType(""),
+    proxy(""), proxyType(""), timeout(120),
+    host("www.random.org"), socket(""), pool(1<<20), metrics(""), trace(""),
     outFile(""), append(false),
-    format("plain"), rnd("new"), columns(1), num(10),
-    type(""), quota(false), ip(""),
+    format("plain"), outFormat(""), rnd("new"), columns(1), num(10),
+    type(""), input(""), stream(false), limit(0), workers(2), requests(100), reportFormat("table"),
+    quota(false), ip(""),
     min(1), max(1e4), base("10"),
     length(8), digits(false), upper(false), lower(true), unique(false)
 {
@@ -54,10 +58,13 @@ RdoOptions::RdoOptions(int argc, char** argv)
 RdoOptions::RdoOptions(const RdoOptions& other)
   : help(other.help), pLevel(other.pLevel),
     agent(other.agent), useHTTPS(other.useHTTPS),
-    proxy(other.proxy), proxyType(other.proxyType),
+    proxy(other.proxy), proxyType(other.proxyType), timeout(other.timeout),
+    host(other.host), socket(other.socket), pool(other.pool), metrics(other.metrics), trace(other.trace),
     outFile(other.outFile), append(other.append),
-    format(other.format), rnd(other.rnd), columns(other.columns), num(other.num),
-    type(other.type), quota(other.quota), ip(other.ip),
+    format(other.format), outFormat(other.outFormat), rnd(other.rnd), columns(other.columns), num(other.num),
+    type(other.type), input(other.input), stream(other.stream), limit(other.limit), workers(other.workers), requests(other.requests),
+    reportFormat(other.reportFormat),
+    quota(other.quota), ip(other.ip),
     min(other.min), max(other.max), base(other.base),
     length(other.length), digits(other.digits), upper(other.upper), 
     lower(other.lower), unique(other.unique)
@@ -80,13 +87,24 @@ void RdoOptions::parseCmdLine(int argc, char** argv)
       {"proxy",        required_argument, 0, 'x'},
       {"proxy-type",   required_argument, 0, 'y'},
       {"time-out",     required_argument, 0, 't'},
+      {"host",         required_argument, 0, 'H'},
+      {"socket",       required_argument, 0, 'U'},
+      {"pool",         required_argument, 0, 'P'},
+      {"metrics",      required_argument, 0, 'M'},
+      {"trace",        required_argument, 0, 'T'},
 
       {"out-file",     required_argument, 0, 'o'},
       {"append",       no_argument,       0, 'a'},
       {"format",       required_argument, 0, 'f'},
+      {"out-format",   required_argument, 0, 'O'},
       {"rnd",          required_argument, 0, 'r'},
       {"columns",      required_argument, 0, 'c'},
       {"number",       required_argument, 0, 'n'},
+      {"stream",       no_argument,       0, 'e'},
+      {"limit",        required_argument, 0, 'L'},
+      {"workers",      required_argument, 0, 'W'},
+      {"requests",     required_argument, 0, 'R'},
+      {"report-format",required_argument, 0, 'F'},
 
       {"quota",        no_argument,       0, 'Q'},
       {"ip",           required_argument, 0, 'w'},
@@ -109,11 +127,13 @@ void RdoOptions::parseCmdLine(int argc, char** argv)
   // getopt_long stores the option index here.
   int option_index(0);
   int option_char(-1);
+  // restart the scan (options may be parsed more than once)
+  optind = 0;
 
   // begin reading options
   while(1){
     // '' = no argument, ':' = required argument, '::' = optional argument
-    option_char = getopt_long(argc, argv, "h?p:g:Xx:y:t:o:af:r:c:n:Qw:l:u:b:s:djkq", 
+    option_char = getopt_long(argc, argv, "h?p:g:Xx:y:t:H:U:P:M:T:o:af:O:r:c:n:eL:W:R:F:Qw:l:u:b:s:djkq", 
 			      long_options, &option_index);
     
     if(option_char==-1) break;   // Detect the end of the options.
@@ -127,14 +147,25 @@ void RdoOptions::parseCmdLine(int argc, char** argv)
     case 'x': proxy = std::string(optarg); break;
     case 'y': proxyType = std::string(optarg); break;
     case 't': timeout = atoi(optarg); break;
+    case 'H': host = std::string(optarg); break;
+    case 'U': socket = std::string(optarg); break;
+    case 'P': pool = atol(optarg); break;
+    case 'M': metrics = std::string(optarg); break;
+    case 'T': trace = std::string(optarg); break;
 
     case 'o': outFile = std::string(optarg); break;
     case 'a': append = true; break;
 
     case 'f': format = std::string(optarg); break;
+    case 'O': outFormat = std::string(optarg); break;
     case 'r': rnd = std::string(optarg); break;
     case 'c': columns = atol(optarg); break;
     case 'n': num = atol(optarg); break;
+    case 'e': stream = true; break;
+    case 'L': limit = strtoull(optarg, 0, 10); break;
+    case 'W': workers = atoi(optarg); break;
+    case 'R': requests = atol(optarg); break;
+    case 'F': reportFormat = std::string(optarg); break;
 
     case 'Q': quota = true; break;
     case 'w': ip = std::string(optarg); break;
@@ -155,8 +186,11 @@ void RdoOptions::parseCmdLine(int argc, char** argv)
     } // end option switch
   } // end while (read opts)
 
-  // first non-option is taken as type
+  // first non-option is taken as type, the second as input file
   if(optind < argc){
     type = std::string(argv[optind++]);
   }
+  if(optind < argc){
+    input = std::string(argv[optind++]);
+  }
 }
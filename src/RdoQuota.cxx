@@ -18,6 +18,9 @@
     along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdlib.h>
+#include <iostream>
+#include "RdoMetrics.hh"
+#include "RdoRequest.hh"
 #include "RdoQuota.hh"
 
 //_____________________________________________________________________________
@@ -45,18 +48,19 @@ void RdoQuota::setIP(const char* ip)
 /** Build the URL for checking the quota. */
 void RdoQuota::buildUrl()
 {
-  if(_ip!="")
-    sprintf(_url,"%s://%s/quota/?format=%s&ip=%s", 
-	    scheme(), rdoUrl(), format(), ip());
-  else
-    sprintf(_url,"%s://%s/quota/?format=%s", 
-	    scheme(), rdoUrl(), format());    
+  if(RdoRequest<kRdoQuota>::url(_url, kUrlSize, *this, ip()))
+    std::cerr << "Error: RdoQuota::buildUrl: Url longer than " << kUrlSize - 1
+	      << " characters, truncated" << std::endl;
 }
 
 //_____________________________________________________________________________
 /** Parse the quota into memory. */
 void RdoQuota::parseMemory(struct RdoAbsObject::CurlMem cMem)
 {
-  if(cMem.size > 0)
-    _remainingBits = atol(&cMem.memory[0]);
+  long int bits = 0;
+  if(cMem.size > 0){
+    RdoRequest<kRdoQuota>::parse(cMem, bits);
+    _remainingBits = bits;
+  }
+  if(cMem.size > 0 && metrics()) metrics()->setGauge(RdoMetrics::kQuotaBits, _remainingBits);
 }
@@ -19,8 +19,13 @@
 */
 #include <stdlib.h>     // general utilities
 #include <iostream>     // for cout, cerr, clog
-#include <string.h>     // string handling functions (memset, strtok)
+#include <string.h>     // string handling functions (memset)
 #include <cmath>        // math functions
+#include "RdoHealth.hh"
+#include "RdoDaemon.hh"
+#include "RdoMetrics.hh"
+#include "RdoObserver.hh"
+#include "RdoRequest.hh"
 #include "RdoRandom.hh"
 
 //_____________________________________________________________________________
@@ -57,8 +62,9 @@ void RdoRandom::setColumns(unsigned int columns)
 /** Build the URL for checking the quota. */
 void RdoRandom::buildUrl()
 {
-  sprintf(_url,"%s://%s/decimal-fractions/?format=%s&rnd=%s&num=%d&col=%d&dec=%d", 
-	  scheme(), rdoUrl(), format(), randomization(), num(), columns(), decimals());
+  if(RdoRequest<kRdoFractions>::url(_url, kUrlSize, *this, decimals(), columns()))
+    std::cerr << "Error: RdoRandom::buildUrl: Url longer than " << kUrlSize - 1
+	      << " characters, truncated" << std::endl;
 }
 
 //_____________________________________________________________________________
@@ -67,21 +73,45 @@ double RdoRandom::rndm()
 {
   unsigned int dsize = _randData.size();
   if(dsize==0){
+    if(metrics()) metrics()->add(RdoMetrics::kEmpty);
+    if(observer()) observer()->cacheExhausted(*this, RdoObserver::now());
     std::cerr << "Warning: RdoRandom::rndm: No data in memory" << std::endl;
     return 0;
   } 
 
   double val = 0;
   if(_pos >= dsize){
+    if(metrics()) metrics()->add(RdoMetrics::kWraps);
+    if(observer()) observer()->cacheExhausted(*this, RdoObserver::now());
     std::cerr << "Warning: RdoRandom::rndm: Exceeded random cache size, begining to repeat!" << std::endl;
     _pos = 0;
   }
   val = _randData[_pos];	
   _pos++;
+  countDraw();
   
   return val;
 }
 
+//_____________________________________________________________________________
+/** Take the next n numbers from memory without copying, as a view that is
+    valid until the next download. Unlike rndm(), consume() does not wrap
+    around: at the end of the cache the view is shorter, or empty.
+*/
+RdoCacheView<double> RdoRandom::consume(unsigned int n)
+{
+  unsigned int dsize = _randData.size();
+  unsigned int first = (_pos < dsize) ? _pos : dsize;
+  unsigned int count = (n < dsize - first) ? n : dsize - first;
+  if(count < n){
+    if(dsize==0 && metrics()) metrics()->add(RdoMetrics::kEmpty);
+    if(observer()) observer()->cacheExhausted(*this, RdoObserver::now());
+  }
+  _pos = first + count;
+  countDraws(count);
+  return RdoCacheView<double>(_randData.data() + first, count);
+}
+
 //_____________________________________________________________________________
 /** Parse the integers into memory. */
 void RdoRandom::parseMemory(struct RdoAbsObject::CurlMem cMem)
@@ -98,14 +128,46 @@ void RdoRandom::parseMemory(struct RdoAbsObject::CurlMem cMem)
     return;
   }
 
+  // health tests on this block; fractions are symbols in [0,10^decimals)
+  bool check = healthTests();
+  RdoHealth health;
+  double nSymbols = pow(10., (decimals()<18) ? decimals() : 18);
+  if(check) health.begin(nSymbols, num());
+
   // parse the memory
-  char delim = '\n';
-  char* token = strtok(cMem.memory,&delim) ;
-  while(token){
-    _randData.push_back(atof(token));
-    token = strtok(0,&delim) ; 
-  }  
-
-  if(_randData.size()<num())
+  std::vector<double> block;
+  block.reserve(num());
+  RdoRequest<kRdoFractions>::parse(cMem, nSymbols, block, check ? &health : 0);
+  if(check && block.size()!=num()) health.fail("count check");
+  if(check && health.end()){
+    rejectBlock("RdoRandom::parseMemory", health.reason());
+    return;
+  }
+  _randData.insert(_randData.end(), block.begin(), block.end());
+
+  if(block.size()<num())
     std::cerr << "Warning: RdoRandom::parseMemory: Parsed fewer numbers than downloaded" << std::endl;    
 }
+
+//_____________________________________________________________________________
+/** Get the fractions from an rdo-entropyd daemon; 
+    uniform integers in [0,10^decimals) scaled to [0,1).
+    \return true if operation failed
+*/
+bool RdoRandom::fetchFromDaemon(RdoDaemon& daemon)
+{
+  long int scale = 1;
+  for(unsigned int d=0; d<decimals() && d<18; d++) scale *= 10;
+  unsigned int k = daemon.addIntegers(num(), 0, scale - 1);
+  if(daemon.request()) return true;
+  const std::vector<long int>& data = daemon.integers(k);
+  for(unsigned int i=0; i<data.size(); i++) _randData.push_back((double)data[i] / (double)scale);
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Random bits a request costs: ceil(log2(10^decimals)) per fraction. */
+unsigned long RdoRandom::requestBits() const
+{
+  return (unsigned long)num() * bitsPerValue(pow(10., (double)_decimals));
+}
@@ -0,0 +1,238 @@
+/** \file RdoRateLimiter.cxx
+    \brief Source for client-side rate limiter class
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>       // ldexp
+#include <iomanip>      // setw
+#include "RdoRateLimiter.hh"
+
+//_____________________________________________________________________________
+/** Default constructor; one request per second, bits unlimited. */
+RdoRateLimiter::RdoRateLimiter(double requestsPerSec, double bitsPerSec)
+  : _last(Clock::now()), _nextTicket(0), _serving(0),
+    _nRequests(0), _totalWait(0.), _maxWait(0.), _hist(kBins, 0)
+{
+  _requests.rate = _requests.capacity = _requests.tokens = 0.;
+  _bits.rate = _bits.capacity = _bits.tokens = 0.;
+  setRequestRate(requestsPerSec);
+  setBitRate(bitsPerSec);
+}
+
+//_____________________________________________________________________________
+/** Copy constructor; copies the rates, with full buckets and no statistics. */
+RdoRateLimiter::RdoRateLimiter(const RdoRateLimiter& other)
+  : _last(Clock::now()), _nextTicket(0), _serving(0),
+    _nRequests(0), _totalWait(0.), _maxWait(0.), _hist(kBins, 0)
+{
+  _requests.rate = _requests.capacity = _requests.tokens = 0.;
+  _bits.rate = _bits.capacity = _bits.tokens = 0.;
+  setRequestRate(other.requestRate(), other.requestBurst());
+  setBitRate(other.bitRate(), other.bitBurst());
+}
+
+//_____________________________________________________________________________
+/** Set the request rate (per second; 0 for unlimited) and the largest burst
+    of requests (at least 1). The bucket starts full.
+*/
+void RdoRateLimiter::setRequestRate(double perSec, double burst)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  refill(Clock::now());
+  _requests.rate = perSec > 0. ? perSec : 0.;
+  _requests.capacity = burst > 1. ? burst : 1.;
+  _requests.tokens = _requests.capacity;
+  _cv.notify_all();
+}
+
+//_____________________________________________________________________________
+/** Set the bit rate (per second; 0 for unlimited) and the largest burst of
+    bits (0 for one second's worth). The bucket starts full.
+*/
+void RdoRateLimiter::setBitRate(double perSec, double burst)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  refill(Clock::now());
+  _bits.rate = perSec > 0. ? perSec : 0.;
+  _bits.capacity = burst > 0. ? burst : _bits.rate;
+  _bits.tokens = _bits.capacity;
+  _cv.notify_all();
+}
+
+//_____________________________________________________________________________
+/** Wait, in arrival order with the other callers, until a request of the
+    given number of random bits may be sent, and take its tokens.
+    \return seconds waited
+*/
+double RdoRateLimiter::acquire(unsigned long bits)
+{
+  Clock::time_point start = Clock::now();
+  std::unique_lock<std::mutex> lock(_mutex);
+
+  // queue for the turn
+  unsigned long ticket = _nextTicket++;
+  while(_serving != ticket) _cv.wait(lock);
+
+  // at the head: sleep until both buckets hold enough
+  for(;;){
+    refill(Clock::now());
+    double wait = deficit(_requests, 1.);
+    double waitBits = deficit(_bits, (double)bits);
+    if(waitBits > wait) wait = waitBits;
+    if(wait <= 0.) break;
+    _cv.wait_for(lock, std::chrono::duration<double>(wait));
+  }
+  double waited = std::chrono::duration<double>(Clock::now() - start).count();
+  take(bits, waited);
+
+  // the next in line
+  _serving++;
+  _cv.notify_all();
+  return waited;
+}
+
+//_____________________________________________________________________________
+/** Take the tokens of a request of the given number of random bits if both
+    buckets hold enough now and no acquire() is queued; never waits. waited
+    is the time the caller already put the request off, for the statistics.
+    \return true if the tokens were taken
+*/
+bool RdoRateLimiter::tryAcquire(unsigned long bits, double waited)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  if(_serving != _nextTicket) return false;
+  refill(Clock::now());
+  if(deficit(_requests, 1.) > 0. || deficit(_bits, (double)bits) > 0.) return false;
+  take(bits, waited);
+  return true;
+}
+
+//_____________________________________________________________________________
+/** Seconds until both buckets hold the tokens of a request of the given
+    number of random bits (0 if they do now), not counting queued acquire()s.
+*/
+double RdoRateLimiter::nextAvailable(unsigned long bits) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  refill(Clock::now());
+  double wait = deficit(_requests, 1.);
+  double waitBits = deficit(_bits, (double)bits);
+  return (waitBits > wait) ? waitBits : wait;
+}
+
+//_____________________________________________________________________________
+/** Lower edge (in seconds) of a wait histogram bin: 0, 1 ms, 2 ms, 4 ms, ... */
+double RdoRateLimiter::binEdge(unsigned int bin)
+{
+  if(bin==0) return 0.;
+  return ldexp(1e-3, bin-1);
+}
+
+//_____________________________________________________________________________
+/** Number of requests served. */
+unsigned long RdoRateLimiter::nRequests() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _nRequests;
+}
+
+//_____________________________________________________________________________
+/** Seconds waited by all requests. */
+double RdoRateLimiter::totalWait() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _totalWait;
+}
+
+//_____________________________________________________________________________
+/** Longest wait of a request, in seconds. */
+double RdoRateLimiter::maxWait() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _maxWait;
+}
+
+//_____________________________________________________________________________
+/** Number of requests in each wait bin (see binEdge). */
+std::vector<unsigned long> RdoRateLimiter::waitHistogram() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _hist;
+}
+
+//_____________________________________________________________________________
+/** Print the wait statistics and the non-empty histogram bins. */
+void RdoRateLimiter::printStats(std::ostream& os) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  os << "requests: " << _nRequests << ", waited: " << _totalWait
+     << " s, longest: " << _maxWait << " s" << std::endl;
+  for(unsigned int k=0; k<kBins; k++){
+    if(!_hist[k]) continue;
+    os << "  >= " << std::setw(10) << binEdge(k) * 1e3 << " ms: " << _hist[k] << std::endl;
+  }
+}
+
+//_____________________________________________________________________________
+/** Clear the wait statistics. */
+void RdoRateLimiter::resetStats()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _nRequests = 0;
+  _totalWait = _maxWait = 0.;
+  _hist.assign(kBins, 0);
+}
+
+//_____________________________________________________________________________
+/** Add the tokens earned since the last refill; call with the lock held. */
+void RdoRateLimiter::refill(Clock::time_point now) const
+{
+  double dt = std::chrono::duration<double>(now - _last).count();
+  _last = now;
+  Bucket* buckets[2] = {&_requests, &_bits};
+  for(unsigned int k=0; k<2; k++){
+    Bucket& b = *buckets[k];
+    if(b.rate <= 0.) continue;
+    b.tokens += b.rate * dt;
+    if(b.tokens > b.capacity) b.tokens = b.capacity;
+  }
+}
+
+//_____________________________________________________________________________
+/** Take the tokens of a request and count its wait; call with the lock held. */
+void RdoRateLimiter::take(unsigned long bits, double waited)
+{
+  if(_requests.rate > 0.) _requests.tokens -= 1.;
+  if(_bits.rate > 0.) _bits.tokens -= (double)bits;
+
+  _nRequests++;
+  _totalWait += waited;
+  if(waited > _maxWait) _maxWait = waited;
+  unsigned int bin = 0;
+  while(bin+1 < kBins && waited >= binEdge(bin+1)) bin++;
+  _hist[bin]++;
+}
+
+//_____________________________________________________________________________
+/** Seconds until a bucket holds need tokens (at most a full bucket). */
+double RdoRateLimiter::deficit(const Bucket& b, double need)
+{
+  if(b.rate <= 0.) return 0.;
+  if(need > b.capacity) need = b.capacity;
+  if(b.tokens >= need) return 0.;
+  return (need - b.tokens) / b.rate;
+}
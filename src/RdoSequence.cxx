@@ -17,6 +17,8 @@
     You should have received a copy of the GNU Lesser General Public License
     along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <iostream>     // for cout, cerr, clog
+#include "RdoRequest.hh"
 #include "RdoSequence.hh"
 
 //_____________________________________________________________________________
@@ -35,6 +37,7 @@ RdoSequence::RdoSequence(const RdoSequence& other)
 /** Build the URL for checking the quota. */
 void RdoSequence::buildUrl()
 {
-  sprintf(_url,"%s://%s/sequences/?format=%s&rnd=%s&col=%d&min=%ld&max=%ld", 
-	  scheme(), rdoUrl(), format(), randomization(), columns(), min(), max());
+  if(RdoRequest<kRdoSequences>::url(_url, kUrlSize, *this, min(), max(), columns()))
+    std::cerr << "Error: RdoSequence::buildUrl: Url longer than " << kUrlSize - 1
+	      << " characters, truncated" << std::endl;
 }
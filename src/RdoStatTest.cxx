@@ -0,0 +1,422 @@
+/** \file RdoStatTest.cxx
+    \brief Source for statistical tests class
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cmath>        // math functions
+#include <algorithm>    // sort
+#include <thread>       // std::thread
+#include <atomic>       // std::atomic
+#include "RdoStatTest.hh"
+
+// maximum number of frequency test bins
+static const unsigned long long kMaxBins = 4096;
+// minimum expected count per chi-square bin
+static const double kMinPerBin = 5.;
+// categories per coordinate for the serial test
+static const unsigned long long kSerialCats = 16;
+// categories for the poker test
+static const unsigned long long kPokerCats = 8;
+// hand size for the poker test
+static const unsigned int kPokerHand = 5;
+// lags for the autocorrelation test
+static const unsigned int kMaxLag = 8;
+
+//_____________________________________________________________________________
+/** Default constructor. */
+RdoStatTest::RdoStatTest()
+  : _b8(0), _v8(0), _v64(0), _n(0), _nSymbols(0)
+{}
+
+//_____________________________________________________________________________
+/** Copy constructor. */
+RdoStatTest::RdoStatTest(const RdoStatTest& other)
+  : _b8(other._b8), _v8(other._v8), _v64(other._v64),
+    _n(other._n), _nSymbols(other._nSymbols)
+{
+  // point to our own copy of owned bytes
+  if(other._b8 && other._b8 == other._v8.data()) _b8 = _v8.data();
+}
+
+//_____________________________________________________________________________
+/** Set external bytes (256 symbols); the data are not copied and must outlive the tests. */
+void RdoStatTest::setBytes(const unsigned char* data, unsigned long long n)
+{
+  _v8.clear();
+  _v64.clear();
+  _b8 = data;
+  _n = n;
+  _nSymbols = 256;
+}
+
+//_____________________________________________________________________________
+/** Set bytes (256 symbols); the data are swapped in, leaving the input empty. */
+void RdoStatTest::setBytes(std::vector<unsigned char>& data)
+{
+  _v64.clear();
+  _v8.clear();
+  _v8.swap(data);
+  _b8 = _v8.data();
+  _n = _v8.size();
+  _nSymbols = 256;
+}
+
+//_____________________________________________________________________________
+/** Set symbols in [0,nSymbols); the data are swapped in, leaving the input empty. */
+void RdoStatTest::setSymbols(std::vector<unsigned long long>& data, unsigned long long nSymbols)
+{
+  _v8.clear();
+  _v64.clear();
+  _v64.swap(data);
+  _b8 = 0;
+  _n = _v64.size();
+  _nSymbols = nSymbols;
+}
+
+//_____________________________________________________________________________
+/** Number of symbols falling in each of k categories. */
+std::vector<double> RdoStatTest::categoryWidths(unsigned long long k) const
+{
+  // category c holds the symbols s with c*N <= s*k < (c+1)*N
+  std::vector<double> w(k);
+  for(unsigned long long c=0; c<k; c++){
+    unsigned long long lo = (c * _nSymbols + k - 1) / k;
+    unsigned long long hi = ((c+1) * _nSymbols + k - 1) / k;
+    w[c] = (double)(hi - lo);
+  }
+  return w;
+}
+
+//_____________________________________________________________________________
+/** Frequency test: chi-square of the symbol (or symbol-group) frequencies. */
+RdoStatResult RdoStatTest::frequency() const
+{
+  RdoStatResult r = {"frequency", 0, 0, 1, _n};
+  unsigned long long k = kMaxBins;
+  if(_nSymbols < k) k = _nSymbols;
+  if(_n / kMinPerBin < k) k = (unsigned long long)(_n / kMinPerBin);
+  if(k < 2) return r;
+
+  std::vector<unsigned long long> count(k, 0);
+  for(unsigned long long i=0; i<_n; i++) count[category(sym(i), k)]++;
+
+  std::vector<double> w = categoryWidths(k);
+  for(unsigned long long c=0; c<k; c++){
+    double expected = _n * w[c] / _nSymbols;
+    double diff = count[c] - expected;
+    r.statistic += diff * diff / expected;
+  }
+  r.dof = k - 1;
+  r.pValue = chiSquareProb(r.statistic, r.dof);
+  return r;
+}
+
+//_____________________________________________________________________________
+/** Runs test (Wald-Wolfowitz) on symbols below/above the middle of the range.
+    The statistic is the z-score of the number of runs.
+*/
+RdoStatResult RdoStatTest::runs() const
+{
+  RdoStatResult r = {"runs", 0, 0, 1, _n};
+  if(_n < 2) return r;
+
+  double n1 = 0, nRuns = 1;
+  bool prev = (2 * sym(0) < _nSymbols);
+  for(unsigned long long i=0; i<_n; i++){
+    bool low = (2 * sym(i) < _nSymbols);
+    if(low) n1 += 1;
+    if(i>0 && low != prev) nRuns += 1;
+    prev = low;
+  }
+  double n2 = _n - n1, n = _n;
+  if(n1==0 || n2==0){
+    r.pValue = 0;
+    return r;
+  }
+  double mean = 2. * n1 * n2 / n + 1.;
+  double var  = 2. * n1 * n2 * (2. * n1 * n2 - n) / (n * n * (n - 1.));
+  r.statistic = (nRuns - mean) / sqrt(var);
+  r.dof = mean;
+  r.pValue = normalProb(r.statistic);
+  return r;
+}
+
+//_____________________________________________________________________________
+/** Serial test: chi-square of non-overlapping pairs on a grid of categories. */
+RdoStatResult RdoStatTest::serial() const
+{
+  RdoStatResult r = {"serial", 0, 0, 1, _n};
+  unsigned long long d = kSerialCats;
+  if(_nSymbols < d) d = _nSymbols;
+  unsigned long long nPairs = _n / 2;
+  if(d < 2 || nPairs < kMinPerBin * d * d) return r;
+
+  std::vector<unsigned long long> count(d * d, 0);
+  for(unsigned long long i=0; i<nPairs; i++)
+    count[category(sym(2*i), d) * d + category(sym(2*i+1), d)]++;
+
+  std::vector<double> w = categoryWidths(d);
+  double ns = (double)_nSymbols;
+  for(unsigned long long a=0; a<d; a++){
+    for(unsigned long long b=0; b<d; b++){
+      double expected = nPairs * (w[a] / ns) * (w[b] / ns);
+      double diff = count[a*d + b] - expected;
+      r.statistic += diff * diff / expected;
+    }
+  }
+  r.dof = d * d - 1;
+  r.pValue = chiSquareProb(r.statistic, r.dof);
+  return r;
+}
+
+//_____________________________________________________________________________
+/** Poker test: chi-square of the number of distinct categories in hands of five. */
+RdoStatResult RdoStatTest::poker() const
+{
+  RdoStatResult r = {"poker", 0, 0, 1, _n};
+  unsigned long long d = kPokerCats;
+  if(_nSymbols < d) d = _nSymbols;
+  unsigned long long nHands = _n / kPokerHand;
+  if(d < 2 || nHands < 100) return r;
+
+  // exact probabilities of r distinct categories, by enumerating all hands
+  std::vector<double> w = categoryWidths(d);
+  std::vector<double> prob(kPokerHand+1, 0.);
+  unsigned long long nCombos = 1;
+  for(unsigned int k=0; k<kPokerHand; k++) nCombos *= d;
+  for(unsigned long long h=0; h<nCombos; h++){
+    unsigned long long x = h, seen = 0;
+    double p = 1;
+    for(unsigned int k=0; k<kPokerHand; k++){
+      unsigned long long c = x % d;
+      x /= d;
+      p *= w[c] / _nSymbols;
+      seen |= (1ULL << c);
+    }
+    prob[__builtin_popcountll(seen)] += p;
+  }
+
+  // observed
+  std::vector<double> count(kPokerHand+1, 0.);
+  for(unsigned long long h=0; h<nHands; h++){
+    unsigned long long seen = 0;
+    for(unsigned int k=0; k<kPokerHand; k++)
+      seen |= (1ULL << category(sym(h*kPokerHand + k), d));
+    count[__builtin_popcountll(seen)] += 1;
+  }
+
+  // merge classes with small expectation into the next one
+  std::vector<double> obs, expct;
+  double o = 0, e = 0;
+  for(unsigned int k=1; k<=kPokerHand; k++){
+    o += count[k];
+    e += prob[k] * nHands;
+    if(e >= kMinPerBin){
+      obs.push_back(o);
+      expct.push_back(e);
+      o = e = 0;
+    }
+  }
+  if(e > 0 && !expct.empty()){
+    obs.back() += o;
+    expct.back() += e;
+  }
+  if(expct.size() < 2) return r;
+
+  for(unsigned int k=0; k<expct.size(); k++){
+    double diff = obs[k] - expct[k];
+    r.statistic += diff * diff / expct[k];
+  }
+  r.dof = expct.size() - 1;
+  r.pValue = chiSquareProb(r.statistic, r.dof);
+  return r;
+}
+
+//_____________________________________________________________________________
+/** Birthday spacings test (Marsaglia).
+    Birthdays are built from one or more consecutive symbols so the year has at
+    least 2^18 days; the statistic is the total number of repeated spacings,
+    which is Poisson distributed with mean dof.
+*/
+RdoStatResult RdoStatTest::birthdaySpacings() const
+{
+  RdoStatResult r = {"birthday-spacings", 0, 0, 1, _n};
+  if(_nSymbols < 2) return r;
+
+  // year length and symbols per birthday
+  unsigned int j = 1;
+  double year = (double)_nSymbols;
+  while(year < 262144.){ year *= _nSymbols; j++; }
+  // birthdays per year such that repeated spacings have mean ~2
+  unsigned int m = (unsigned int)floor(cbrt(8. * year) + 0.5);
+  if(m < 4) return r;
+  double lambda = (double)m * m * m / (4. * year);
+
+  unsigned long long nYears = _n / ((unsigned long long)j * m);
+  if(nYears < 1) return r;
+
+  std::vector<unsigned long long> day(m), spacing(m);
+  unsigned long long i = 0, repeats = 0;
+  for(unsigned long long y=0; y<nYears; y++){
+    for(unsigned int b=0; b<m; b++){
+      unsigned long long dd = 0;
+      for(unsigned int k=0; k<j; k++) dd = dd * _nSymbols + sym(i++);
+      day[b] = dd;
+    }
+    std::sort(day.begin(), day.end());
+    spacing[0] = day[0] + (unsigned long long)year - day[m-1];
+    for(unsigned int b=1; b<m; b++) spacing[b] = day[b] - day[b-1];
+    std::sort(spacing.begin(), spacing.end());
+    for(unsigned int b=1; b<m; b++) if(spacing[b]==spacing[b-1]) repeats++;
+  }
+
+  // two-sided Poisson probability
+  double mean = lambda * nYears;
+  double lower = poissonProb(repeats, mean);
+  double upper = (repeats > 0) ? 1. - poissonProb(repeats-1, mean) : 1.;
+  r.statistic = repeats;
+  r.dof = mean;
+  r.pValue = 2. * ((lower < upper) ? lower : upper);
+  if(r.pValue > 1.) r.pValue = 1.;
+  return r;
+}
+
+//_____________________________________________________________________________
+/** Autocorrelation test: Box-Pierce statistic over the first lags. */
+RdoStatResult RdoStatTest::autocorrelation() const
+{
+  RdoStatResult r = {"autocorrelation", 0, 0, 1, _n};
+  if(_n < 10 * kMaxLag) return r;
+
+  double mean = 0;
+  for(unsigned long long i=0; i<_n; i++) mean += sym(i);
+  mean /= _n;
+
+  double c0 = 0;
+  double ck[kMaxLag+1] = {0};
+  for(unsigned long long i=0; i<_n; i++){
+    double x = sym(i) - mean;
+    c0 += x * x;
+    for(unsigned int k=1; k<=kMaxLag && k<=i; k++)
+      ck[k] += x * (sym(i-k) - mean);
+  }
+  if(c0 <= 0){
+    r.pValue = 0;
+    return r;
+  }
+  for(unsigned int k=1; k<=kMaxLag; k++){
+    double rk = ck[k] / c0;
+    r.statistic += _n * rk * rk;
+  }
+  r.dof = kMaxLag;
+  r.pValue = chiSquareProb(r.statistic, r.dof);
+  return r;
+}
+
+//_____________________________________________________________________________
+/** Run all tests, spread over nThreads threads. */
+std::vector<RdoStatResult> RdoStatTest::runAll(unsigned int nThreads) const
+{
+  typedef RdoStatResult (RdoStatTest::*Test)() const;
+  static const Test tests[] = { &RdoStatTest::frequency, &RdoStatTest::runs,
+				&RdoStatTest::serial, &RdoStatTest::poker,
+				&RdoStatTest::birthdaySpacings, &RdoStatTest::autocorrelation };
+  const unsigned int nTests = sizeof(tests) / sizeof(tests[0]);
+
+  std::vector<RdoStatResult> results(nTests);
+  std::atomic<unsigned int> next(0);
+  auto worker = [&](){
+    for(unsigned int t = next++; t < nTests; t = next++)
+      results[t] = (this->*tests[t])();
+  };
+
+  if(nThreads < 1) nThreads = 1;
+  if(nThreads > nTests) nThreads = nTests;
+  std::vector<std::thread> pool;
+  for(unsigned int k=1; k<nThreads; k++) pool.push_back(std::thread(worker));
+  worker();
+  for(unsigned int k=0; k<pool.size(); k++) pool[k].join();
+
+  return results;
+}
+
+//_____________________________________________________________________________
+/** Upper tail probability of the chi-square distribution. */
+double RdoStatTest::chiSquareProb(double chi2, double dof)
+{
+  if(dof <= 0) return 1.;
+  if(chi2 <= 0) return 1.;
+  return gammaQ(0.5 * dof, 0.5 * chi2);
+}
+
+//_____________________________________________________________________________
+/** Two-sided probability of a standard normal z-score. */
+double RdoStatTest::normalProb(double z)
+{
+  return erfc(fabs(z) / sqrt(2.));
+}
+
+//_____________________________________________________________________________
+/** Cumulative Poisson probability P(X <= k). */
+double RdoStatTest::poissonProb(unsigned long long k, double mean)
+{
+  if(mean <= 0) return 1.;
+  return gammaQ(k + 1., mean);
+}
+
+//_____________________________________________________________________________
+/** Regularized lower incomplete gamma function P(a,x). */
+double RdoStatTest::gammaP(double a, double x)
+{
+  if(x <= 0) return 0.;
+  if(x >= a + 1.) return 1. - gammaQ(a, x);
+
+  // series representation
+  double ap = a, sum = 1. / a, del = sum;
+  for(int k=0; k<100000; k++){
+    ap += 1.;
+    del *= x / ap;
+    sum += del;
+    if(fabs(del) < fabs(sum) * 1e-15) break;
+  }
+  return sum * exp(-x + a * log(x) - lgamma(a));
+}
+
+//_____________________________________________________________________________
+/** Regularized upper incomplete gamma function Q(a,x) = 1 - P(a,x). */
+double RdoStatTest::gammaQ(double a, double x)
+{
+  if(x <= 0) return 1.;
+  if(x < a + 1.) return 1. - gammaP(a, x);
+
+  // continued fraction representation (modified Lentz)
+  const double tiny = 1e-300;
+  double b = x + 1. - a, c = 1. / tiny, d = 1. / b, h = d;
+  for(int k=1; k<100000; k++){
+    double an = -k * (k - a);
+    b += 2.;
+    d = an * d + b;
+    if(fabs(d) < tiny) d = tiny;
+    c = b + an / c;
+    if(fabs(c) < tiny) c = tiny;
+    d = 1. / d;
+    double del = d * c;
+    h *= del;
+    if(fabs(del - 1.) < 1e-15) break;
+  }
+  return exp(-x + a * log(x) - lgamma(a)) * h;
+}
@@ -18,7 +18,12 @@
     along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <iostream>     // for cout, cerr, clog
-#include <string.h>     // string handling functions (memset, strtok)
+#include <string.h>     // string handling functions (memset)
+#include "RdoHealth.hh"
+#include "RdoDaemon.hh"
+#include "RdoMetrics.hh"
+#include "RdoObserver.hh"
+#include "RdoRequest.hh"
 #include "RdoStrings.hh"
 
 //_____________________________________________________________________________
@@ -90,10 +95,9 @@ std::string RdoStrings::boolToCode(bool b)
 /** Build the URL for checking the quota. */
 void RdoStrings::buildUrl()
 {
-  sprintf(_url,"%s://%s/strings/?format=%s&rnd=%s&num=%d&len=%d&digits=%s&upperalpha=%s&loweralpha=%s&unique=%s", 
-	  scheme(), rdoUrl(), format(), randomization(), num(), length(), 
-	  boolToCode(digits()).c_str(), boolToCode(upper()).c_str(), 
-	  boolToCode(lower()).c_str(), boolToCode(unique()).c_str());
+  if(RdoRequest<kRdoStrings>::url(_url, kUrlSize, *this, length(), digits(), upper(), lower(), unique()))
+    std::cerr << "Error: RdoStrings::buildUrl: Url longer than " << kUrlSize - 1
+	      << " characters, truncated" << std::endl;
 }
 
 //_____________________________________________________________________________
@@ -102,21 +106,45 @@ std::string RdoStrings::rndm()
 {
   unsigned int dsize = _randData.size();
   if(dsize==0){
+    if(metrics()) metrics()->add(RdoMetrics::kEmpty);
+    if(observer()) observer()->cacheExhausted(*this, RdoObserver::now());
     std::cerr << "Warning: RdoStrings::rndm: No data in memory" << std::endl;
     return 0;
   } 
 
   std::string val("0");
   if(_pos >= dsize){
+    if(metrics()) metrics()->add(RdoMetrics::kWraps);
+    if(observer()) observer()->cacheExhausted(*this, RdoObserver::now());
     std::cerr << "Warning: RdoStrings::rndm: Exceeded random cache size, begining to repeat!" << std::endl;
     _pos = 0;
   }
   val = _randData[_pos];	
   _pos++;
+  countDraw();
   
   return val;
 }
 
+//_____________________________________________________________________________
+/** Take the next n strings from memory without copying, as a view that is
+    valid until the next download. Unlike rndm(), consume() does not wrap
+    around: at the end of the cache the view is shorter, or empty.
+*/
+RdoCacheView<std::string> RdoStrings::consume(unsigned int n)
+{
+  unsigned int dsize = _randData.size();
+  unsigned int first = (_pos < dsize) ? _pos : dsize;
+  unsigned int count = (n < dsize - first) ? n : dsize - first;
+  if(count < n){
+    if(dsize==0 && metrics()) metrics()->add(RdoMetrics::kEmpty);
+    if(observer()) observer()->cacheExhausted(*this, RdoObserver::now());
+  }
+  _pos = first + count;
+  countDraws(count);
+  return RdoCacheView<std::string>(_randData.data() + first, count);
+}
+
 //_____________________________________________________________________________
 /** Parse the integers into memory. */
 void RdoStrings::parseMemory(struct RdoAbsObject::CurlMem cMem)
@@ -127,14 +155,63 @@ void RdoStrings::parseMemory(struct RdoAbsObject::CurlMem cMem)
     return;
   }
 
+  // health tests on this block; each character is a symbol of the allowed alphabet
+  bool check = healthTests();
+  RdoHealth health;
+  int symbol[256];
+  int nSymbols = 0;
+  for(int c=0; c<256; c++) symbol[c] = -1;
+  if(_digits) for(int c='0'; c<='9'; c++) symbol[c] = nSymbols++;
+  if(_upper)  for(int c='A'; c<='Z'; c++) symbol[c] = nSymbols++;
+  if(_lower)  for(int c='a'; c<='z'; c++) symbol[c] = nSymbols++;
+  if(check) health.begin(nSymbols, num()*_length);
+
   // parse the memory
-  char delim = '\n';
-  char* token = strtok(cMem.memory,&delim) ;
-  while(token){
-    _randData.push_back(std::string(token));
-    token = strtok(0,&delim) ; 
-  }  
-
-  if(_randData.size()<num())
+  std::vector<std::string> block;
+  block.reserve(num());
+  RdoRequest<kRdoStrings>::parse(cMem, _length, symbol, block, check ? &health : 0);
+  if(check && block.size()!=num()) health.fail("count check");
+  if(check && health.end()){
+    rejectBlock("RdoStrings::parseMemory", health.reason());
+    return;
+  }
+  _randData.insert(_randData.end(), block.begin(), block.end());
+
+  if(block.size()<num())
     std::cerr << "Warning: RdoStrings::parseMemory: Parsed fewer numbers than downloaded" << std::endl;    
 }
+
+//_____________________________________________________________________________
+/** Get the strings from an rdo-entropyd daemon; each character is a
+    uniform integer index into the allowed alphabet.
+    \return true if operation failed
+*/
+bool RdoStrings::fetchFromDaemon(RdoDaemon& daemon)
+{
+  std::string alphabet;
+  if(_digits) alphabet += "0123456789";
+  if(_upper)  alphabet += "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  if(_lower)  alphabet += "abcdefghijklmnopqrstuvwxyz";
+  if(alphabet.empty()){
+    std::cerr << "Error: RdoStrings::fetchFromDaemon: No characters allowed" << std::endl;
+    return true;
+  }
+
+  unsigned int k = daemon.addIntegers(num() * _length, 0, alphabet.size() - 1);
+  if(daemon.request()) return true;
+  const std::vector<long int>& data = daemon.integers(k);
+  std::string str(_length, ' ');
+  for(unsigned int i=0; i+_length<=data.size(); i+=_length){
+    for(unsigned int c=0; c<_length; c++) str[c] = alphabet[data[i+c]];
+    _randData.push_back(str);
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Random bits a request costs: ceil(log2(alphabet size)) per character. */
+unsigned long RdoStrings::requestBits() const
+{
+  double nChars = (_digits ? 10. : 0.) + (_upper ? 26. : 0.) + (_lower ? 26. : 0.);
+  return (unsigned long)num() * _length * bitsPerValue(nChars);
+}
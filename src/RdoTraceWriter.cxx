@@ -0,0 +1,218 @@
+/** \file RdoTraceWriter.cxx
+    \brief Source for Chrome trace writer class
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>     // for cout, cerr, clog
+#include <fstream>      // write
+#include <sstream>      // json
+#include <iomanip>      // setprecision
+#include "RdoAbsObject.hh"
+#include "RdoJson.hh"
+#include "RdoTraceWriter.hh"
+
+//_____________________________________________________________________________
+/** Default constructor; times are counted from now. */
+RdoTraceWriter::RdoTraceWriter()
+  : _t0(now())
+{}
+
+//_____________________________________________________________________________
+/** Copy constructor; copies the recorded events. */
+RdoTraceWriter::RdoTraceWriter(const RdoTraceWriter& other)
+  : RdoObserver(other)
+{
+  std::lock_guard<std::mutex> lock(other._mutex);
+  _t0 = other._t0;
+  _events = other._events;
+  _lanes = other._lanes;
+  _laneNames = other._laneNames;
+  _open = other._open;
+}
+
+//_____________________________________________________________________________
+/** A request is sent: open its span. */
+void RdoTraceWriter::requestStart(const RdoAbsObject& obj, Time t)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  lane(obj);
+  _open[&obj] = us(t);
+}
+
+//_____________________________________________________________________________
+/** The connection is ready. */
+void RdoTraceWriter::connected(const RdoAbsObject& obj, bool reused, Time t)
+{
+  instant(obj, "connected", t, reused ? "\"reused\":true" : "\"reused\":false");
+}
+
+//_____________________________________________________________________________
+/** The first byte arrived. */
+void RdoTraceWriter::firstByte(const RdoAbsObject& obj, Time t)
+{
+  instant(obj, "first byte", t, "");
+}
+
+//_____________________________________________________________________________
+/** A block of data arrived. */
+void RdoTraceWriter::chunk(const RdoAbsObject& obj, size_t bytes, Time t)
+{
+  instant(obj, "chunk", t, "\"bytes\":" + std::to_string(bytes));
+}
+
+//_____________________________________________________________________________
+/** A block was parsed: a span. */
+void RdoTraceWriter::parseComplete(const RdoAbsObject& obj, bool rejected, Time start, Time end)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  Event e = {'X', "parse", lane(obj), us(start), us(end) - us(start),
+	     rejected ? "\"rejected\":true" : "\"rejected\":false"};
+  _events.push_back(e);
+}
+
+//_____________________________________________________________________________
+/** A request is done: close its span (from the start of the transfer if
+    requestStart was missed).
+*/
+void RdoTraceWriter::requestEnd(const RdoAbsObject& obj, bool failed, Time t)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  double end = us(t);
+  double start = end;
+  std::map<const RdoAbsObject*, double>::iterator it = _open.find(&obj);
+  if(it!=_open.end()){
+    start = it->second;
+    _open.erase(it);
+  }
+  std::string args("\"url\":");
+  RdoJson::quote(args, obj.url() ? obj.url() : "");
+  args += failed ? ",\"failed\":true" : ",\"failed\":false";
+  Event e = {'X', "request", lane(obj), start, end - start, args};
+  _events.push_back(e);
+}
+
+//_____________________________________________________________________________
+/** Data were added to the object's memory. */
+void RdoTraceWriter::cacheRefill(const RdoAbsObject& obj, Time t)
+{
+  instant(obj, "cache refill", t, "");
+}
+
+//_____________________________________________________________________________
+/** rndm() ran past the data in memory. */
+void RdoTraceWriter::cacheExhausted(const RdoAbsObject& obj, Time t)
+{
+  instant(obj, "cache exhausted", t, "");
+}
+
+//_____________________________________________________________________________
+/** The trace as a Chrome trace event JSON object. */
+std::string RdoTraceWriter::json() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(3);
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"libRdO\"}}";
+  for(unsigned int i=0; i<_laneNames.size(); i++){
+    std::string name;
+    RdoJson::quote(name, _laneNames[i].c_str());
+    os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i+1
+       << ",\"args\":{\"name\":" << name << "}}";
+  }
+  for(unsigned int i=0; i<_events.size(); i++){
+    const Event& e = _events[i];
+    os << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"rdo\",\"ph\":\"" << e.ph
+       << "\",\"pid\":1,\"tid\":" << e.lane << ",\"ts\":" << e.ts;
+    if(e.ph=='X') os << ",\"dur\":" << e.dur;
+    else os << ",\"s\":\"t\"";
+    if(!e.args.empty()) os << ",\"args\":{" << e.args << "}";
+    os << "}";
+  }
+  os << "\n]}\n";
+  return os.str();
+}
+
+//_____________________________________________________________________________
+/** Write the trace to a file.
+    \return true if failed
+*/
+bool RdoTraceWriter::write(const char* fileName) const
+{
+  std::ofstream ofs(fileName);
+  if(!ofs.is_open()){
+    std::cerr << "Error: RdoTraceWriter::write: Failed to open file " << fileName << std::endl;
+    return true;
+  }
+  ofs << json();
+  ofs.close();
+  if(ofs.fail()){
+    std::cerr << "Error: RdoTraceWriter::write: Failed to write " << fileName << std::endl;
+    return true;
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+/** Number of recorded events. */
+size_t RdoTraceWriter::size() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _events.size();
+}
+
+//_____________________________________________________________________________
+/** Forget the recorded events and lanes; times still count from the start. */
+void RdoTraceWriter::clear()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _events.clear();
+  _lanes.clear();
+  _laneNames.clear();
+  _open.clear();
+}
+
+//_____________________________________________________________________________
+/** Microseconds from the time origin to t. */
+double RdoTraceWriter::us(Time t) const
+{
+  return std::chrono::duration<double, std::micro>(t - _t0).count();
+}
+
+//_____________________________________________________________________________
+/** Lane (tid, from 1) of an object, added on first use; the mutex must be held. */
+unsigned int RdoTraceWriter::lane(const RdoAbsObject& obj)
+{
+  std::map<const RdoAbsObject*, unsigned int>::iterator it = _lanes.find(&obj);
+  if(it!=_lanes.end()) return it->second;
+  unsigned int l = _laneNames.size() + 1;
+  _lanes[&obj] = l;
+  std::ostringstream name;
+  name << "object " << l;
+  if(obj.url() && obj.url()[0]) name << " " << obj.url();
+  _laneNames.push_back(name.str());
+  return l;
+}
+
+//_____________________________________________________________________________
+/** Record an instant event on the lane of an object. */
+void RdoTraceWriter::instant(const RdoAbsObject& obj, const char* name, Time t, const std::string& args)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  Event e = {'i', name, lane(obj), us(t), 0., args};
+  _events.push_back(e);
+}
@@ -0,0 +1,255 @@
+/** \file RdoTransferStats.cxx
+    \brief Source for rolling transfer statistics class
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>     // memset
+#include <math.h>       // ceil
+#include <algorithm>    // nth_element, rotate
+#include <iomanip>      // setw
+#include "RdoTransferStats.hh"
+
+// names of the timed phases
+static const char* kPhaseNames[] = {"wait", "dns", "connect", "tls", "ttfb", "total", "parse"};
+
+//_____________________________________________________________________________
+/** Default constructor; keeps the last window transfers (at least 1). */
+RdoTransferStats::RdoTransferStats(unsigned int window)
+  : _window(window > 0 ? window : 1), _next(0),
+    _nTransfers(0), _nFailed(0), _nReused(0), _bytes(0)
+{}
+
+//_____________________________________________________________________________
+/** Copy constructor. */
+RdoTransferStats::RdoTransferStats(const RdoTransferStats& other)
+  : _window(1), _next(0), _nTransfers(0), _nFailed(0), _nReused(0), _bytes(0)
+{
+  *this = other;
+}
+
+//_____________________________________________________________________________
+/** Assignment; copies the window and the aggregates. */
+RdoTransferStats& RdoTransferStats::operator=(const RdoTransferStats& other)
+{
+  if(this==&other) return *this;
+  std::lock(_mutex, other._mutex);
+  std::lock_guard<std::mutex> lock1(_mutex, std::adopt_lock);
+  std::lock_guard<std::mutex> lock2(other._mutex, std::adopt_lock);
+  _window = other._window;
+  _recent = other._recent;
+  _next = other._next;
+  _nTransfers = other._nTransfers;
+  _nFailed = other._nFailed;
+  _nReused = other._nReused;
+  _bytes = other._bytes;
+  return *this;
+}
+
+//_____________________________________________________________________________
+/** Set the number of recent transfers kept (at least 1); the newest are kept. */
+void RdoTransferStats::setWindow(unsigned int window)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  // oldest first, then drop the oldest beyond the new window
+  std::rotate(_recent.begin(), _recent.begin() + _next, _recent.end());
+  _window = window > 0 ? window : 1;
+  if(_recent.size() > _window) _recent.erase(_recent.begin(), _recent.end() - _window);
+  _next = 0;
+}
+
+//_____________________________________________________________________________
+/** Number of recent transfers kept. */
+unsigned int RdoTransferStats::window() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _window;
+}
+
+//_____________________________________________________________________________
+/** Add a transfer; failed ones are only counted. */
+void RdoTransferStats::add(const RdoAbsObject::TransferStats& stats)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _nTransfers++;
+  _bytes += stats.bytes;
+  if(stats.reused) _nReused++;
+  if(stats.failed){
+    _nFailed++;
+    return;
+  }
+  if(_recent.size() < _window){
+    _recent.push_back(stats);
+    return;
+  }
+  _recent[_next] = stats;
+  _next = (_next + 1) % _window;
+}
+
+//_____________________________________________________________________________
+/** Number of transfers since the last reset. */
+unsigned long RdoTransferStats::nTransfers() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _nTransfers;
+}
+
+//_____________________________________________________________________________
+/** Number of failed transfers since the last reset. */
+unsigned long RdoTransferStats::nFailed() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _nFailed;
+}
+
+//_____________________________________________________________________________
+/** Number of transfers over a reused connection since the last reset. */
+unsigned long RdoTransferStats::nReused() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _nReused;
+}
+
+//_____________________________________________________________________________
+/** Bytes downloaded since the last reset. */
+unsigned long long RdoTransferStats::bytes() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _bytes;
+}
+
+//_____________________________________________________________________________
+/** Number of transfers in the window. */
+unsigned int RdoTransferStats::size() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _recent.size();
+}
+
+//_____________________________________________________________________________
+/** Mean of every phase and of the bytes over the window; zero if empty. */
+RdoAbsObject::TransferStats RdoTransferStats::mean() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  RdoAbsObject::TransferStats m;
+  memset(&m, 0, sizeof(m));
+  if(_recent.empty()) return m;
+  double bytes = 0.;
+  for(unsigned int k=0; k<kPhases; k++){
+    double sum = 0.;
+    for(unsigned int i=0; i<_recent.size(); i++) sum += phase(_recent[i], k);
+    setPhase(m, k, sum / _recent.size());
+  }
+  for(unsigned int i=0; i<_recent.size(); i++) bytes += _recent[i].bytes;
+  m.bytes = (unsigned long)(bytes / _recent.size());
+  return m;
+}
+
+//_____________________________________________________________________________
+/** p-th percentile (nearest rank) of every phase and of the bytes over the
+    window, each on its own; zero if empty.
+*/
+RdoAbsObject::TransferStats RdoTransferStats::percentile(double p) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  RdoAbsObject::TransferStats q;
+  memset(&q, 0, sizeof(q));
+  if(_recent.empty()) return q;
+  unsigned long rank = (unsigned long)ceil(p / 100. * _recent.size());
+  if(rank < 1) rank = 1;
+  if(rank > _recent.size()) rank = _recent.size();
+
+  std::vector<double> v(_recent.size());
+  for(unsigned int k=0; k<=kPhases; k++){
+    for(unsigned int i=0; i<_recent.size(); i++)
+      v[i] = (k < kPhases) ? phase(_recent[i], k) : _recent[i].bytes;
+    std::nth_element(v.begin(), v.begin() + rank - 1, v.end());
+    if(k < kPhases) setPhase(q, k, v[rank-1]);
+    else q.bytes = (unsigned long)v[rank-1];
+  }
+  return q;
+}
+
+//_____________________________________________________________________________
+/** Print the counts and the mean, p50, p95 and p99 of every phase (in ms). */
+void RdoTransferStats::print(std::ostream& os) const
+{
+  RdoAbsObject::TransferStats m = mean();
+  RdoAbsObject::TransferStats p[3] = {percentile(50.), percentile(95.), percentile(99.)};
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    os << "transfers: " << _nTransfers << ", failed: " << _nFailed << ", reused connections: "
+       << _nReused << ", bytes: " << _bytes << ", window: " << _recent.size() << std::endl;
+  }
+  os << "  (ms)          mean        p50        p95        p99" << std::endl;
+  for(unsigned int k=0; k<kPhases; k++){
+    os << "  " << std::left << std::setw(8) << kPhaseNames[k] << std::right
+       << " " << std::setw(10) << phase(m, k) * 1e3;
+    for(unsigned int j=0; j<3; j++) os << " " << std::setw(10) << phase(p[j], k) * 1e3;
+    os << std::endl;
+  }
+}
+
+//_____________________________________________________________________________
+/** Print the phases (in ms) and the size of one transfer on one line. */
+void RdoTransferStats::printTransfer(std::ostream& os, const RdoAbsObject::TransferStats& stats)
+{
+  os << "transfer:";
+  for(unsigned int k=0; k<kPhases; k++) os << " " << kPhaseNames[k] << " " << phase(stats, k) * 1e3 << " ms,";
+  os << " " << stats.bytes << " bytes" << (stats.reused ? ", reused connection" : "")
+     << (stats.failed ? ", failed" : "") << std::endl;
+}
+
+//_____________________________________________________________________________
+/** Clear the window and the counts; the window size is kept. */
+void RdoTransferStats::reset()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _recent.clear();
+  _next = 0;
+  _nTransfers = _nFailed = _nReused = 0;
+  _bytes = 0;
+}
+
+//_____________________________________________________________________________
+/** Phase k of a transfer, in the order of kPhaseNames. */
+double RdoTransferStats::phase(const RdoAbsObject::TransferStats& stats, unsigned int k)
+{
+  switch(k){
+  case 0: return stats.wait;
+  case 1: return stats.dns;
+  case 2: return stats.connect;
+  case 3: return stats.tls;
+  case 4: return stats.ttfb;
+  case 5: return stats.total;
+  default: return stats.parse;
+  }
+}
+
+//_____________________________________________________________________________
+/** Set phase k of a transfer, in the order of kPhaseNames. */
+void RdoTransferStats::setPhase(RdoAbsObject::TransferStats& stats, unsigned int k, double value)
+{
+  switch(k){
+  case 0: stats.wait = value; break;
+  case 1: stats.dns = value; break;
+  case 2: stats.connect = value; break;
+  case 3: stats.tls = value; break;
+  case 4: stats.ttfb = value; break;
+  case 5: stats.total = value; break;
+  default: stats.parse = value;
+  }
+}
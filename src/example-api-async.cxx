@@ -0,0 +1,107 @@
+/** \file example-api-async.cxx
+    \brief Source for example-api-async binary executable
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <chrono>
+#include "RdoIntegers.hh"
+#include "RdoRandom.hh"
+#include "RdoAsync.hh"
+#include "RdoOptions.hh"
+
+#if defined(__cpp_impl_coroutine)
+
+// sequential downloads per coroutine
+static const unsigned int kPerTask = 4;
+
+//_____________________________________________________________________________
+//! download integers and fractions one after the other, checking each block
+RdoTask Draw(RdoMulti& multi, const RdoOptions& opt, unsigned long& done, unsigned long& failures)
+{
+  RdoIntegers ints;
+  RdoRandom frac;
+  RdoAbsObject* objs[2] = {&ints, &frac};
+  for(unsigned int k=0; k<2; k++){
+    objs[k]->setHttps(opt.useHTTPS);
+    objs[k]->setRdoUrl(opt.host.c_str());
+    objs[k]->setAgent(opt.agent.c_str());
+    objs[k]->setTimeOut(opt.timeout);
+    objs[k]->setInMemory(true);
+    objs[k]->setNum(opt.num);
+  }
+  ints.setRange(opt.min, opt.max);
+
+  for(unsigned int k=0; k<kPerTask; k++){
+    if(k%2==0){
+      RdoAsyncResult<std::vector<long int> > res = co_await multi.fetch(ints);
+      bool failed = res.failed || res.data.size()!=opt.num;
+      for(unsigned int i=0; i<res.data.size(); i++)
+	if(res.data[i] < opt.min || res.data[i] > opt.max) failed = true;
+      if(failed) failures++;
+    } else {
+      RdoAsyncResult<std::vector<double> > res = co_await multi.fetch(frac);
+      bool failed = res.failed || res.data.size()!=opt.num;
+      for(unsigned int i=0; i<res.data.size(); i++)
+	if(res.data[i] < 0. || res.data[i] >= 1.) failed = true;
+      if(failed) failures++;
+    }
+    done++;
+  }
+}
+
+//_____________________________________________________________________________
+//! example-api-async binary executable main method
+int main(int argc, char** argv)
+{
+  // --------------------------------------------
+  // options; --workers is the number of coroutines
+  RdoOptions opt(argc, argv);
+  if(opt.help){
+    std::cout << "Usage: example-api-async [--workers 100] [--number 100] [--host host:port] [--not-secure]" << std::endl;
+    std::cout << "       Overlapping downloads from coroutines on one thread." << std::endl;
+    return 0;
+  }
+
+  // --------------------------------------------
+  // start the coroutines, then run the loop until all returned
+  RdoMulti multi;
+  unsigned long done = 0, failures = 0;
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for(unsigned int t=0; t<opt.workers; t++) Draw(multi, opt, done, failures);
+  std::cout << "in flight: " << multi.pending() << std::endl;
+  multi.run();
+  double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  std::cout << "downloads: " << done << " in " << dt << " s, failed: " << failures << std::endl;
+
+  // --------------------------------------------
+  // return
+  return (failures || done != opt.workers * kPerTask) ? 1 : 0;
+}
+
+#else
+
+//_____________________________________________________________________________
+//! example-api-async needs C++20 coroutines
+int main()
+{
+  std::cerr << "Error: example-api-async: built without C++20 coroutines" << std::endl;
+  return 1;
+}
+
+#endif // __cpp_impl_coroutine
@@ -42,7 +42,7 @@ int main(int argc, char** argv)
 
   // --------------------------------------------
   // in-memory random integers
-  std::vector<long int> data = rdo.cache();
+  RdoIntegerView data = rdo.view();
   unsigned int num = data.size();
 
   // --------------------------------------------
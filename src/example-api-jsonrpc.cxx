@@ -0,0 +1,101 @@
+/** \file example-api-jsonrpc.cxx
+    \brief Source for example-api-jsonrpc binary executable
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>     // getenv
+#include <iostream>
+#include "RdoJsonRpc.hh"
+#include "RdoOptions.hh"
+
+// blobs of 1024 bits
+static const unsigned int kBlobBits = 1024;
+
+//_____________________________________________________________________________
+//! check the integers of a result; true if failed
+bool CheckIntegers(const RdoJsonRpcResult& res, unsigned int n, long int min, long int max)
+{
+  bool failed = (res.errorCode!=0 || res.integers.size()!=n);
+  for(unsigned int i=0; i<res.integers.size(); i++)
+    if(res.integers[i] < min || res.integers[i] > max) failed = true;
+  return failed;
+}
+
+//_____________________________________________________________________________
+//! check the blobs of a result; true if failed
+bool CheckBlobs(const RdoJsonRpcResult& res, unsigned int n, unsigned int bits)
+{
+  bool failed = (res.errorCode!=0 || res.blobs.size()!=n);
+  for(unsigned int i=0; i<res.blobs.size(); i++)
+    if(res.blobs[i].size()!=bits/8) failed = true;
+  return failed;
+}
+
+//_____________________________________________________________________________
+//! example-api-jsonrpc binary executable main method
+int main(int argc, char** argv)
+{
+  // --------------------------------------------
+  // options; the key is read from RDO_API_KEY
+  RdoOptions opt(argc, argv);
+  if(opt.help){
+    std::cout << "Usage: example-api-jsonrpc [--number 100] [--min 1] [--max 6] [--host host:port] [--not-secure]" << std::endl;
+    std::cout << "       generateIntegers, generateBlobs and a batch of all four JSON-RPC calls" << std::endl;
+    std::cout << "       with the key in RDO_API_KEY, e.g. against rdo-standin." << std::endl;
+    return 0;
+  }
+  const char* key = getenv("RDO_API_KEY");
+
+  RdoJsonRpc rpc;
+  rpc.setHttps(opt.useHTTPS);
+  if(opt.host!="www.random.org") rpc.setRdoUrl(opt.host.c_str());
+  rpc.setAgent(opt.agent.c_str());
+  rpc.setTimeOut(opt.timeout);
+  rpc.setApiKey(key ? key : "00000000-0000-0000-0000-000000000000");
+  unsigned int failures = 0;
+
+  // --------------------------------------------
+  // single calls
+  rpc.addIntegers(opt.num, opt.min, opt.max);
+  bool failed = rpc.downloadData() || CheckIntegers(rpc.result(0), opt.num, opt.min, opt.max);
+  std::cout << "generateIntegers: " << (failed ? "failed" : "ok") << std::endl;
+  if(failed) failures++;
+
+  rpc.clearCalls();
+  rpc.addBlobs(2, kBlobBits);
+  failed = rpc.downloadData() || CheckBlobs(rpc.result(0), 2, kBlobBits);
+  std::cout << "generateBlobs: " << (failed ? "failed" : "ok") << std::endl;
+  if(failed) failures++;
+
+  // --------------------------------------------
+  // a batch in one round trip
+  rpc.clearCalls();
+  unsigned int ints = rpc.addIntegers(opt.num, opt.min, opt.max, false);
+  unsigned int fracs = rpc.addDecimalFractions(opt.num, 8);
+  unsigned int strs = rpc.addStrings(opt.num, 8, "abcdef0123456789");
+  unsigned int blobs = rpc.addBlobs(4, kBlobBits);
+  failed = rpc.downloadData() || CheckIntegers(rpc.result(ints), opt.num, opt.min, opt.max)
+    || rpc.result(fracs).fractions.size()!=opt.num || rpc.result(strs).strings.size()!=opt.num
+    || CheckBlobs(rpc.result(blobs), 4, kBlobBits);
+  std::cout << "batch of " << rpc.nCalls() << ": " << (failed ? "failed" : "ok") << std::endl;
+  if(failed) failures++;
+  std::cout << "bits left: " << rpc.bitsLeft() << ", requests left: " << rpc.requestsLeft() << std::endl;
+
+  // --------------------------------------------
+  // return
+  return failures ? 1 : 0;
+}
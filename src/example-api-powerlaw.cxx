@@ -45,7 +45,7 @@ int main(int argc, char** argv)
 
   // --------------------------------------------
   // in-memory random fractions
-  std::vector<double> data = rdo.cache();
+  RdoCacheView<double> data = rdo.view();
   unsigned int num = data.size();
 
   // --------------------------------------------
@@ -53,6 +53,7 @@ int main(int argc, char** argv)
   double min = 1.0;
   double index = 2.0;
   std::vector<double> pwlwData;
+  pwlwData.reserve(num);
   for(unsigned int k=0; k<num; k++)
     pwlwData.push_back( min / pow(data[k],1./index));
   std::cout << "Generated " << num << " power-law distributed events with index = " << index << std::endl;
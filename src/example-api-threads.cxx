@@ -0,0 +1,103 @@
+/** \file example-api-threads.cxx
+    \brief Source for example-api-threads binary executable
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "RdoIntegers.hh"
+#include "RdoClient.hh"
+#include "RdoOptions.hh"
+
+// downloads per thread
+static const unsigned int kPerThread = 16;
+
+//_____________________________________________________________________________
+//! download and check kPerThread blocks of integers; objects are copied between downloads
+void Worker(const RdoOptions* opt, RdoClient* client, std::atomic<unsigned long>* failures)
+{
+  RdoIntegers proto;
+  proto.setHttps(opt->useHTTPS);
+  proto.setRdoUrl(opt->host.c_str());
+  proto.setAgent(opt->agent.c_str());
+  proto.setTimeOut(opt->timeout);
+  proto.setInMemory(true);
+  proto.setNum(opt->num);
+  proto.setRange(opt->min, opt->max);
+
+  for(unsigned int k=0; k<kPerThread; k++){
+    RdoIntegers rdo(proto);
+    bool failed = client->downloadData(rdo);
+    RdoIntegerView data = rdo.view();
+    if(data.size()!=opt->num) failed = true;
+    for(unsigned int i=0; i<data.size(); i++)
+      if(data[i] < opt->min || data[i] > opt->max) failed = true;
+    if(failed) (*failures)++;
+  }
+}
+
+//_____________________________________________________________________________
+//! example-api-threads binary executable main method
+int main(int argc, char** argv)
+{
+  // --------------------------------------------
+  // options; --workers is the largest number of threads
+  RdoOptions opt(argc, argv);
+  if(opt.help){
+    std::cout << "Usage: example-api-threads [--workers 8] [--number 100] [--host host:port] [--not-secure]" << std::endl;
+    std::cout << "       Stress test and scaling benchmark of concurrent downloads through one RdoClient." << std::endl;
+    return 0;
+  }
+  unsigned int maxThreads = opt.workers;
+  if(maxThreads < 1) maxThreads = 1;
+
+  // --------------------------------------------
+  // 1, 2, 4, ... threads sharing one (moved) client
+  RdoClient client = RdoClient();
+  std::atomic<unsigned long> failures(0);
+  double rate1 = 0.;
+  std::cout << std::setw(8) << "threads" << std::setw(12) << "downloads"
+	    << std::setw(12) << "seconds" << std::setw(14) << "downloads/s"
+	    << std::setw(10) << "speed-up" << std::endl;
+  for(unsigned int nThreads=1; ; nThreads*=2){
+    if(nThreads > maxThreads) nThreads = maxThreads;
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for(unsigned int t=0; t<nThreads; t++)
+      pool.push_back(std::thread(Worker, &opt, &client, &failures));
+    for(unsigned int t=0; t<nThreads; t++) pool[t].join();
+    double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    double rate = nThreads * kPerThread / dt;
+    if(nThreads==1) rate1 = rate;
+    std::cout << std::setw(8) << nThreads << std::setw(12) << nThreads * kPerThread
+	      << std::setw(12) << std::fixed << std::setprecision(3) << dt
+	      << std::setw(14) << std::setprecision(1) << rate
+	      << std::setw(10) << std::setprecision(2) << rate / rate1 << std::endl;
+    if(nThreads==maxThreads) break;
+  }
+  std::cout << "sessions: " << client.nHandles() << ", failed downloads: " << failures << std::endl;
+
+  // --------------------------------------------
+  // return
+  return failures ? 1 : 0;
+}
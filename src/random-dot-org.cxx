@@ -17,21 +17,105 @@
     You should have received a copy of the GNU Lesser General Public License
     along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <stdio.h>      // fwrite
+#include <stdlib.h>     // atol
+#include <math.h>       // ceil
+#include <string.h>     // strerror, memset
+#include <errno.h>      // errno
+#include <signal.h>     // signal handling
+#include <unistd.h>     // isatty
 #include <iostream>
 #include <iomanip>
 #include <ostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <functional>
 #include "RdoQuota.hh"
 #include "RdoIntegers.hh"
 #include "RdoSequence.hh"
 #include "RdoStrings.hh"
 #include "RdoRandom.hh"
 #include "RdoBytes.hh"
+#include "RdoDaemon.hh"
+#include "RdoMulti.hh"
+#include "RdoArrayFile.hh"
+#include "RdoTransferStats.hh"
+#include "RdoMetrics.hh"
+#include "RdoTraceWriter.hh"
+#include "RdoJson.hh"
 #include "RdoOptions.hh"
 
+// bytes per request when streaming
+static const unsigned int kStreamChunk = 10000;
+// longest back-off after failed downloads when streaming (seconds)
+static const unsigned int kMaxBackOff = 64;
+// largest number of values (bytes for binary) per request
+static const unsigned long kMaxChunk = 10000;
+// attempts per chunk of a large download
+static const unsigned int kChunkTries = 3;
+// default mix of the bench type
+static const char* kBenchMix = "integers:100,fractions:100,strings:100,bytes:100";
+
+//! one request of a large download
+struct Chunk {
+  std::unique_ptr<RdoAbsObject> rdo;  //<! downloading object (empty before start and once written)
+  std::string text;                   //<! raw text output
+  unsigned int tries;                 //<! attempts so far
+  bool done;                          //<! finished downloading
+  bool failed;                        //<! last attempt failed
+};
+
+//! blocks downloaded by the streaming workers, bounded for back-pressure
+struct StreamQueue {
+  std::deque<std::vector<unsigned char> > blocks;  //<! downloaded blocks
+  unsigned int capacity;                            //<! most blocks held
+  unsigned long long requested;                     //<! bytes requested so far
+  bool done;                                        //<! stop the workers
+  std::mutex mutex;                                 //<! guards the queue
+  std::condition_variable pushed;                   //<! a block was added
+  std::condition_variable popped;                   //<! a block was removed
+};
+
+//! writes the metrics to --metrics and the trace to --trace when main returns
+struct ExitWriter {
+  std::string metrics;  //<! file or unix:socket (empty for none)
+  std::string trace;    //<! file (empty for none)
+  ~ExitWriter();
+};
+
+// stop flag, set by SIGINT/SIGTERM when streaming
+static volatile sig_atomic_t gStop = 0;
+// metrics of all downloads (with --metrics)
+static RdoMetrics gMetrics;
+// trace of all requests (with --trace)
+static RdoTraceWriter gTrace;
+
 // methods
+RdoAbsObject* CreateObject(const RdoOptions& opt);
 int DownloadBinary(RdoOptions& opt);
+bool WriteBinary(RdoCacheView<unsigned char> data, const RdoOptions& opt);
+bool CheckOutFormat(const RdoOptions& opt);
+bool WriteArray(RdoAbsObject& rdo, const RdoOptions& opt);
+bool WriteArray(RdoArrayFile& out, RdoAbsObject& rdo, const RdoOptions& opt);
+int RunBatch(RdoOptions& opt);
+unsigned long ChunkedCount(const RdoOptions& opt);
+int DownloadChunked(RdoOptions& opt);
+bool SplitLine(const std::string& line, std::vector<std::string>& args);
+int RunBench(RdoOptions& opt);
+bool ParseMix(const RdoOptions& opt, std::vector<RdoOptions>& mix);
+unsigned long BenchValues(const RdoOptions& job);
+double Percentile(std::vector<double> values, double p);
+int StreamBinary(RdoOptions& opt);
+void StreamWorker(const RdoOptions* opt, StreamQueue* queue);
+void StopStream(int sig);
 void PrintUsage(std::ostream& os);
 
 //_____________________________________________________________________________
@@ -43,18 +127,22 @@ int main(int argc, char** argv)
   RdoOptions opt(argc, argv);
   // print help message
   if(opt.help){ PrintUsage(std::cout); return 0; }      
+  ExitWriter exitWriter = {opt.metrics, opt.trace};
 
   // --------------------------------------------
   // check quota first? 
   if(opt.quota){
     RdoQuota rdoQuota;
     rdoQuota.setHttps(opt.useHTTPS);
+    rdoQuota.setRdoUrl(opt.host.c_str());
     rdoQuota.setAgent(opt.agent.c_str());
     rdoQuota.setProxy(opt.proxy.c_str());
     rdoQuota.setProxyType(opt.proxyType.c_str());
     rdoQuota.setTimeOut(opt.timeout);
     rdoQuota.setInMemory(true);
     rdoQuota.setIP(opt.ip.c_str());
+    if(opt.metrics!="") rdoQuota.setMetrics(&gMetrics);
+    if(opt.trace!="") rdoQuota.setObserver(&gTrace);
     bool failed = rdoQuota.downloadData();
     if(failed){
       std::cerr << "random-dot-org: Failed to download quota" << std::endl;
@@ -66,8 +154,52 @@ int main(int argc, char** argv)
     }
   }
 
+  // --------------------------------------------
+  // large downloads, binary data and batches of jobs
+  if(!opt.stream && ChunkedCount(opt) > kMaxChunk) return DownloadChunked(opt);
+  if(opt.type=="binary"){
+    if(opt.stream) return StreamBinary(opt);
+    return DownloadBinary(opt);
+  }
+  if(opt.type=="batch") return RunBatch(opt);
+  if(opt.type=="bench") return RunBench(opt);
+
   // --------------------------------------------
   // create/set the object
+  RdoAbsObject* rdo = CreateObject(opt);
+  if(!rdo){
+    std::cerr << "random-dot-org: Unknown data type = " << opt.type.c_str() << std::endl;
+    PrintUsage(std::cerr);
+    return -1;
+  }
+  if(CheckOutFormat(opt)){
+    delete rdo;
+    return -1;
+  }
+
+  // --------------------------------------------
+  // get the random data (typed binary output is written from memory)
+  bool failed = rdo->downloadData();
+  if(opt.pLevel > 0) RdoTransferStats::printTransfer(std::clog, rdo->lastTransferStats());
+  if(!failed && opt.outFormat!="") failed = WriteArray(*rdo, opt);
+  if(failed){
+    std::cerr << "random-dot-org: Failed to download " << opt.type.c_str() << " data" << std::endl;
+    if(rdo) delete rdo;
+    return -1;
+  }
+
+  // --------------------------------------------
+  // clean & return
+  if(rdo) delete rdo;
+  return 0;
+}
+
+//_____________________________________________________________________________
+//! create and set the object for the type of data in opt; 0 for an unknown type
+RdoAbsObject* CreateObject(const RdoOptions& opt)
+{
+  // typed binary output is parsed in one column; columns only shape the array
+  unsigned int columns = (opt.outFormat!="") ? 1 : opt.columns;
   RdoAbsObject* rdo = 0;
   if(opt.type=="quota"){
     rdo = new RdoQuota();
@@ -79,13 +211,13 @@ int main(int argc, char** argv)
     ((RdoIntegers*)rdo)->setNum(opt.num);
     ((RdoIntegers*)rdo)->setBase(opt.base.c_str());
     ((RdoIntegers*)rdo)->setRange(opt.min, opt.max);
-    ((RdoIntegers*)rdo)->setColumns(opt.columns);
+    ((RdoIntegers*)rdo)->setColumns(columns);
   } 
 
   else if(opt.type=="sequence"){
     rdo = new RdoSequence();
     ((RdoSequence*)rdo)->setRange(opt.min, opt.max);
-    ((RdoSequence*)rdo)->setColumns(opt.columns);    
+    ((RdoSequence*)rdo)->setColumns(columns);    
   }
 
   else if(opt.type=="strings"){
@@ -102,50 +234,45 @@ int main(int argc, char** argv)
     rdo = new RdoRandom();
     ((RdoRandom*)rdo)->setNum(opt.num);
     ((RdoRandom*)rdo)->setDecimals(opt.length);
-    ((RdoRandom*)rdo)->setColumns(opt.columns);
+    ((RdoRandom*)rdo)->setColumns(columns);
   }
 
   else if(opt.type=="bytes"){
     rdo = new RdoBytes();
     ((RdoBytes*)rdo)->setNum(opt.num);
     ((RdoBytes*)rdo)->setBase(opt.base.c_str());    
-    ((RdoBytes*)rdo)->setColumns(opt.columns);
+    ((RdoBytes*)rdo)->setColumns(columns);
   }
 
   else if(opt.type=="binary"){
-    return DownloadBinary(opt);
+    // Note: num interpreted as bits!!
+    unsigned int nBytes = (unsigned int)(opt.num/8.);
+    if(opt.num % 8) nBytes += 1;
+    rdo = new RdoBytes();
+    ((RdoBytes*)rdo)->setNum(nBytes);
+    ((RdoBytes*)rdo)->setBase("2");
+    ((RdoBytes*)rdo)->setColumns(1);
+    rdo->setInMemory(true);
   }
 
-  else{
-    std::cerr << "random-dot-org: Unknown data type = " << opt.type.c_str() << std::endl;
-    PrintUsage(std::cerr);
-    if(rdo) delete rdo;
-    return -1;
-  }
+  else return 0;
+
+  // typed binary output is written from memory
+  if(opt.outFormat!="") rdo->setInMemory(true);
 
   // --------------------------------------------
   // set the general settings
   rdo->setHttps(opt.useHTTPS);
+  rdo->setRdoUrl(opt.host.c_str());
   rdo->setAgent(opt.agent.c_str());
   rdo->setProxy(opt.proxy.c_str());
   rdo->setProxyType(opt.proxyType.c_str());
   rdo->setTimeOut(opt.timeout);
   rdo->setOutFileName(opt.outFile.c_str());
   rdo->setAppend(opt.append);  
-
-  // --------------------------------------------
-  // get the random data
-  bool failed = rdo->downloadData();
-  if(failed){
-    std::cerr << "random-dot-org: Failed to download " << opt.type.c_str() << " data" << std::endl;
-    if(rdo) delete rdo;
-    return -1;
-  }
-
-  // --------------------------------------------
-  // clean & return
-  if(rdo) delete rdo;
-  return 0;
+  if(opt.metrics!="") rdo->setMetrics(&gMetrics);
+  if(opt.trace!="") rdo->setObserver(&gTrace);
+  return rdo;
 }
 
 //_____________________________________________________________________________
@@ -154,32 +281,31 @@ int DownloadBinary(RdoOptions& opt)
 {
   // --------------------------------------------
   // create/set the object
-  RdoBytes rdo;
-  // set the general settings
-  rdo.setHttps(opt.useHTTPS);
-  rdo.setAgent(opt.agent.c_str());
-  rdo.setProxy(opt.proxy.c_str());
-  rdo.setProxyType(opt.proxyType.c_str());
-  rdo.setTimeOut(opt.timeout);
-  rdo.setInMemory(true);
+  RdoBytes* rdo = (RdoBytes*)CreateObject(opt);
 
-  // specific settings
-  // Note: num interpreted as bits!!
-  unsigned int nBytes = (unsigned int)(opt.num/8.);
-  if(opt.num % 8) nBytes += 1;
-  rdo.setNum(nBytes);
-  rdo.setBase("2");
-  rdo.setColumns(1);
+  // or from a local rdo-entropyd
+  RdoDaemon daemon(opt.socket.c_str());
+  if(opt.socket!="") rdo->setDaemon(&daemon);
 
   // --------------------------------------------
   // get the random data
-  bool failed = rdo.downloadData();
+  bool failed = rdo->downloadData();
   if(failed){
     std::cerr << "random-dot-org: Failed to download " << opt.type.c_str() << " data" << std::endl;
+    delete rdo;
     return -1;
   }
-  std::vector<unsigned int> data = rdo.cache();
+  failed = WriteBinary(rdo->view(), opt);
+
+  // clean & return
+  delete rdo;
+  return failed ? -1 : 0;
+}
 
+//_____________________________________________________________________________
+//! write bytes in binary format to the out-file or std::cout; true if failed
+bool WriteBinary(RdoCacheView<unsigned char> data, const RdoOptions& opt)
+{
   // --------------------------------------------
   // stream
   std::ofstream ofs;
@@ -189,24 +315,652 @@ int DownloadBinary(RdoOptions& opt)
     else           ofs.open(opt.outFile.c_str(), std::ios_base::out | std::ios_base::binary);
     if(!ofs.is_open()){
       std::cerr << "random-dot-org: Failed to open file " << opt.outFile.c_str() << std::endl;
-      return -1;      
+      return true;      
     }
   }
 
   // --------------------------------------------
   // write binary data
-  for(unsigned int k=0; k<data.size(); k++){
-    char c = static_cast<char>(data[k]);
-    if(toFile) ofs << c;
-    else std::cout << c;
-  }
+  if(toFile) ofs.write((const char*)data.data(), data.size());
+  else std::cout.write((const char*)data.data(), data.size());
 
   // close file
   if(toFile) ofs.close();
-  // return
+  return false;
+}
+
+//_____________________________________________________________________________
+//! check --out-format against the type of data; true if not usable
+bool CheckOutFormat(const RdoOptions& opt)
+{
+  if(opt.outFormat=="") return false;
+  if(!RdoArrayFile::knownFormat(opt.outFormat.c_str())){
+    std::cerr << "random-dot-org: Unknown out-format = " << opt.outFormat.c_str() << std::endl;
+    return true;
+  }
+  if(opt.type!="integers" && opt.type!="sequence" && opt.type!="fractions" && opt.type!="bytes"){
+    std::cerr << "random-dot-org: No out-format for " << opt.type.c_str() << " data" << std::endl;
+    return true;
+  }
+  if(opt.type=="fractions" && opt.outFormat!="raw-f64" && opt.outFormat!="npy"){
+    std::cerr << "random-dot-org: fractions need out-format raw-f64 or npy" << std::endl;
+    return true;
+  }
+  if(opt.append && opt.outFormat=="npy"){
+    std::cerr << "random-dot-org: Cannot append to an npy file" << std::endl;
+    return true;
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+//! write the in-memory data as a typed binary array (--out-format); true if failed
+bool WriteArray(RdoAbsObject& rdo, const RdoOptions& opt)
+{
+  RdoArrayFile out(opt.outFile.c_str(), opt.outFormat.c_str());
+  out.setColumns(opt.columns);
+  out.setAppend(opt.append);
+  return WriteArray(out, rdo, opt);
+}
+
+//_____________________________________________________________________________
+//! write the in-memory data to an array file (whole, or one piece after begin()); true if failed
+bool WriteArray(RdoArrayFile& out, RdoAbsObject& rdo, const RdoOptions& opt)
+{
+  if(opt.type=="integers" || opt.type=="sequence") return out.write(((RdoIntegers&)rdo).view());
+  else if(opt.type=="fractions") return out.write(((RdoRandom&)rdo).view());
+  else if(opt.type=="bytes") return out.writeBytes(((RdoBytes&)rdo).view());
+  return true;
+}
+
+//_____________________________________________________________________________
+//! number of values (bytes for binary) of a download that can be split into chunks; 0 otherwise
+unsigned long ChunkedCount(const RdoOptions& opt)
+{
+  if(opt.type=="integers" || opt.type=="strings" || opt.type=="fractions" || opt.type=="bytes")
+    return opt.num;
+  // binary from rdo-entropyd needs no chunks
+  if(opt.type=="binary" && opt.socket=="") return (opt.num + 7) / 8;
   return 0;
 }
 
+//_____________________________________________________________________________
+//! download more than the server gives per request: concurrent chunks, written in order
+int DownloadChunked(RdoOptions& opt)
+{
+  if(CheckOutFormat(opt)) return -1;
+  // every chunk is unique on its own, not across chunks
+  if(opt.type=="strings" && opt.unique){
+    std::cerr << "random-dot-org: Unique strings need at most " << kMaxChunk << " values" << std::endl;
+    return -1;
+  }
+
+  // --------------------------------------------
+  // plan the chunks; text chunks hold whole rows
+  unsigned long total = ChunkedCount(opt);
+  unsigned long chunkSize = kMaxChunk;
+  bool text = (opt.type!="binary" && opt.outFormat=="");
+  if(text && opt.columns > 1 && opt.columns <= kMaxChunk) chunkSize -= kMaxChunk % opt.columns;
+  unsigned long nChunks = (total + chunkSize - 1) / chunkSize;
+  std::vector<Chunk> chunks(nChunks);
+  for(unsigned long k=0; k<nChunks; k++){
+    chunks[k].tries = 0;
+    chunks[k].done = chunks[k].failed = false;
+  }
+  unsigned int workers = opt.workers > 0 ? opt.workers : 1;
+
+  // --------------------------------------------
+  // open the output; typed arrays get the header for all chunks first
+  FILE* out = stdout;
+  if(opt.outFile!="" && opt.outFormat==""){
+    out = fopen(opt.outFile.c_str(), opt.append ? "ab" : "wb");
+    if(!out){
+      std::cerr << "random-dot-org: Failed to open file " << opt.outFile.c_str() << std::endl;
+      return -1;
+    }
+  }
+  RdoArrayFile array(opt.outFile.c_str(), opt.outFormat.c_str());
+  array.setColumns(opt.columns);
+  array.setAppend(opt.append);
+  if(opt.outFormat!="" && array.begin(opt.type.c_str(), total)) return -1;
+
+  // --------------------------------------------
+  // at most --workers chunks downloading, and as many waiting to be written;
+  // the loop is declared after the chunks, so it stops their transfers first
+  RdoMulti multi;
+  multi.setMaxConnections(workers);
+  unsigned long written = 0, running = 0, values = 0;
+  int ret = 0;
+  bool tty = isatty(2);
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point shown = t0;
+  while(written < nChunks && ret==0){
+    // start new chunks and retry failed ones
+    for(unsigned long k=written; k<nChunks && k<written+2*workers && running<workers; k++){
+      Chunk& c = chunks[k];
+      if(c.rdo && !c.failed) continue;
+      if(c.failed && c.tries >= kChunkTries){
+	std::cerr << "random-dot-org: Failed to download chunk " << k+1 << " of " << nChunks << std::endl;
+	ret = -1;
+	break;
+      }
+      if(!c.rdo){
+	RdoOptions chunkOpt(opt);
+	unsigned long n = (k+1 < nChunks) ? chunkSize : total - k*chunkSize;
+	chunkOpt.num = (opt.type=="binary") ? 8*n : n;
+	c.rdo.reset(CreateObject(chunkOpt));
+	if(text) c.rdo->setOutString(&c.text);
+      }
+      c.failed = false;
+      c.tries++;
+      c.text.clear();
+      bool failed = multi.add(*c.rdo, [&c, &running](RdoAbsObject& /*obj*/, bool failed){
+	  running--;
+	  c.failed = failed;
+	  c.done = !failed;
+	});
+      if(failed) c.failed = true;
+      else running++;
+    }
+    if(ret) break;
+    multi.wait(250);
+
+    // write the finished chunks in order
+    while(written < nChunks && chunks[written].done){
+      Chunk& c = chunks[written];
+      if(opt.outFormat!="" && WriteArray(array, *c.rdo, opt)){
+	ret = -1;
+	break;
+      }
+      bool failed = false;
+      if(text) failed = (fwrite(c.text.data(), 1, c.text.size(), out)!=c.text.size());
+      else if(opt.type=="binary"){
+	RdoCacheView<unsigned char> data = ((RdoBytes*)c.rdo.get())->view();
+	failed = (fwrite(data.data(), 1, data.size(), out)!=data.size());
+      }
+      if(failed){
+	std::cerr << "random-dot-org: Failed to write output: " << strerror(errno) << std::endl;
+	ret = -1;
+	break;
+      }
+      values += (written+1 < nChunks) ? chunkSize : total - written*chunkSize;
+      c.rdo.reset();
+      std::string().swap(c.text);
+      written++;
+    }
+
+    // progress and throughput, at most once per second
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(now - shown >= std::chrono::seconds(1) || written==nChunks){
+      shown = now;
+      double dt = std::chrono::duration<double>(now - t0).count();
+      std::cerr << "random-dot-org: " << values << "/" << total << (opt.type=="binary" ? " bytes" : " values")
+		<< " (" << std::fixed << std::setprecision(1) << 100. * values / total << "%), "
+		<< std::setprecision(0) << (dt > 0. ? values / dt : 0.) << "/s"
+		<< (tty && written < nChunks ? "\r" : "\n") << std::flush;
+    }
+  }
+
+  // --------------------------------------------
+  // clean & return
+  if(array.end()) ret = -1;
+  if(out!=stdout) fclose(out);
+  else fflush(out);
+  return ret;
+}
+
+//_____________________________________________________________________________
+//! stream binary data until the limit, a signal or the reader goes away
+int StreamBinary(RdoOptions& opt)
+{
+  // --------------------------------------------
+  // open the output; a file or a FIFO
+  FILE* out = stdout;
+  if(opt.outFile!=""){
+    out = fopen(opt.outFile.c_str(), opt.append ? "ab" : "wb");
+    if(!out){
+      std::cerr << "random-dot-org: Failed to open file " << opt.outFile.c_str() << std::endl;
+      return -1;
+    }
+  }
+  signal(SIGINT, StopStream);
+  signal(SIGTERM, StopStream);
+  signal(SIGPIPE, SIG_IGN);
+
+  // --------------------------------------------
+  // overlapping downloads; at most one queued block per worker
+  if(opt.workers < 1) opt.workers = 1;
+  StreamQueue queue;
+  queue.capacity = opt.workers;
+  queue.requested = 0;
+  queue.done = false;
+  std::vector<std::thread> workers;
+  for(unsigned int w=0; w<opt.workers; w++)
+    workers.push_back(std::thread(StreamWorker, &opt, &queue));
+
+  // --------------------------------------------
+  // write the blocks as they arrive
+  int ret = 0;
+  unsigned long long written = 0;
+  while(!gStop && (opt.limit==0 || written < opt.limit)){
+    std::vector<unsigned char> block;
+    {
+      std::unique_lock<std::mutex> lock(queue.mutex);
+      while(!gStop && queue.blocks.empty())
+	queue.pushed.wait_for(lock, std::chrono::milliseconds(250));
+      if(queue.blocks.empty()) break;
+      block.swap(queue.blocks.front());
+      queue.blocks.pop_front();
+    }
+    queue.popped.notify_one();
+
+    size_t n = block.size();
+    if(opt.limit && written + n > opt.limit) n = opt.limit - written;
+    bool failed = (fwrite(block.data(), 1, n, out)!=n || fflush(out)!=0);
+    memset(block.data(), 0, block.size());
+    if(failed){
+      // e.g. the reader closed the pipe
+      if(errno!=EPIPE){
+	std::cerr << "random-dot-org: Failed to write stream: " << strerror(errno) << std::endl;
+	ret = -1;
+      }
+      break;
+    }
+    written += n;
+  }
+
+  // --------------------------------------------
+  // stop the workers; clean & return
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.done = true;
+    for(unsigned int k=0; k<queue.blocks.size(); k++)
+      memset(queue.blocks[k].data(), 0, queue.blocks[k].size());
+  }
+  queue.popped.notify_all();
+  for(unsigned int w=0; w<workers.size(); w++) workers[w].join();
+  if(out!=stdout) fclose(out);
+  if(opt.pLevel > 0)
+    std::clog << "random-dot-org: Streamed " << written << " bytes" << std::endl;
+  return ret;
+}
+
+//_____________________________________________________________________________
+//! download blocks for the stream; waits while the queue is full
+void StreamWorker(const RdoOptions* opt, StreamQueue* queue)
+{
+  // each worker keeps its own connection, and one object downloading
+  // through it (its cURL handle reuses the connection)
+  RdoDaemon daemon(opt->socket.c_str());
+  RdoBytes rdo;
+  rdo.setHttps(opt->useHTTPS);
+  rdo.setRdoUrl(opt->host.c_str());
+  rdo.setAgent(opt->agent.c_str());
+  rdo.setProxy(opt->proxy.c_str());
+  rdo.setProxyType(opt->proxyType.c_str());
+  rdo.setTimeOut(opt->timeout);
+  rdo.setInMemory(true);
+  rdo.setBase("16");
+  rdo.setColumns(1);
+  if(opt->socket!="") rdo.setDaemon(&daemon);
+  if(opt->metrics!="") rdo.setMetrics(&gMetrics);
+  if(opt->trace!="") rdo.setObserver(&gTrace);
+  unsigned int backOff = 1;
+  while(true){
+    // back-pressure: wait for room, and stop at the limit
+    unsigned int num = kStreamChunk;
+    {
+      std::unique_lock<std::mutex> lock(queue->mutex);
+      while(!queue->done && !gStop && queue->blocks.size() >= queue->capacity)
+	queue->popped.wait_for(lock, std::chrono::milliseconds(250));
+      if(queue->done || gStop) return;
+      if(opt->limit){
+	if(queue->requested >= opt->limit) return;
+	if(opt->limit - queue->requested < num) num = opt->limit - queue->requested;
+      }
+      queue->requested += num;
+    }
+
+    rdo.setNum(num);
+
+    // back off after failures and give the bytes back
+    if(rdo.downloadData()){
+      {
+	std::lock_guard<std::mutex> lock(queue->mutex);
+	queue->requested -= num;
+      }
+      std::cerr << "random-dot-org: Download failed, retrying in " << backOff << " s" << std::endl;
+      for(unsigned int s=0; s<4*backOff && !gStop && !queue->done; s++)
+	std::this_thread::sleep_for(std::chrono::milliseconds(250));
+      if(backOff < kMaxBackOff) backOff *= 2;
+      continue;
+    }
+    backOff = 1;
+
+    // take the block out, leaving the cache empty for the next one
+    std::vector<unsigned char> block = rdo.take();
+    {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      queue->blocks.push_back(std::vector<unsigned char>());
+      queue->blocks.back().swap(block);
+    }
+    queue->pushed.notify_one();
+  }
+}
+
+//_____________________________________________________________________________
+//! run the jobs in opt.input, one argument set per line, as concurrent downloads
+int RunBatch(RdoOptions& opt)
+{
+  std::ifstream ifs(opt.input.c_str());
+  if(opt.input=="" || !ifs.is_open()){
+    std::cerr << "random-dot-org: Failed to open jobs file " << opt.input.c_str() << std::endl;
+    return -1;
+  }
+
+  // --------------------------------------------
+  // parse all jobs first; the batch's own options are their defaults
+  std::vector<RdoOptions> jobs;
+  std::vector<unsigned int> lines;
+  std::string line;
+  unsigned int lineNo = 0;
+  bool bad = false;
+  while(std::getline(ifs, line)){
+    lineNo++;
+    std::vector<std::string> args;
+    if(SplitLine(line, args)){
+      std::cerr << "random-dot-org: " << opt.input.c_str() << ":" << lineNo << ": Unbalanced quote" << std::endl;
+      bad = true;
+      continue;
+    }
+    if(args.empty() || args[0][0]=='#') continue;
+
+    std::vector<char*> argv(1, (char*)"random-dot-org");
+    for(unsigned int k=0; k<args.size(); k++) argv.push_back(&args[k][0]);
+    argv.push_back(0);
+    RdoOptions job(opt);
+    job.help = false;
+    job.type = job.input = job.outFile = "";
+    job.append = job.stream = job.quota = false;
+    job.parseCmdLine(argv.size()-1, &argv[0]);
+
+    if(job.help || job.type=="batch" || job.stream || job.input!=""){
+      std::cerr << "random-dot-org: " << opt.input.c_str() << ":" << lineNo << ": Invalid job" << std::endl;
+      bad = true;
+      continue;
+    }
+    // each result goes to its own file
+    if(job.outFile==""){
+      std::ostringstream name;
+      name << opt.input << "." << jobs.size()+1;
+      job.outFile = name.str();
+    }
+    jobs.push_back(job);
+    lines.push_back(lineNo);
+  }
+
+  // --------------------------------------------
+  // create the objects
+  std::vector<RdoAbsObject*> rdos(jobs.size(), (RdoAbsObject*)0);
+  for(unsigned int k=0; k<jobs.size(); k++){
+    rdos[k] = CreateObject(jobs[k]);
+    if(!rdos[k]){
+      std::cerr << "random-dot-org: " << opt.input.c_str() << ":" << lines[k] 
+		<< ": Unknown data type = " << jobs[k].type.c_str() << std::endl;
+      bad = true;
+    }
+    else if(CheckOutFormat(jobs[k])) bad = true;
+  }
+
+  // --------------------------------------------
+  // run them concurrently, over --workers shared connections
+  unsigned int nFailed = 0;
+  if(!bad){
+    RdoMulti multi;
+    multi.setMaxConnections(opt.workers > 0 ? opt.workers : 1);
+    for(unsigned int k=0; k<jobs.size(); k++){
+      const RdoOptions* job = &jobs[k];
+      unsigned int line = lines[k];
+      std::string input = opt.input;
+      RdoMulti::Callback done = [job, line, input, &nFailed](RdoAbsObject& obj, bool failed){
+	if(!failed && job->outFormat!="") failed = WriteArray(obj, *job);
+	else if(!failed && job->type=="binary") failed = WriteBinary(((RdoBytes&)obj).view(), *job);
+	if(failed){
+	  std::cerr << "random-dot-org: " << input.c_str() << ":" << line << ": Failed to download " 
+		    << job->type.c_str() << " data" << std::endl;
+	  nFailed++;
+	}
+	else if(job->pLevel > 0)
+	  std::clog << "random-dot-org: " << input.c_str() << ":" << line << ": Wrote " << job->outFile.c_str() << std::endl;
+      };
+      if(multi.add(*rdos[k], done)) nFailed++;
+    }
+    multi.run();
+    if(opt.pLevel > 0)
+      std::clog << "random-dot-org: Ran " << jobs.size() << " jobs, " << nFailed << " failed" << std::endl;
+  }
+
+  // --------------------------------------------
+  // clean & return
+  for(unsigned int k=0; k<rdos.size(); k++) if(rdos[k]) delete rdos[k];
+  return (bad || nFailed) ? -1 : 0;
+}
+
+//_____________________________________________________________________________
+//! split a jobs line into arguments at white space, honoring '' and "" quotes; true if failed
+bool SplitLine(const std::string& line, std::vector<std::string>& args)
+{
+  std::string arg;
+  bool inArg = false;
+  char quote = 0;
+  for(unsigned int k=0; k<line.size(); k++){
+    char c = line[k];
+    if(quote){
+      if(c==quote) quote = 0;
+      else arg += c;
+    }
+    else if(c=='\'' || c=='"'){ quote = c; inArg = true; }
+    else if(c==' ' || c=='\t' || c=='\r'){
+      if(inArg) args.push_back(arg);
+      arg.clear();
+      inArg = false;
+    }
+    else{ arg += c; inArg = true; }
+  }
+  if(inArg) args.push_back(arg);
+  return quote!=0;
+}
+
+//_____________________________________________________________________________
+//! run --requests requests of the mix in opt.input against --host, keeping
+//! --workers in flight, and report throughput and latency percentiles
+int RunBench(RdoOptions& opt)
+{
+  std::vector<RdoOptions> mix;
+  if(ParseMix(opt, mix)) return -1;
+  unsigned int workers = opt.workers > 0 ? opt.workers : 1;
+
+  if(opt.reportFormat!="table" && opt.reportFormat!="json"){
+    std::cerr << "random-dot-org: Unknown report-format = " << opt.reportFormat.c_str() << std::endl;
+    return -1;
+  }
+
+  // --------------------------------------------
+  // closed loop: every finished request starts the next of the mix; the
+  // latencies of each phase (connect includes the name lookup, first byte
+  // is the wait after the handshakes) are kept and the object is freed,
+  // so only the requests in flight hold objects and handles
+  const char* names[5] = {"connect", "tls", "first_byte", "transfer", "total"};
+  std::vector<double> phases[5];
+  for(unsigned int i=0; i<5; i++) phases[i].reserve(opt.requests);
+  RdoMulti multi;
+  multi.setMaxConnections(workers);
+  RdoTransferStats stats(opt.requests > 0 ? opt.requests : 1);
+  unsigned long nStarted = 0, nFailed = 0, nValues = 0;
+  std::function<void()> start;
+  start = [&](){
+    while(nStarted < opt.requests){
+      const RdoOptions& job = mix[nStarted % mix.size()];
+      nStarted++;
+      RdoAbsObject* rdo = CreateObject(job);
+      rdo->setInMemory(true);
+      RdoMulti::Callback done = [&job, &nValues, &nFailed, &stats, &phases, &start](RdoAbsObject& obj, bool failed){
+	const RdoAbsObject::TransferStats& t = obj.lastTransferStats();
+	stats.add(t);
+	if(!t.failed){
+	  phases[0].push_back(t.dns + t.connect);
+	  phases[1].push_back(t.tls);
+	  phases[2].push_back(t.ttfb - t.dns - t.connect - t.tls);
+	  phases[3].push_back(t.total - t.ttfb);
+	  phases[4].push_back(t.total);
+	}
+	if(failed) nFailed++;
+	else nValues += BenchValues(job);
+	delete &obj;   // RdoMulti is done with it once its callback runs
+	start();
+      };
+      if(!multi.add(*rdo, done)) return;
+      delete rdo;
+      nFailed++;
+    }
+  };
+
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for(unsigned int k=0; k<workers; k++) start();
+  multi.run();
+  double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  if(dt <= 0.) dt = 1e-9;
+  unsigned long nConnects = stats.nTransfers() - stats.nReused();
+  double nBytes = stats.bytes();
+
+  // --------------------------------------------
+  // percentiles of each phase, in ms
+  const double ps[3] = {50., 95., 99.};
+  double lat[5][3];
+  for(unsigned int i=0; i<5; i++)
+    for(unsigned int j=0; j<3; j++) lat[i][j] = Percentile(phases[i], ps[j]) * 1e3;
+
+  // --------------------------------------------
+  // report, as a table or as JSON
+  std::ofstream ofs;
+  if(opt.outFile!=""){
+    ofs.open(opt.outFile.c_str(), opt.append ? std::ios_base::app : std::ios_base::out);
+    if(!ofs.is_open()){
+      std::cerr << "random-dot-org: Failed to open file " << opt.outFile.c_str() << std::endl;
+      return -1;
+    }
+  }
+  std::ostream& os = (opt.outFile!="") ? ofs : std::cout;
+  std::string url = std::string(opt.useHTTPS ? "https://" : "http://") + opt.host;
+
+  if(opt.reportFormat=="json"){
+    std::string s;
+    os << "{\"url\": ";
+    RdoJson::quote(s, url.c_str());
+    os << s << ", \"workers\": " << workers << ", \"mix\": [";
+    for(unsigned int k=0; k<mix.size(); k++){
+      s.clear();
+      RdoJson::quote(s, mix[k].type.c_str());
+      os << (k ? ", " : "") << "{\"type\": " << s << ", \"number\": " << mix[k].num << "}";
+    }
+    os << "], \"requests\": " << nStarted << ", \"failed\": " << nFailed
+       << ", \"connections\": " << nConnects << ", \"seconds\": " << dt
+       << ", \"requests_per_s\": " << (nStarted - nFailed) / dt
+       << ", \"values_per_s\": " << nValues / dt
+       << ", \"bytes_per_s\": " << nBytes / dt << ", \"latency_ms\": {";
+    for(unsigned int i=0; i<5; i++){
+      os << (i ? ", " : "") << "\"" << names[i] << "\": {";
+      for(unsigned int j=0; j<3; j++) os << (j ? ", " : "") << "\"p" << ps[j] << "\": " << lat[i][j];
+      os << "}";
+    }
+    os << "}}" << std::endl;
+  }
+  else{
+    os << "bench: " << url.c_str() << ", " << nStarted << " requests (" << nFailed << " failed) over "
+       << workers << " workers and " << nConnects << " connections in " << dt << " s" << std::endl;
+    os << "  requests/s: " << (nStarted - nFailed) / dt << std::endl;
+    os << "  values/s:   " << nValues / dt << std::endl;
+    os << "  bytes/s:    " << nBytes / dt << std::endl;
+    os << "  latency (ms)       p50        p95        p99" << std::endl;
+    for(unsigned int i=0; i<5; i++){
+      os << "  " << std::left << std::setw(12) << names[i] << std::right;
+      for(unsigned int j=0; j<3; j++) os << " " << std::setw(10) << lat[i][j];
+      os << std::endl;
+    }
+  }
+  return nFailed ? -1 : 0;
+}
+
+//_____________________________________________________________________________
+//! parse the bench mix, comma-separated type[:number] items (the number is
+//! the largest integer for sequence, bits for binary); true if failed
+bool ParseMix(const RdoOptions& opt, std::vector<RdoOptions>& mix)
+{
+  std::string spec = (opt.input!="") ? opt.input : kBenchMix;
+  std::istringstream iss(spec);
+  std::string item;
+  while(std::getline(iss, item, ',')){
+    if(item=="") continue;
+    RdoOptions job(opt);
+    job.type = item.substr(0, item.find(':'));
+    if(item.find(':')!=std::string::npos) job.num = atol(item.c_str() + item.find(':') + 1);
+    if(job.type=="sequence"){ job.min = 1; job.max = job.num; }
+    job.outFile = job.outFormat = "";
+    job.columns = 1;
+    if(job.type!="quota" && job.type!="integers" && job.type!="sequence" && job.type!="strings" &&
+       job.type!="fractions" && job.type!="bytes" && job.type!="binary"){
+      std::cerr << "random-dot-org: Unknown data type in bench mix = " << job.type.c_str() << std::endl;
+      return true;
+    }
+    if(job.num < 1){
+      std::cerr << "random-dot-org: Invalid number in bench mix item " << item.c_str() << std::endl;
+      return true;
+    }
+    mix.push_back(job);
+  }
+  if(mix.empty()){
+    std::cerr << "random-dot-org: Empty bench mix" << std::endl;
+    return true;
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+//! number of values one request of a bench mix item returns
+unsigned long BenchValues(const RdoOptions& job)
+{
+  if(job.type=="quota") return 1;
+  if(job.type=="sequence") return job.max - job.min + 1;
+  if(job.type=="binary") return (job.num + 7) / 8;
+  return job.num;
+}
+
+//_____________________________________________________________________________
+//! p-th percentile (nearest rank) of values; 0 if empty
+double Percentile(std::vector<double> values, double p)
+{
+  if(values.empty()) return 0.;
+  std::sort(values.begin(), values.end());
+  unsigned long rank = (unsigned long)ceil(p / 100. * values.size());
+  if(rank < 1) rank = 1;
+  return values[rank-1];
+}
+
+//_____________________________________________________________________________
+//! write the metrics and the trace, if asked for
+ExitWriter::~ExitWriter()
+{
+  if(metrics!="") gMetrics.write(metrics.c_str());
+  if(trace!="") gTrace.write(trace.c_str());
+}
+
+//_____________________________________________________________________________
+//! signal handler; stop streaming
+void StopStream(int /*sig*/)
+{
+  gStop = 1;
+}
+
 //_____________________________________________________________________________
 //! print random-dot-org usage to stream
 void PrintUsage(std::ostream& os)
@@ -223,6 +977,8 @@ void PrintUsage(std::ostream& os)
   os << "  fractions   download decimal fractions" << std::endl;
   os << "  bytes       download random bytes" << std::endl;
   os << "  binary      download random bytes to binary format" << std::endl;
+  os << "  batch       run the jobs in a file concurrently" << std::endl;
+  os << "  bench       measure throughput and latency of a mix of requests" << std::endl;
 
   // general options
   os << std::endl;
@@ -234,10 +990,17 @@ void PrintUsage(std::ostream& os)
   os << "  --proxy, -x        127.0.0.1:9050  connect through [proxy-url]:[port-number]" << std::endl;
   os << "  --proxy-type, -y   SOCKS4a         type of proxy; HTTP, SOCKS4, SOCKS4a, SOCKS5" << std::endl;
   os << "  --time-out, -t     120             time in seconds to wait for server" << std::endl;
+  os << "  --host, -H         www.random.org  server [host]:[port-number]" << std::endl;
   os << "  --out-file, -o     data.txt        write to file instead of std::cout" << std::endl;
   os << "  --append, -a                       append to out-file instead of overwriting" << std::endl;
   os << "  --format, -f       plain           format of file to write; plain or html" << std::endl;
+  os << "  --out-format, -O   npy             write integers, sequence, fractions or bytes as a typed" << std::endl;
+  os << "                                     binary array; raw-i32, raw-i64, raw-f64 or npy" << std::endl;
   os << "  --quota, -Q                        check your quota before downloading random data" << std::endl;
+  os << "  --metrics, -M      rdo.prom        write Prometheus metrics at exit to a file, or to" << std::endl;
+  os << "                                     a listening socket given as unix:/path/to/socket" << std::endl;
+  os << "  --trace, -T        rdo.trace.json  write a Chrome trace (chrome://tracing, Perfetto) of" << std::endl;
+  os << "                                     the requests at exit" << std::endl;
 
   // integers options
   os << std::endl;
@@ -247,13 +1010,18 @@ void PrintUsage(std::ostream& os)
   // integers options
   os << std::endl;
   os << "integers Options:" << std::endl;
-  os << "  --number, -n       100             number of integers to download; [1,1e4]" << std::endl;
+  os << "  --number, -n       100             number of integers to download; [1,1e4] per request," << std::endl;
+  os << "                                     more are fetched in --workers concurrent requests" << std::endl;
   os << "  --min, -l          1               minimum possible integer; [-1e9,1e9]" << std::endl;
   os << "  --max, -u          10000           maximum possible integer; [-1e9,1e9]" << std::endl;
   os << "  --base, -b         10              base for the number system; 2, 8, 10 or 16" << std::endl;
   os << "  --columns, -c      1               number of columns in ouput; [1,1e9]" << std::endl;
   os << "Example: random-dot-org integers" << std::endl;
   os << "         Will write 10 integers within [1,10000] to std::cout." << std::endl;
+  os << "Example: random-dot-org integers -n 1000000 -W 4 -o ints.txt" << std::endl;
+  os << "         Will download 100 chunks of 10000 integers, 4 at a time, and write them in order." << std::endl;
+  os << "Example: random-dot-org integers -n 1000 -c 10 --out-format npy -o ints.npy" << std::endl;
+  os << "         Will write 1000 integers as a 100x10 int64 NumPy array." << std::endl;
 
   // sequence options
   os << std::endl;
@@ -267,7 +1035,8 @@ void PrintUsage(std::ostream& os)
   // strings options
   os << std::endl;
   os << "strings Options:" << std::endl;
-  os << "  --number, -n       100             number of strings to download; [1,1e4]" << std::endl;
+  os << "  --number, -n       100             number of strings to download; [1,1e4] per request," << std::endl;
+  os << "                                     more are fetched in --workers concurrent requests" << std::endl;
   os << "  --length, -s       8               length of strings to download; [1,20]" << std::endl;
   os << "  --not-lower, -k                    exclude lowercase alphabetic characters (default is false)" << std::endl;
   os << "  --digits, -d                       use digits" << std::endl;
@@ -280,7 +1049,8 @@ void PrintUsage(std::ostream& os)
   // fractions options
   os << std::endl;
   os << "fractions Options:" << std::endl;
-  os << "  --number, -n       100             number of fractions to download; [1,1e4]" << std::endl;
+  os << "  --number, -n       100             number of fractions to download; [1,1e4] per request," << std::endl;
+  os << "                                     more are fetched in --workers concurrent requests" << std::endl;
   os << "  --length, -s       8               length, e.g. number of decimal places; [1,20]" << std::endl;
   os << "  --columns, -c      1               number of columns in output; [1,1e9]" << std::endl;
   os << "Example: random-dot-org fractions" << std::endl;
@@ -289,7 +1059,8 @@ void PrintUsage(std::ostream& os)
   // bytes options
   os << std::endl;
   os << "bytes Options:" << std::endl;
-  os << "  --number, -n       100             number of bytes to download; [1,1e4]" << std::endl;
+  os << "  --number, -n       100             number of bytes to download; [1,1e4] per request," << std::endl;
+  os << "                                     more are fetched in --workers concurrent requests" << std::endl;
   os << "  --base, -b         10              base for the number system; 2, 8, 10 or 16" << std::endl;
   os << "  --columns, -c      1               number of columns in output; [1,1e9]" << std::endl;
   os << "Example: random-dot-org bytes" << std::endl;
@@ -299,7 +1070,35 @@ void PrintUsage(std::ostream& os)
   os << std::endl;
   os << "binary Options:" << std::endl;
   os << "  --number, -n       100            number of bits (NOT bytes!!)" << std::endl;
-  os << "                                    rounded up to nearest byte to download; [1,8e4]" << std::endl;
+  os << "                                    rounded up to nearest byte to download; [1,8e4] per request," << std::endl;
+  os << "                                    more are fetched in --workers concurrent requests" << std::endl;
+  os << "  --socket, -U       /tmp/rdo.sock  get the bytes from rdo-entropyd listening on [socket]" << std::endl;
+  os << "  --stream, -e                      keep streaming bytes until the limit or a signal" << std::endl;
+  os << "  --limit, -L        1048576        number of bytes to stream (default: no limit)" << std::endl;
+  os << "  --workers, -W      2              number of overlapping downloads when streaming or chunking" << std::endl;
   os << "Example: random-dot-org binary" << std::endl;
   os << "         Will write 16 bits in binary format to std::cout." << std::endl;
+  os << "Example: random-dot-org binary --stream --limit 1048576 -o /tmp/rdo.fifo" << std::endl;
+  os << "         Will feed 1 MiB to a FIFO, fetching only as fast as it is read." << std::endl;
+
+  // batch options
+  os << std::endl;
+  os << "batch Options:" << std::endl;
+  os << "  [jobs-file]        jobs.txt       one job per line, e.g. 'integers -n 100 -o ints.txt'" << std::endl;
+  os << "  --workers, -W      2              number of concurrent downloads" << std::endl;
+  os << "Example: random-dot-org batch jobs.txt --workers 8" << std::endl;
+  os << "         Will run all jobs in one process over shared connections; results of" << std::endl;
+  os << "         jobs without --out-file go to jobs.txt.1, jobs.txt.2, ..." << std::endl;
+
+  // bench options
+  os << std::endl;
+  os << "bench Options:" << std::endl;
+  os << "  [mix]              integers:100   comma-separated type:number items, requested in turn;" << std::endl;
+  os << "                                    default " << kBenchMix << std::endl;
+  os << "  --requests, -R     100            number of requests" << std::endl;
+  os << "  --workers, -W      2              number of requests in flight" << std::endl;
+  os << "  --report-format, -F json          print the results as a table (default) or as JSON" << std::endl;
+  os << "Example: random-dot-org bench integers:1000,bytes:10000 -R 500 -W 8 -X -H localhost:8080 -F json" << std::endl;
+  os << "         Will report requests/s, values/s, bytes/s and the p50/p95/p99 latency of" << std::endl;
+  os << "         connect, TLS, first byte and transfer against a local stand-in server." << std::endl;
 }
@@ -0,0 +1,582 @@
+/** \file rdo-bench.cxx
+    \brief Source for rdo-bench binary executable
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>     // general utilities
+#include <stdio.h>      // snprintf
+#include <string.h>     // memcpy, strlen
+#include <math.h>       // pow, log, sqrt, cos
+#include <getopt.h>     // GNU option parsing
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include "RdoIntegers.hh"
+#include "RdoRandom.hh"
+#include "RdoStrings.hh"
+#include "RdoBytes.hh"
+#include "RdoQuota.hh"
+#include "RdoJson.hh"
+
+// values in every canned response (the random.org maximum per request)
+static const unsigned int kValues = 10000;
+
+// --------------------------------------------
+// allocation counting: with glibc, malloc, calloc and realloc (and so
+// operator new, also from libRdO and libcurl) are counted on their way
+// to the C library
+static std::atomic<unsigned long long> gAllocs(0);
+#if defined(__GLIBC__)
+#define RDO_BENCH_ALLOCS 1
+extern "C" {
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t n, size_t size);
+  void* __libc_realloc(void* ptr, size_t size);
+  void* malloc(size_t size)
+  { gAllocs.fetch_add(1, std::memory_order_relaxed); return __libc_malloc(size); }
+  void* calloc(size_t n, size_t size)
+  { gAllocs.fetch_add(1, std::memory_order_relaxed); return __libc_calloc(n, size); }
+  void* realloc(void* ptr, size_t size)
+  { gAllocs.fetch_add(1, std::memory_order_relaxed); return __libc_realloc(ptr, size); }
+}
+#endif
+
+// keeps results alive so the measured loops are not optimized away
+static volatile double gSink = 0;
+
+//! a benchmark case
+struct Case {
+  std::string name;                               //<! group/case
+  double bytes;                                   //<! bytes processed per operation
+  std::function<void(unsigned long)> run;         //<! run n operations
+};
+
+//! the result of a case
+struct Result {
+  std::string name;           //<! group/case
+  unsigned long iterations;   //<! operations per sample
+  std::vector<double> ns;     //<! ns/op of every sample
+  double median;              //<! median ns/op
+  double allocs;              //<! allocations per operation (-1 if not counted)
+  double bytes;               //<! bytes processed per operation
+};
+
+// --------------------------------------------
+// access to the protected parts of the library classes
+//! integers, with parsing and the draw position open
+struct BenchIntegers : public RdoIntegers {
+  void build() { buildUrl(); }
+  void parse(CurlMem cMem) { clearData(); parseMemory(cMem); }
+  void rewind() { _pos = 0; }
+  using RdoIntegers::writeMemoryCallback;
+};
+//! decimal fractions, with parsing and the draw position open
+struct BenchRandom : public RdoRandom {
+  void build() { buildUrl(); }
+  void parse(CurlMem cMem) { _randData.clear(); parseMemory(cMem); }
+  void rewind() { _pos = 0; }
+};
+//! strings, with parsing and the draw position open
+struct BenchStrings : public RdoStrings {
+  void build() { buildUrl(); }
+  void parse(CurlMem cMem) { _randData.clear(); parseMemory(cMem); }
+  void rewind() { _pos = 0; }
+};
+//! bytes, with parsing and the draw position open
+struct BenchBytes : public RdoBytes {
+  void build() { buildUrl(); }
+  void parse(CurlMem cMem) { _randData.clear(); parseMemory(cMem); }
+  void rewind() { _pos = 0; }
+};
+//! quota, with parsing open
+struct BenchQuota : public RdoQuota {
+  void parse(CurlMem cMem) { parseMemory(cMem); }
+};
+
+// methods
+std::vector<Case> MakeCases();
+std::string Canned(const std::string& type);
+Result Calibrate(const Case& c, double minTime);
+void Sample(const Case& c, Result& res);
+void Summarize(Result& res);
+void PrintTable(std::ostream& os, const std::vector<Result>& results);
+void PrintJson(std::ostream& os, const std::vector<Result>& results, unsigned int repeat);
+void PrintUsage(std::ostream& os);
+
+//_____________________________________________________________________________
+//! rdo-bench binary executable main method
+int main(int argc, char** argv)
+{
+  // --------------------------------------------
+  // parse options
+  static struct option long_options[] =
+    {
+      {"help",     no_argument,       0, 'h'},
+      {"list",     no_argument,       0, 'l'},
+      {"repeat",   required_argument, 0, 'r'},
+      {"min-time", required_argument, 0, 't'},
+      {"format",   required_argument, 0, 'f'},
+      {"out-file", required_argument, 0, 'o'},
+      {0, 0, 0, 0}
+    };
+  bool help = false, list = false;
+  unsigned int repeat = 5;
+  double minTime = 0.05;
+  std::string format("plain"), outFile("");
+  int option_index(0), option_char(-1);
+  while((option_char = getopt_long(argc, argv, "h?lr:t:f:o:", long_options, &option_index)) != -1){
+    switch(option_char){
+    case 'h': help = true; break;
+    case '?': help = true; break;
+    case 'l': list = true; break;
+    case 'r': repeat = atoi(optarg); break;
+    case 't': minTime = atof(optarg); break;
+    case 'f': format = std::string(optarg); break;
+    case 'o': outFile = std::string(optarg); break;
+    default:  abort();
+    }
+  }
+  if(help){ PrintUsage(std::cout); return 0; }
+  if(format!="plain" && format!="json"){
+    std::cerr << "rdo-bench: Unknown format = " << format.c_str() << std::endl;
+    return -1;
+  }
+  if(repeat < 1) repeat = 1;
+  if(minTime <= 0.) minTime = 0.05;
+
+  // --------------------------------------------
+  // select the cases: every name containing one of the filters
+  std::vector<Case> cases = MakeCases();
+  std::vector<Case> selected;
+  for(unsigned int i=0; i<cases.size(); i++){
+    bool keep = (optind >= argc);
+    for(int a=optind; a<argc && !keep; a++)
+      keep = cases[i].name.find(argv[a])!=std::string::npos;
+    if(keep) selected.push_back(cases[i]);
+  }
+  if(list){
+    for(unsigned int i=0; i<selected.size(); i++) std::cout << selected[i].name << std::endl;
+    return 0;
+  }
+  if(selected.empty()){
+    std::cerr << "rdo-bench: No benchmark matches" << std::endl;
+    return -1;
+  }
+
+  // --------------------------------------------
+  // measure; the samples go round the cases, so that slow drifts of the
+  // machine (clock speed, neighbours) spread over all of them and show up
+  // in the spread of every case rather than shifting a few
+  std::vector<Result> results;
+  for(unsigned int i=0; i<selected.size(); i++) results.push_back(Calibrate(selected[i], minTime));
+  for(unsigned int r=0; r<repeat; r++)
+    for(unsigned int i=0; i<selected.size(); i++) Sample(selected[i], results[i]);
+  for(unsigned int i=0; i<selected.size(); i++) Summarize(results[i]);
+
+  // --------------------------------------------
+  // report
+  std::ofstream ofs;
+  if(outFile!=""){
+    ofs.open(outFile.c_str());
+    if(!ofs.is_open()){
+      std::cerr << "rdo-bench: Failed to open file " << outFile.c_str() << std::endl;
+      return -1;
+    }
+  }
+  std::ostream& os = (outFile!="") ? ofs : std::cout;
+  if(format=="json") PrintJson(os, results, repeat);
+  else PrintTable(os, results);
+  return 0;
+}
+
+//_____________________________________________________________________________
+//! the benchmark cases
+std::vector<Case> MakeCases()
+{
+  std::vector<Case> cases;
+
+  // shared objects and payloads (kept alive by the closures)
+  std::shared_ptr<BenchIntegers> ints(new BenchIntegers);
+  ints->setNum(kValues);
+  ints->setRange(1, 10000);
+  std::shared_ptr<BenchRandom> fracs(new BenchRandom);
+  fracs->setNum(kValues);
+  std::shared_ptr<BenchStrings> strs(new BenchStrings);
+  strs->setNum(kValues);
+  std::shared_ptr<BenchBytes> bytes(new BenchBytes);
+  bytes->setNum(kValues);
+  std::shared_ptr<BenchQuota> quota(new BenchQuota);
+
+  // --------------------------------------------
+  // URL building: the query alone, then with the cURL options
+  ints->build();
+  cases.push_back({"url/integers", (double)strlen(ints->url()), [ints](unsigned long n){
+	for(unsigned long i=0; i<n; i++) ints->build();
+      }});
+  fracs->build();
+  cases.push_back({"url/fractions", (double)strlen(fracs->url()), [fracs](unsigned long n){
+	for(unsigned long i=0; i<n; i++) fracs->build();
+      }});
+  strs->build();
+  cases.push_back({"url/strings", (double)strlen(strs->url()), [strs](unsigned long n){
+	for(unsigned long i=0; i<n; i++) strs->build();
+      }});
+  cases.push_back({"url/integers-setUrl", (double)strlen(ints->url()), [ints](unsigned long n){
+	for(unsigned long i=0; i<n; i++) ints->setUrl();
+      }});
+
+  // --------------------------------------------
+  // response assembly by the libCURL write callback, one whole
+  // integers response per operation
+  std::shared_ptr<std::string> intsText(new std::string(Canned("integers")));
+  for(size_t chunk : {(size_t)1024, (size_t)16384}){
+    std::string name = "write/callback-" + std::to_string(chunk / 1024) + "k";
+    cases.push_back({name, (double)intsText->size(), [intsText, chunk](unsigned long n){
+	  for(unsigned long i=0; i<n; i++){
+	    RdoAbsObject::CurlMem mem = {(char*)malloc(1), 0};
+	    for(size_t pos=0; pos<intsText->size(); pos+=chunk){
+	      size_t len = std::min(chunk, intsText->size() - pos);
+	      BenchIntegers::writeMemoryCallback((void*)(intsText->data() + pos), 1, len, &mem);
+	    }
+	    gSink = gSink + mem.size;
+	    free(mem.memory);
+	  }
+	}});
+  }
+
+  // --------------------------------------------
+  // parsing canned responses; the payload is copied to a scratch buffer
+  // first as parsing tokenizes in place
+  struct Parser {
+    std::string name;
+    std::string text;
+    std::function<void(RdoAbsObject::CurlMem)> parse;
+  };
+  std::vector<Parser> parsers = {
+    {"parse/integers", *intsText, [ints](RdoAbsObject::CurlMem m){ ints->parse(m); }},
+    {"parse/fractions", Canned("fractions"), [fracs](RdoAbsObject::CurlMem m){ fracs->parse(m); }},
+    {"parse/strings", Canned("strings"), [strs](RdoAbsObject::CurlMem m){ strs->parse(m); }},
+    {"parse/bytes", Canned("bytes"), [bytes](RdoAbsObject::CurlMem m){ bytes->parse(m); }},
+    {"parse/quota", Canned("quota"), [quota](RdoAbsObject::CurlMem m){ quota->parse(m); }}
+  };
+  for(unsigned int p=0; p<parsers.size(); p++){
+    std::shared_ptr<std::vector<char> > buf(new std::vector<char>(parsers[p].text.size() + 1));
+    std::shared_ptr<std::string> text(new std::string(parsers[p].text));
+    std::function<void(RdoAbsObject::CurlMem)> parse = parsers[p].parse;
+    for(bool health : {true, false}){
+      cases.push_back({parsers[p].name + (health ? "" : "-nohealth"), (double)text->size(),
+	    [buf, text, parse, health, ints, fracs, strs, bytes](unsigned long n){
+	    ints->setHealthTests(health);
+	    fracs->setHealthTests(health);
+	    strs->setHealthTests(health);
+	    bytes->setHealthTests(health);
+	    for(unsigned long i=0; i<n; i++){
+	      memcpy(buf->data(), text->c_str(), text->size() + 1);
+	      RdoAbsObject::CurlMem mem = {buf->data(), text->size()};
+	      parse(mem);
+	    }
+	  }});
+      if(parsers[p].name=="parse/quota") break; // no health tests
+    }
+  }
+  // leave full caches behind for the draws
+  {
+    std::string text = Canned("integers");
+    ints->setHealthTests(false);
+    ints->parse({&text[0], text.size()});
+    text = Canned("fractions");
+    fracs->setHealthTests(false);
+    fracs->parse({&text[0], text.size()});
+    text = Canned("strings");
+    strs->setHealthTests(false);
+    strs->parse({&text[0], text.size()});
+    text = Canned("bytes");
+    bytes->setHealthTests(false);
+    bytes->parse({&text[0], text.size()});
+  }
+
+  // --------------------------------------------
+  // draws from memory, rewinding before the end of the cache
+  cases.push_back({"rndm/integers", sizeof(long int), [ints](unsigned long n){
+	long int sum = 0;
+	for(unsigned long i=0; i<n; i++){
+	  if(i % kValues==0) ints->rewind();
+	  sum += ints->rndm();
+	}
+	gSink = gSink + sum;
+      }});
+  cases.push_back({"rndm/fractions", sizeof(double), [fracs](unsigned long n){
+	double sum = 0;
+	for(unsigned long i=0; i<n; i++){
+	  if(i % kValues==0) fracs->rewind();
+	  sum += fracs->rndm();
+	}
+	gSink = gSink + sum;
+      }});
+  cases.push_back({"rndm/strings", 8., [strs](unsigned long n){
+	size_t sum = 0;
+	for(unsigned long i=0; i<n; i++){
+	  if(i % kValues==0) strs->rewind();
+	  sum += strs->rndm().size();
+	}
+	gSink = gSink + sum;
+      }});
+  cases.push_back({"rndm/bytes", 1., [bytes](unsigned long n){
+	unsigned long sum = 0;
+	for(unsigned long i=0; i<n; i++){
+	  if(i % kValues==0) bytes->rewind();
+	  sum += bytes->rndm();
+	}
+	gSink = gSink + sum;
+      }});
+
+  // --------------------------------------------
+  // copies of whole caches
+  cases.push_back({"cache/integers", kValues * (double)sizeof(long int), [ints](unsigned long n){
+	for(unsigned long i=0; i<n; i++) gSink = gSink + ints->cache().size();
+      }});
+  cases.push_back({"cache/fractions", kValues * (double)sizeof(double), [fracs](unsigned long n){
+	for(unsigned long i=0; i<n; i++) gSink = gSink + fracs->cache().size();
+      }});
+  cases.push_back({"cache/strings", kValues * 8., [strs](unsigned long n){
+	for(unsigned long i=0; i<n; i++) gSink = gSink + strs->cache().size();
+      }});
+
+  // --------------------------------------------
+  // reads of whole caches through views, and of consumed ranges (no copies)
+  cases.push_back({"view/integers", kValues * (double)sizeof(long int), [ints](unsigned long n){
+	long int sum = 0;
+	for(unsigned long i=0; i<n; i++)
+	  for(long int v : ints->view()) sum += v;
+	gSink = gSink + sum;
+      }});
+  cases.push_back({"view/integers-visit", kValues * (double)sizeof(long int), [ints](unsigned long n){
+	long int sum = 0;
+	for(unsigned long i=0; i<n; i++)
+	  ints->view().visit([&](auto values){ for(auto v : values) sum += v; });
+	gSink = gSink + sum;
+      }});
+  cases.push_back({"view/fractions", kValues * (double)sizeof(double), [fracs](unsigned long n){
+	double sum = 0;
+	for(unsigned long i=0; i<n; i++)
+	  for(double v : fracs->view()) sum += v;
+	gSink = gSink + sum;
+      }});
+  cases.push_back({"consume/integers", sizeof(long int), [ints](unsigned long n){
+	const unsigned int batch = 100;
+	long int sum = 0;
+	for(unsigned long i=0; i<n; i+=batch){
+	  if(i % kValues==0) ints->rewind();
+	  for(long int v : ints->consume(batch)) sum += v;
+	}
+	gSink = gSink + sum;
+      }});
+
+  // --------------------------------------------
+  // transforms of drawn fractions into other distributions
+  // (example-api-powerlaw's power law, exponential, Box-Muller Gaussian)
+  cases.push_back({"dist/powerlaw", sizeof(double), [fracs](unsigned long n){
+	const double min = 1.0, index = 2.0;
+	double sum = 0;
+	for(unsigned long i=0; i<n; i++){
+	  if(i % kValues==0) fracs->rewind();
+	  sum += min / pow(fracs->rndm(), 1./index);
+	}
+	gSink = gSink + sum;
+      }});
+  cases.push_back({"dist/exponential", sizeof(double), [fracs](unsigned long n){
+	double sum = 0;
+	for(unsigned long i=0; i<n; i++){
+	  if(i % kValues==0) fracs->rewind();
+	  sum += -log(1. - fracs->rndm());
+	}
+	gSink = gSink + sum;
+      }});
+  cases.push_back({"dist/gaussian", sizeof(double), [fracs](unsigned long n){
+	double sum = 0;
+	for(unsigned long i=0; i<n; i++){
+	  if((2*i) % kValues==0) fracs->rewind();
+	  double u1 = 1. - fracs->rndm(), u2 = fracs->rndm();
+	  sum += sqrt(-2. * log(u1)) * cos(2. * M_PI * u2);
+	}
+	gSink = gSink + sum;
+      }});
+
+  return cases;
+}
+
+//_____________________________________________________________________________
+//! a canned random.org plain-text response of kValues values (fixed seed)
+std::string Canned(const std::string& type)
+{
+  std::mt19937 gen(20120101);
+  std::string text;
+  char line[32];
+  if(type=="quota") return "1000000\n";
+  for(unsigned int i=0; i<kValues; i++){
+    if(type=="integers")
+      snprintf(line, sizeof(line), "%ld\n", (long int)(gen() % 10000) + 1);
+    else if(type=="bytes")
+      snprintf(line, sizeof(line), "%u\n", (unsigned int)(gen() % 256));
+    else if(type=="fractions")
+      snprintf(line, sizeof(line), "0.%08u\n", (unsigned int)(gen() % 100000000));
+    else {
+      static const char kAlphabet[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+      for(unsigned int k=0; k<8; k++) line[k] = kAlphabet[gen() % 62];
+      line[8] = '\n';
+      line[9] = '\0';
+    }
+    text += line;
+  }
+  return text;
+}
+
+//_____________________________________________________________________________
+//! find the iterations of a case taking minTime (also warms it up)
+Result Calibrate(const Case& c, double minTime)
+{
+  typedef std::chrono::steady_clock Clock;
+  Result res;
+  res.name = c.name;
+  res.bytes = c.bytes;
+  res.allocs = 0.;
+  unsigned long n = 1;
+  while(true){
+    Clock::time_point t0 = Clock::now();
+    c.run(n);
+    double dt = std::chrono::duration<double>(Clock::now() - t0).count();
+    if(dt >= minTime || n >= (1ul << 40)) break;
+    double scale = (dt > 0.) ? 1.2 * minTime / dt : 100.;
+    n = (unsigned long)(n * std::min(std::max(scale, 2.), 100.));
+  }
+  res.iterations = n;
+  return res;
+}
+
+//_____________________________________________________________________________
+//! time one sample of a case, counting its allocations
+void Sample(const Case& c, Result& res)
+{
+  typedef std::chrono::steady_clock Clock;
+  unsigned long long a0 = gAllocs.load(std::memory_order_relaxed);
+  Clock::time_point t0 = Clock::now();
+  c.run(res.iterations);
+  double dt = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+  res.allocs += gAllocs.load(std::memory_order_relaxed) - a0;
+  res.ns.push_back(dt / res.iterations);
+}
+
+//_____________________________________________________________________________
+//! median ns/op and allocations per op of the samples
+void Summarize(Result& res)
+{
+#ifdef RDO_BENCH_ALLOCS
+  res.allocs /= (double)res.iterations * res.ns.size();
+#else
+  res.allocs = -1.;
+#endif
+  std::vector<double> sorted(res.ns);
+  std::sort(sorted.begin(), sorted.end());
+  res.median = (sorted.size() % 2) ? sorted[sorted.size()/2]
+    : 0.5 * (sorted[sorted.size()/2 - 1] + sorted[sorted.size()/2]);
+}
+
+//_____________________________________________________________________________
+//! print results as a table (ns/op median, min and max over the samples)
+void PrintTable(std::ostream& os, const std::vector<Result>& results)
+{
+  for(unsigned int i=0; i<results.size(); i++){
+    const Result& r = results[i];
+    double lo = *std::min_element(r.ns.begin(), r.ns.end());
+    double hi = *std::max_element(r.ns.begin(), r.ns.end());
+    os << std::left << std::setw(26) << r.name << std::right << std::fixed
+       << std::setprecision(1) << std::setw(12) << r.median << " ns/op"
+       << "  [" << lo << ", " << hi << "]"
+       << std::setprecision(2) << std::setw(10);
+    if(r.allocs >= 0.) os << r.allocs;
+    else os << "-";
+    os << " allocs/op" << std::setprecision(1) << std::setw(10)
+       << r.bytes / r.median * 1e3 << " MB/s" << std::endl;
+    os.unsetf(std::ios::fixed);
+  }
+}
+
+//_____________________________________________________________________________
+//! print results as JSON, e.g. for rdo-benchcmp
+void PrintJson(std::ostream& os, const std::vector<Result>& results, unsigned int repeat)
+{
+  os << std::setprecision(10);
+  os << "{\"repeat\": " << repeat << ", \"benchmarks\": [";
+  for(unsigned int i=0; i<results.size(); i++){
+    const Result& r = results[i];
+    std::string name;
+    RdoJson::quote(name, r.name.c_str());
+    os << (i ? ",\n  " : "\n  ") << "{\"name\": " << name
+       << ", \"iterations\": " << r.iterations
+       << ", \"ns_per_op\": [";
+    for(unsigned int k=0; k<r.ns.size(); k++) os << (k ? ", " : "") << r.ns[k];
+    os << "], \"median_ns\": " << r.median
+       << ", \"allocs_per_op\": ";
+    if(r.allocs >= 0.) os << r.allocs;
+    else os << "null";
+    os << ", \"bytes_per_op\": " << r.bytes
+       << ", \"mb_per_s\": " << r.bytes / r.median * 1e3 << "}";
+  }
+  os << "\n]}" << std::endl;
+}
+
+//_____________________________________________________________________________
+//! print rdo-bench usage to stream
+void PrintUsage(std::ostream& os)
+{
+  os << "Usage: rdo-bench [options] [filter ...]" << std::endl;
+  os << "       Microbenchmarks of libRdO on canned random.org responses (no network)." << std::endl;
+  os << "       Runs the benchmarks whose names contain a filter (all by default)." << std::endl;
+
+  os << std::endl;
+  os << "Groups:" << std::endl;
+  os << "  url/       building request URLs" << std::endl;
+  os << "  write/     assembling responses in the libCURL write callback" << std::endl;
+  os << "  parse/     parsing responses into memory, with and without health tests" << std::endl;
+  os << "  rndm/      drawing values from memory" << std::endl;
+  os << "  cache/     copying whole in-memory caches" << std::endl;
+  os << "  view/      reading whole caches through views (no copies)" << std::endl;
+  os << "  consume/   taking consecutive ranges of a cache through views" << std::endl;
+  os << "  dist/      transforming drawn fractions into other distributions" << std::endl;
+
+  os << std::endl;
+  os << "Options:" << std::endl;
+  os << "  [long], [short]    [example]       [description]" << std::endl;
+  os << "  --help, -h,-?                      show this help message and exit" << std::endl;
+  os << "  --list, -l                         list the selected benchmarks and exit" << std::endl;
+  os << "  --repeat, -r       5               timed samples per benchmark" << std::endl;
+  os << "  --min-time, -t     0.05            seconds per sample" << std::endl;
+  os << "  --format, -f       json            plain (table) or json" << std::endl;
+  os << "  --out-file, -o     bench.json      write to file instead of std::cout" << std::endl;
+  os << "Example: rdo-bench -f json -o bench.json parse/ rndm/" << std::endl;
+  os << "         Will write the parse and rndm benchmarks to bench.json." << std::endl;
+}
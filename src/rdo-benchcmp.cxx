@@ -0,0 +1,241 @@
+/** \file rdo-benchcmp.cxx
+    \brief Source for rdo-benchcmp binary executable
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>     // general utilities
+#include <math.h>       // log, exp
+#include <getopt.h>     // GNU option parsing
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <algorithm>
+#include "RdoJson.hh"
+
+// bootstrap resamples for the confidence intervals
+static const unsigned int kResamples = 2000;
+
+//! a benchmark of an rdo-bench result set
+struct Bench {
+  std::vector<double> ns;  //<! ns/op of every sample
+  double allocs;           //<! allocations per operation (-1 if not counted)
+};
+
+typedef std::map<std::string, Bench> BenchSet;
+
+// methods
+bool ReadSet(const std::string& fileName, BenchSet& set, std::vector<std::string>& order);
+double Median(std::vector<double> v);
+void RatioInterval(const std::vector<double>& base, const std::vector<double>& cur,
+		   double confidence, std::mt19937& gen, double& lo, double& hi);
+void PrintUsage(std::ostream& os);
+
+//_____________________________________________________________________________
+//! rdo-benchcmp binary executable main method
+int main(int argc, char** argv)
+{
+  // --------------------------------------------
+  // parse options
+  static struct option long_options[] =
+    {
+      {"help",       no_argument,       0, 'h'},
+      {"threshold",  required_argument, 0, 't'},
+      {"confidence", required_argument, 0, 'c'},
+      {"allocs",     required_argument, 0, 'a'},
+      {0, 0, 0, 0}
+    };
+  bool help = false;
+  double threshold = 0.10, confidence = 0.95, allocSlack = 0.5;
+  int option_index(0), option_char(-1);
+  while((option_char = getopt_long(argc, argv, "h?t:c:a:", long_options, &option_index)) != -1){
+    switch(option_char){
+    case 'h': help = true; break;
+    case '?': help = true; break;
+    case 't': threshold = atof(optarg); break;
+    case 'c': confidence = atof(optarg); break;
+    case 'a': allocSlack = atof(optarg); break;
+    default:  abort();
+    }
+  }
+  if(help){ PrintUsage(std::cout); return 0; }
+  if(argc - optind != 2){ PrintUsage(std::cerr); return -1; }
+  if(threshold < 0. || confidence <= 0. || confidence >= 1.){
+    std::cerr << "rdo-benchcmp: Need threshold >= 0 and 0 < confidence < 1" << std::endl;
+    return -1;
+  }
+
+  // --------------------------------------------
+  // read the result sets
+  BenchSet base, cur;
+  std::vector<std::string> baseOrder, curOrder;
+  if(ReadSet(argv[optind], base, baseOrder) || ReadSet(argv[optind+1], cur, curOrder)) return -1;
+
+  // --------------------------------------------
+  // compare: a benchmark regressed if the whole confidence interval of the
+  // ratio of medians (new/base) lies above 1 + threshold, or if it
+  // allocates more than allocSlack more per operation
+  std::mt19937 gen(12345);
+  unsigned int nRegressed = 0, nImproved = 0, nCompared = 0;
+  double logRatios = 0.;
+  std::cout << std::left << std::setw(26) << "benchmark" << std::right
+	    << std::setw(12) << "base ns/op" << std::setw(12) << "new ns/op"
+	    << std::setw(9) << "ratio" << "  " << std::setw(17) << std::left
+	    << (std::to_string((int)(confidence * 100 + 0.5)) + "% interval") << std::right
+	    << std::setw(13) << "allocs/op" << "  verdict" << std::endl;
+  for(unsigned int i=0; i<curOrder.size(); i++){
+    const std::string& name = curOrder[i];
+    const Bench& c = cur[name];
+    BenchSet::const_iterator it = base.find(name);
+    std::cout << std::left << std::setw(26) << name << std::right << std::fixed << std::setprecision(1);
+    if(it==base.end()){
+      std::cout << std::setw(12) << "-" << std::setw(12) << Median(c.ns) << "  new" << std::endl;
+      continue;
+    }
+    const Bench& b = it->second;
+    double mb = Median(b.ns), mc = Median(c.ns);
+    logRatios += log(mc / mb);
+    nCompared++;
+    double lo, hi;
+    RatioInterval(b.ns, c.ns, confidence, gen, lo, hi);
+    std::string verdict = "ok";
+    bool allocsUp = (b.allocs >= 0. && c.allocs >= 0. && c.allocs > b.allocs + allocSlack);
+    if(lo > 1. + threshold || allocsUp){
+      verdict = allocsUp ? "REGRESSED (allocs)" : "REGRESSED";
+      nRegressed++;
+    }
+    else if(hi < 1. - threshold){
+      verdict = "improved";
+      nImproved++;
+    }
+    std::ostringstream interval, allocs;
+    interval << std::fixed << std::setprecision(3) << "[" << lo << ", " << hi << "]";
+    if(b.allocs >= 0. && c.allocs >= 0.) allocs << std::fixed << std::setprecision(1) << b.allocs << "->" << c.allocs;
+    else allocs << "-";
+    std::cout << std::setw(12) << mb << std::setw(12) << mc << std::setprecision(3)
+	      << std::setw(9) << mc / mb << "  " << std::left << std::setw(17) << interval.str()
+	      << std::right << std::setw(13) << allocs.str() << "  " << verdict << std::endl;
+    std::cout.unsetf(std::ios::fixed);
+  }
+  for(unsigned int i=0; i<baseOrder.size(); i++)
+    if(cur.find(baseOrder[i])==cur.end())
+      std::cout << std::left << std::setw(26) << baseOrder[i] << std::right << "  missing" << std::endl;
+
+  std::cout << nRegressed << " regressed, " << nImproved << " improved (threshold "
+	    << threshold * 100 << "%)";
+  if(nCompared){
+    double geomean = exp(logRatios / nCompared);
+    std::cout << "; geometric mean ratio " << std::setprecision(3) << geomean
+	      << " (" << 1. / geomean << "x speed)";
+  }
+  std::cout << std::endl;
+  return nRegressed ? 1 : 0;
+}
+
+//_____________________________________________________________________________
+//! read an rdo-bench JSON result set; true if failed
+bool ReadSet(const std::string& fileName, BenchSet& set, std::vector<std::string>& order)
+{
+  std::ifstream ifs(fileName.c_str());
+  if(!ifs.is_open()){
+    std::cerr << "rdo-benchcmp: Failed to open file " << fileName.c_str() << std::endl;
+    return true;
+  }
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  std::string text = ss.str();
+
+  RdoJson json;
+  if(json.parse(&text[0], text.size())){
+    std::cerr << "rdo-benchcmp: " << fileName.c_str() << ": " << json.error() << std::endl;
+    return true;
+  }
+  int benchmarks = json.find(0, "benchmarks");
+  if(json.type(benchmarks)!=RdoJson::kArray){
+    std::cerr << "rdo-benchcmp: " << fileName.c_str() << ": No benchmarks array" << std::endl;
+    return true;
+  }
+  for(int k=0; k<json.children(benchmarks); k++){
+    int b = json.at(benchmarks, k);
+    int name = json.find(b, "name"), ns = json.find(b, "ns_per_op"), allocs = json.find(b, "allocs_per_op");
+    if(json.type(name)!=RdoJson::kString || json.type(ns)!=RdoJson::kArray || json.children(ns)==0){
+      std::cerr << "rdo-benchcmp: " << fileName.c_str() << ": Malformed benchmark " << k << std::endl;
+      return true;
+    }
+    Bench bench;
+    for(int s=0; s<json.children(ns); s++) bench.ns.push_back(json.asDouble(json.at(ns, s)));
+    bench.allocs = (allocs < 0 || json.isNull(allocs)) ? -1. : json.asDouble(allocs);
+    if(set.find(json.str(name))==set.end()) order.push_back(json.str(name));
+    set[json.str(name)] = bench;
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+//! median of the values
+double Median(std::vector<double> v)
+{
+  if(v.empty()) return 0.;
+  std::sort(v.begin(), v.end());
+  size_t n = v.size();
+  return (n % 2) ? v[n/2] : 0.5 * (v[n/2 - 1] + v[n/2]);
+}
+
+//_____________________________________________________________________________
+//! bootstrap confidence interval [lo, hi] of median(cur) / median(base)
+void RatioInterval(const std::vector<double>& base, const std::vector<double>& cur,
+		   double confidence, std::mt19937& gen, double& lo, double& hi)
+{
+  std::uniform_int_distribution<size_t> pickBase(0, base.size() - 1), pickCur(0, cur.size() - 1);
+  std::vector<double> ratios(kResamples), b(base.size()), c(cur.size());
+  for(unsigned int r=0; r<kResamples; r++){
+    for(size_t k=0; k<b.size(); k++) b[k] = base[pickBase(gen)];
+    for(size_t k=0; k<c.size(); k++) c[k] = cur[pickCur(gen)];
+    double mb = Median(b);
+    ratios[r] = (mb > 0.) ? Median(c) / mb : 1.;
+  }
+  std::sort(ratios.begin(), ratios.end());
+  double tail = 0.5 * (1. - confidence);
+  lo = ratios[(size_t)(tail * (kResamples - 1))];
+  hi = ratios[(size_t)((1. - tail) * (kResamples - 1))];
+}
+
+//_____________________________________________________________________________
+//! print rdo-benchcmp usage to stream
+void PrintUsage(std::ostream& os)
+{
+  os << "Usage: rdo-benchcmp [options] [base.json] [new.json]" << std::endl;
+  os << "       Compare two rdo-bench JSON result sets (rdo-bench -f json)." << std::endl;
+  os << "       A benchmark REGRESSED when the bootstrap confidence interval of the ratio of" << std::endl;
+  os << "       median ns/op (new/base) lies wholly above 1 + threshold, or when it makes more" << std::endl;
+  os << "       allocations per op than allowed. Exits 1 if any benchmark regressed." << std::endl;
+
+  os << std::endl;
+  os << "Options:" << std::endl;
+  os << "  [long], [short]    [example]       [description]" << std::endl;
+  os << "  --help, -h,-?                      show this help message and exit" << std::endl;
+  os << "  --threshold, -t    0.10            slowdown tolerated, as a fraction" << std::endl;
+  os << "  --confidence, -c   0.95            confidence of the interval" << std::endl;
+  os << "  --allocs, -a       0.5             extra allocations per op tolerated" << std::endl;
+  os << "Example: rdo-benchcmp -t 0.15 bench/baseline.json out/bench.json" << std::endl;
+  os << "         Will fail if a benchmark got clearly more than 15% slower." << std::endl;
+}
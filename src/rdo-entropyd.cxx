@@ -0,0 +1,556 @@
+/** \file rdo-entropyd.cxx
+    \brief Source for rdo-entropyd binary executable
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>      // snprintf
+#include <stdlib.h>     // general utilities
+#include <string.h>     // string handling functions
+#include <errno.h>      // errno
+#include <signal.h>     // signal handling
+#include <poll.h>       // poll
+#include <unistd.h>     // close, unlink, geteuid
+#include <sys/stat.h>   // lstat, chmod, umask
+#include <sys/time.h>   // timeval
+#include <sys/socket.h> // socket
+#include <sys/un.h>     // sockaddr_un
+#include <iostream>
+#include <ostream>
+#include <vector>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include "RdoBytes.hh"
+#include "RdoQuota.hh"
+#include "RdoDaemon.hh"
+#include "RdoMetrics.hh"
+#include "RdoOptions.hh"
+
+// bytes per random.org request
+static const unsigned int kChunk = 10000;
+// longest back-off after failed downloads (seconds)
+static const unsigned int kMaxBackOff = 64;
+
+//! pool of health-tested random bytes, refilled from random.org
+struct Pool {
+  std::vector<unsigned char> ring;   //<! ring buffer
+  size_t head;                       //<! index of the oldest byte
+  size_t count;                      //<! number of bytes in the pool
+  size_t waiting;                    //<! bytes wanted by blocked clients
+  unsigned long long served;         //<! bytes served
+  std::atomic<bool> stop;            //<! set on shutdown; ends the waits
+  std::mutex mutex;                  //<! guards the pool
+  std::condition_variable filled;    //<! signalled when bytes are added
+  std::condition_variable drained;   //<! signalled when the pool needs a refill
+};
+
+//! client connection and its thread
+struct Client {
+  int fd;                            //<! connected socket (closed when joined)
+  std::thread thread;                //<! serving thread
+  std::atomic<bool> done;            //<! set when the thread is finished
+};
+
+// stop flag, set by SIGINT/SIGTERM
+static volatile sig_atomic_t gStop = 0;
+// metrics of the refills and the pool
+static RdoMetrics gMetrics;
+
+// methods
+void Refill(const RdoOptions* opt, Pool* pool);
+void Serve(Client* client, const RdoOptions* opt, Pool* pool);
+bool Take(Pool* pool, unsigned char* out, size_t n, unsigned int timeout);
+bool DrawIntegers(Pool* pool, const RdoDaemonItem& item, std::vector<char>& out, unsigned int timeout);
+bool DrawFractions(Pool* pool, const RdoDaemonItem& item, std::vector<char>& out, unsigned int timeout);
+int Listen(const std::string& path);
+void MetricsLoop(int mfd, Pool* pool);
+void ServeMetrics(int fd);
+void Stop(int sig);
+void PrintUsage(std::ostream& os);
+
+//_____________________________________________________________________________
+//! rdo-entropyd binary executable main method
+int main(int argc, char** argv)
+{
+  // --------------------------------------------
+  // parse options
+  RdoOptions opt(argc, argv);
+  if(opt.help){ PrintUsage(std::cout); return 0; }
+  if(opt.socket=="") opt.socket = RdoDaemon::defaultSocket();
+  if(opt.socket==RdoDaemon::privateSocket() && RdoDaemon::checkPrivateDir(opt.socket, true)) return -1;
+  if(opt.pool < 2*kChunk) opt.pool = 2*kChunk;
+
+  // --------------------------------------------
+  // listen on the socket, and on the metrics socket
+  int lfd = Listen(opt.socket);
+  if(lfd < 0) return -1;
+  int mfd = -1;
+  bool metricsSocket = (opt.metrics.compare(0, 5, "unix:")==0);
+  if(metricsSocket){
+    mfd = Listen(opt.metrics.substr(5));
+    if(mfd < 0){
+      close(lfd);
+      unlink(opt.socket.c_str());
+      return -1;
+    }
+  }
+
+  signal(SIGINT, Stop);
+  signal(SIGTERM, Stop);
+  signal(SIGPIPE, SIG_IGN);
+
+  // --------------------------------------------
+  // fill the pool in the background
+  Pool pool;
+  pool.ring.resize(opt.pool);
+  pool.head = pool.count = pool.waiting = 0;
+  pool.served = 0;
+  pool.stop = false;
+  std::thread refill(Refill, &opt, &pool);
+  std::thread metrics;
+  if(metricsSocket) metrics = std::thread(MetricsLoop, mfd, &pool);
+  if(opt.pLevel > 0)
+    std::clog << "rdo-entropyd: Listening on " << opt.socket.c_str() << " with a "
+	      << opt.pool << " byte pool" << std::endl;
+
+  // --------------------------------------------
+  // serve clients, one thread each; metrics to their file once a second
+  // (on their socket, they have a thread of their own)
+  std::list<Client> clients;
+  std::chrono::steady_clock::time_point written = std::chrono::steady_clock::now();
+  while(!gStop){
+    if(opt.metrics!="" && !metricsSocket && std::chrono::steady_clock::now() - written >= std::chrono::seconds(1)){
+      gMetrics.writeFile(opt.metrics.c_str());
+      written = std::chrono::steady_clock::now();
+    }
+    struct pollfd pfd;
+    pfd.fd = lfd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    // join the threads of closed connections
+    for(std::list<Client>::iterator it=clients.begin(); it!=clients.end(); ){
+      if(!it->done){ ++it; continue; }
+      it->thread.join();
+      close(it->fd);
+      it = clients.erase(it);
+    }
+    if(poll(&pfd, 1, 250) <= 0 || !(pfd.revents & POLLIN)) continue;
+    int fd = accept(lfd, 0, 0);
+    if(fd < 0) continue;
+    clients.emplace_back();
+    Client& client = clients.back();
+    client.fd = fd;
+    client.done = false;
+    client.thread = std::thread(Serve, &client, &opt, &pool);
+  }
+
+  // --------------------------------------------
+  // stop the threads before the pool goes away: end the pool waits and the
+  // client reads, and join (the refill thread finishes a running download)
+  pool.stop = true;
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.filled.notify_all();
+    pool.drained.notify_all();
+  }
+  for(std::list<Client>::iterator it=clients.begin(); it!=clients.end(); ++it)
+    shutdown(it->fd, SHUT_RDWR);
+  for(std::list<Client>::iterator it=clients.begin(); it!=clients.end(); ++it){
+    it->thread.join();
+    close(it->fd);
+  }
+  refill.join();
+  if(metrics.joinable()) metrics.join();
+
+  // --------------------------------------------
+  // clean & return
+  close(lfd);
+  unlink(opt.socket.c_str());
+  if(metricsSocket){
+    close(mfd);
+    unlink(opt.metrics.c_str() + 5);
+  }
+  else if(opt.metrics!="") gMetrics.writeFile(opt.metrics.c_str());
+  if(opt.pLevel > 0){
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    std::clog << "rdo-entropyd: Served " << pool.served << " bytes" << std::endl;
+  }
+  return 0;
+}
+
+//_____________________________________________________________________________
+//! keep the pool above half full, downloading (health-tested) bytes from random.org
+void Refill(const RdoOptions* opt, Pool* pool)
+{
+  unsigned int backOff = 1;
+  while(!pool->stop){
+    // wait until the pool is below half full or a client is waiting
+    size_t space = 0;
+    {
+      std::unique_lock<std::mutex> lock(pool->mutex);
+      while(!pool->stop && pool->count > pool->ring.size()/2 && pool->waiting==0)
+	pool->drained.wait_for(lock, std::chrono::milliseconds(250));
+      space = pool->ring.size() - pool->count;
+    }
+    if(pool->stop) break;
+
+    // check the shared quota
+    bool failed = false;
+    if(opt->quota){
+      RdoQuota quota;
+      quota.setHttps(opt->useHTTPS);
+      quota.setRdoUrl(opt->host.c_str());
+      quota.setAgent(opt->agent.c_str());
+      quota.setProxy(opt->proxy.c_str());
+      quota.setProxyType(opt->proxyType.c_str());
+      quota.setTimeOut(opt->timeout);
+      quota.setInMemory(true);
+      quota.setMetrics(&gMetrics);
+      failed = quota.downloadData() || !quota.withinQuota();
+      if(failed) std::cerr << "rdo-entropyd: Quota exceeded or unavailable" << std::endl;
+    }
+
+    // download
+    RdoBytes rdo;
+    if(!failed){
+      rdo.setHttps(opt->useHTTPS);
+      rdo.setRdoUrl(opt->host.c_str());
+      rdo.setAgent(opt->agent.c_str());
+      rdo.setProxy(opt->proxy.c_str());
+      rdo.setProxyType(opt->proxyType.c_str());
+      rdo.setTimeOut(opt->timeout);
+      rdo.setInMemory(true);
+      rdo.setBase("16");
+      rdo.setColumns(1);
+      rdo.setNum(space < kChunk ? space : kChunk);
+      rdo.setMetrics(&gMetrics);
+      failed = rdo.downloadData();
+    }
+
+    // back off after failures
+    if(failed){
+      std::cerr << "rdo-entropyd: Refill failed, retrying in " << backOff << " s" << std::endl;
+      for(unsigned int s=0; s<4*backOff && !pool->stop; s++)
+	std::this_thread::sleep_for(std::chrono::milliseconds(250));
+      if(backOff < kMaxBackOff) backOff *= 2;
+      continue;
+    }
+    backOff = 1;
+
+    // add to the pool
+    RdoCacheView<unsigned char> data = rdo.view();
+    {
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      size_t size = pool->ring.size();
+      for(size_t k=0; k<data.size() && pool->count<size; k++){
+	pool->ring[(pool->head + pool->count) % size] = (unsigned char)data[k];
+	pool->count++;
+      }
+      gMetrics.setGauge(RdoMetrics::kPoolBytes, pool->count);
+      if(opt->pLevel > 1)
+	std::clog << "rdo-entropyd: Pool refilled to " << pool->count << " bytes" << std::endl;
+    }
+    pool->filled.notify_all();
+  }
+}
+
+//_____________________________________________________________________________
+//! take n bytes from the pool, waiting at most timeout seconds for refills; true if failed
+bool Take(Pool* pool, unsigned char* out, size_t n, unsigned int timeout)
+{
+  std::chrono::steady_clock::time_point deadline =
+    std::chrono::steady_clock::now() + std::chrono::seconds(timeout);
+  std::unique_lock<std::mutex> lock(pool->mutex);
+  size_t size = pool->ring.size();
+  while(n > 0){
+    // wait for bytes
+    if(pool->count==0){
+      pool->waiting += n;
+      pool->drained.notify_one();
+      bool expired = false;
+      while(pool->count==0 && !pool->stop && !expired)
+	expired = (pool->filled.wait_until(lock, deadline)==std::cv_status::timeout);
+      pool->waiting -= n;
+      if(pool->count==0) return true;
+    }
+
+    // copy out of the ring and wipe
+    size_t m = (n < pool->count) ? n : pool->count;
+    for(size_t k=0; k<m; k++){
+      out[k] = pool->ring[pool->head];
+      pool->ring[pool->head] = 0;
+      pool->head = (pool->head + 1) % size;
+    }
+    pool->count -= m;
+    pool->served += m;
+    gMetrics.add(RdoMetrics::kServedBytes, m);
+    gMetrics.setGauge(RdoMetrics::kPoolBytes, pool->count);
+    out += m;
+    n -= m;
+  }
+  if(pool->count <= size/2) pool->drained.notify_one();
+  return false;
+}
+
+//_____________________________________________________________________________
+//! append n unbiased integers in [min,max] (rejection sampling); true if failed
+bool DrawIntegers(Pool* pool, const RdoDaemonItem& item, std::vector<char>& out, unsigned int timeout)
+{
+  // bytes and mask covering max-min
+  uint64_t span = (uint64_t)item.max - (uint64_t)item.min;
+  unsigned int nBytes = 1;
+  while(nBytes < 8 && (span >> (8*nBytes))) nBytes++;
+  uint64_t mask = span;
+  for(unsigned int s=1; s<64; s*=2) mask |= mask >> s;
+
+  size_t pos = out.size();
+  out.resize(pos + item.n * sizeof(int64_t));
+  std::vector<unsigned char> buf(item.n * nBytes);
+  size_t used = 0, avail = 0;
+  bool failed = false;
+  for(uint32_t k=0; k<item.n; ){
+    // more bytes; enough for the remaining values if none are rejected
+    if(used + nBytes > avail){
+      avail = (item.n - k) * nBytes;
+      used = 0;
+      if((failed = Take(pool, buf.data(), avail, timeout))) break;
+    }
+    uint64_t v = 0;
+    for(unsigned int b=0; b<nBytes; b++) v = (v << 8) | buf[used++];
+    v &= mask;
+    if(v > span) continue;
+    int64_t value = (int64_t)((uint64_t)item.min + v);
+    memcpy(&out[pos + k*sizeof(int64_t)], &value, sizeof(value));
+    k++;
+  }
+  // wipe, like the pool and the replies
+  explicit_bzero(buf.data(), buf.size());
+  return failed;
+}
+
+//_____________________________________________________________________________
+//! append n fractions in [0,1) with 53 random bits each; true if failed
+bool DrawFractions(Pool* pool, const RdoDaemonItem& item, std::vector<char>& out, unsigned int timeout)
+{
+  std::vector<unsigned char> buf(item.n * 7);
+  bool failed = Take(pool, buf.data(), buf.size(), timeout);
+
+  size_t pos = out.size();
+  if(!failed) out.resize(pos + item.n * sizeof(double));
+  for(uint32_t k=0; k<item.n && !failed; k++){
+    uint64_t v = 0;
+    for(unsigned int b=0; b<7; b++) v = (v << 8) | buf[7*k + b];
+    double value = (double)(v >> 3) * (1. / 9007199254740992.); // 2^-53
+    memcpy(&out[pos + k*sizeof(double)], &value, sizeof(value));
+  }
+  // wipe, like the pool and the replies
+  explicit_bzero(buf.data(), buf.size());
+  return failed;
+}
+
+//_____________________________________________________________________________
+//! serve the batches of one client connection (closed by main when joined)
+void Serve(Client* client, const RdoOptions* opt, Pool* pool)
+{
+  int fd = client->fd;
+  RdoDaemonHeader head;
+  std::vector<RdoDaemonItem> items;
+  std::vector<char> out;
+  while(!RdoDaemon::readAll(fd, &head, sizeof(head))){
+    if(head.magic!=RdoDaemon::kMagic || head.nItems > RdoDaemon::kMaxItems) break;
+    items.resize(head.nItems);
+    if(head.nItems && RdoDaemon::readAll(fd, items.data(), head.nItems * sizeof(RdoDaemonItem))) break;
+
+    // check the size of the whole reply before drawing anything
+    head.status = RdoDaemon::kOk;
+    out.clear();
+    uint64_t total = 0;
+    for(unsigned int k=0; k<items.size(); k++){
+      if(items[k].n > RdoDaemon::kMaxN) head.status = RdoDaemon::kBadRequest;
+      total += RdoDaemon::dataSize(items[k]);
+    }
+    if(total > RdoDaemon::kMaxBytes) head.status = RdoDaemon::kBadRequest;
+
+    // draw the data of all items
+    try{
+      for(unsigned int k=0; k<items.size() && head.status==RdoDaemon::kOk; k++){
+	const RdoDaemonItem& item = items[k];
+	bool failed = false;
+	if(item.type==RdoDaemon::kBytes){
+	  size_t pos = out.size();
+	  out.resize(pos + item.n);
+	  failed = Take(pool, (unsigned char*)out.data() + pos, item.n, opt->timeout);
+	}
+	else if(item.type==RdoDaemon::kIntegers && item.min <= item.max)
+	  failed = DrawIntegers(pool, item, out, opt->timeout);
+	else if(item.type==RdoDaemon::kFractions)
+	  failed = DrawFractions(pool, item, out, opt->timeout);
+	else head.status = RdoDaemon::kBadRequest;
+	if(failed) head.status = RdoDaemon::kUnavailable;
+      }
+    }
+    catch(const std::bad_alloc&){
+      std::cerr << "rdo-entropyd: Out of memory for a " << total << " byte reply" << std::endl;
+      head.status = RdoDaemon::kUnavailable;
+    }
+
+    // reply
+    if(head.status!=RdoDaemon::kOk){
+      memset(out.data(), 0, out.size());
+      out.clear();
+    }
+    if(RdoDaemon::writeAll(fd, &head, sizeof(head))) break;
+    if(!out.empty() && RdoDaemon::writeAll(fd, out.data(), out.size())) break;
+    memset(out.data(), 0, out.size());
+  }
+  client->done = true;
+}
+
+//_____________________________________________________________________________
+//! listen on a Unix domain socket open to the user only (mode 0600), replacing
+//! a stale socket of the user's but not a running daemon or anything else; -1 if failed
+int Listen(const std::string& path)
+{
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(path.size() >= sizeof(addr.sun_path)){
+    std::cerr << "rdo-entropyd: Socket path too long " << path.c_str() << std::endl;
+    return -1;
+  }
+  strcpy(addr.sun_path, path.c_str());
+
+  int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(lfd < 0){
+    std::cerr << "rdo-entropyd: Failed to create socket: " << strerror(errno) << std::endl;
+    return -1;
+  }
+  if(connect(lfd, (struct sockaddr*)&addr, sizeof(addr))==0){
+    std::cerr << "rdo-entropyd: Already running on " << path.c_str() << std::endl;
+    close(lfd);
+    return -1;
+  }
+  close(lfd);
+  struct stat st;
+  if(lstat(path.c_str(), &st)==0){
+    if(!S_ISSOCK(st.st_mode) || st.st_uid!=geteuid()){
+      std::cerr << "rdo-entropyd: Not replacing " << path.c_str()
+		<< ", which is not a socket of this user" << std::endl;
+      return -1;
+    }
+    unlink(path.c_str());
+  }
+
+  // bind with no access for others from the start (before any thread runs)
+  lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+  mode_t mask = umask(077);
+  bool failed = (lfd < 0 || bind(lfd, (struct sockaddr*)&addr, sizeof(addr))!=0);
+  umask(mask);
+  if(failed || chmod(path.c_str(), 0600)!=0 || listen(lfd, 64)!=0){
+    std::cerr << "rdo-entropyd: Failed to listen on " << path.c_str()
+	      << ": " << strerror(errno) << std::endl;
+    if(lfd >= 0) close(lfd);
+    return -1;
+  }
+  return lfd;
+}
+
+//_____________________________________________________________________________
+//! accept metrics connections until the pool stops, on a thread apart from
+//! the entropy clients' accepts
+void MetricsLoop(int mfd, Pool* pool)
+{
+  while(!pool->stop){
+    struct pollfd pfd;
+    pfd.fd = mfd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if(poll(&pfd, 1, 250) <= 0 || !(pfd.revents & POLLIN)) continue;
+    int fd = accept(mfd, 0, 0);
+    if(fd >= 0) ServeMetrics(fd);
+  }
+}
+
+//_____________________________________________________________________________
+//! answer a metrics connection with the metrics as an HTTP response, so that
+//! e.g. curl --unix-socket works, and close it; a client that does not read
+//! is given up after a second
+void ServeMetrics(int fd)
+{
+  struct timeval tv;
+  tv.tv_sec = 1;
+  tv.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  // skip a request, if one comes quickly
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  char buf[1024];
+  if(poll(&pfd, 1, 100) > 0){
+    ssize_t n = read(fd, buf, sizeof(buf));
+    (void)n;
+  }
+
+  std::string body = gMetrics.text();
+  char head[128];
+  snprintf(head, sizeof(head), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+	   "Content-Length: %lu\r\n\r\n", (unsigned long)body.size());
+  if(!RdoDaemon::writeAll(fd, head, strlen(head))) RdoDaemon::writeAll(fd, body.data(), body.size());
+  close(fd);
+}
+
+//_____________________________________________________________________________
+//! signal handler; stop serving
+void Stop(int /*sig*/)
+{
+  gStop = 1;
+}
+
+//_____________________________________________________________________________
+//! print rdo-entropyd usage to stream
+void PrintUsage(std::ostream& os)
+{
+  os << "Usage: rdo-entropyd [options]" << std::endl;
+  os << "       Serve random data from www.random.org to local clients over a Unix domain socket." << std::endl;
+  os << "       A pool of health-tested bytes is kept over half full; clients get bytes, integers" << std::endl;
+  os << "       in a range (rejection sampled) or fractions in [0,1) from it (see RdoDaemon)." << std::endl;
+
+  os << std::endl;
+  os << "Options:" << std::endl;
+  os << "  [long], [short]    [example]       [description]" << std::endl;
+  os << "  --help, -h,-?                      show this help message and exit" << std::endl;
+  os << "  --print-level, -p  1               print start/stop (1) and refills (2) to std::clog" << std::endl;
+  os << "  --socket, -U       /tmp/rdo.sock   socket path, created with mode 0600 (default: $RDO_ENTROPYD_SOCKET," << std::endl;
+  os << "                                     or rdo-entropyd.sock in $XDG_RUNTIME_DIR or in /tmp/rdo-entropyd-[uid]/)" << std::endl;
+  os << "  --pool, -P         1048576         pool size in bytes (at least 20000)" << std::endl;
+  os << "  --quota, -Q                        check the quota before every refill" << std::endl;
+  os << "  --metrics, -M      rdo.prom        rewrite Prometheus metrics to a file every second, or serve" << std::endl;
+  os << "                                     them on a socket given as unix:/path/to/socket" << std::endl;
+  os << "  --agent, -g        me@me.org       set the user agent" << std::endl;
+  os << "  --not-secure, -X                   use HTTP, not HTTPS" << std::endl;
+  os << "  --host, -H         www.random.org  server [host]:[port-number]" << std::endl;
+  os << "  --proxy, -x        127.0.0.1:9050  connect through [proxy-url]:[port-number]" << std::endl;
+  os << "  --proxy-type, -y   SOCKS4a         type of proxy; HTTP, SOCKS4, SOCKS4a, SOCKS5" << std::endl;
+  os << "  --time-out, -t     120             time in seconds to wait for server (and clients for the pool)" << std::endl;
+  os << "Example: rdo-entropyd --socket /tmp/rdo.sock &" << std::endl;
+  os << "         random-dot-org binary --socket /tmp/rdo.sock -n 1024 > key.bin" << std::endl;
+}
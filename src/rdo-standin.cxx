@@ -0,0 +1,713 @@
+/** \file rdo-standin.cxx
+    \brief Source for rdo-standin binary executable
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>     // general utilities
+#include <stdio.h>      // snprintf
+#include <string.h>     // strerror, memset
+#include <strings.h>    // strncasecmp
+#include <errno.h>      // errno
+#include <math.h>       // log2, ceil
+#include <signal.h>     // signal
+#include <getopt.h>     // GNU option parsing
+#include <unistd.h>     // read, write, close
+#include <poll.h>       // poll
+#include <netinet/in.h> // sockaddr_in
+#include <netinet/tcp.h> // TCP_NODELAY
+#include <arpa/inet.h>  // inet_pton
+#include <sys/socket.h> // socket
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <set>
+#include "RdoJson.hh"
+
+// random.org limits
+static const long int kMaxNum = 10000;        // values per request
+static const long int kMaxInt = 1000000000;   // magnitude of integer bounds
+static const unsigned int kMaxLength = 20;    // string length
+static const unsigned int kMaxDecimals = 20;  // decimal places
+static const long int kMaxBlobs = 100;        // blobs per JSON-RPC call
+static const long int kMaxBlobBits = 1048576; // bits per JSON-RPC call
+// quota shown when unlimited
+static const long long kDefaultQuota = 1000000;
+static const long int kDefaultRequests = 200000;
+// JSON-RPC error codes
+static const int kParseError = -32700;
+static const int kInvalidRequest = -32600;
+static const int kMethodNotFound = -32601;
+static const int kInvalidParams = -32602;
+static const int kQuotaExceeded = 403;
+
+//! behaviour of the stand-in
+struct Settings {
+  double latency;      //<! added delay before every response in ms
+  double jitter;       //<! uniform extra delay up to this in ms
+  double bandwidth;    //<! bytes/s per connection (0 for unlimited)
+  double errorRate;    //<! fraction of requests answered with 503
+  bool limitQuota;     //<! refuse requests once the quota is used up
+};
+
+//! a response
+struct Reply {
+  int status;          //<! HTTP status
+  std::string body;    //<! plain text
+  long long bits;      //<! quota cost
+  bool json;           //<! application/json rather than plain text
+};
+
+typedef std::map<std::string, std::string> Query;
+
+// stop flag, set by SIGINT/SIGTERM
+static volatile sig_atomic_t gStop = 0;
+static Settings gSettings;
+// remaining quota in bits
+static std::atomic<long long> gQuota(kDefaultQuota);
+// remaining JSON-RPC requests
+static std::atomic<long int> gRequestsLeft(kDefaultRequests);
+// totals, printed at exit
+static std::atomic<unsigned long> gRequests(0), gErrors(0), gConnections(0);
+static std::atomic<unsigned long long> gBytes(0);
+
+// methods
+void Serve(int fd);
+Reply Respond(const std::string& target);
+Reply Integers(const Query& q, std::mt19937_64& gen);
+Reply Sequences(const Query& q, std::mt19937_64& gen);
+Reply Strings(const Query& q, std::mt19937_64& gen);
+Reply Fractions(const Query& q, std::mt19937_64& gen);
+Reply Invoke(std::string body);
+long long Call(const RdoJson& json, int call, std::string& out, std::mt19937_64& gen);
+Reply Failure(const std::string& msg, int status = 503);
+bool SendAll(int fd, const char* data, size_t size, bool throttle);
+void Stop(int sig);
+void PrintUsage(std::ostream& os);
+
+//_____________________________________________________________________________
+//! rdo-standin binary executable main method
+int main(int argc, char** argv)
+{
+  // --------------------------------------------
+  // parse options
+  static struct option long_options[] =
+    {
+      {"help",       no_argument,       0, 'h'},
+      {"port",       required_argument, 0, 'p'},
+      {"bind",       required_argument, 0, 'B'},
+      {"latency",    required_argument, 0, 'L'},
+      {"jitter",     required_argument, 0, 'J'},
+      {"bandwidth",  required_argument, 0, 'b'},
+      {"error-rate", required_argument, 0, 'e'},
+      {"quota",      required_argument, 0, 'Q'},
+      {0, 0, 0, 0}
+    };
+  bool help = false;
+  int port = 8080;
+  std::string bind("127.0.0.1");
+  gSettings.latency = gSettings.jitter = gSettings.bandwidth = gSettings.errorRate = 0.;
+  gSettings.limitQuota = false;
+  int option_index(0), option_char(-1);
+  while((option_char = getopt_long(argc, argv, "h?p:B:L:J:b:e:Q:", long_options, &option_index)) != -1){
+    switch(option_char){
+    case 'h': help = true; break;
+    case '?': help = true; break;
+    case 'p': port = atoi(optarg); break;
+    case 'B': bind = std::string(optarg); break;
+    case 'L': gSettings.latency = atof(optarg); break;
+    case 'J': gSettings.jitter = atof(optarg); break;
+    case 'b': gSettings.bandwidth = atof(optarg); break;
+    case 'e': gSettings.errorRate = atof(optarg); break;
+    case 'Q': gQuota = atoll(optarg); gSettings.limitQuota = true; break;
+    default:  abort();
+    }
+  }
+  if(help){ PrintUsage(std::cout); return 0; }
+  if(port <= 0 || port > 65535){
+    std::cerr << "rdo-standin: Bad port = " << port << std::endl;
+    return -1;
+  }
+
+  // --------------------------------------------
+  // listen
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if(inet_pton(AF_INET, bind.c_str(), &addr.sin_addr)!=1){
+    std::cerr << "rdo-standin: Bad address = " << bind.c_str() << std::endl;
+    return -1;
+  }
+  int lfd = socket(AF_INET, SOCK_STREAM, 0);
+  int on = 1;
+  if(lfd >= 0) setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  if(lfd < 0 || ::bind(lfd, (struct sockaddr*)&addr, sizeof(addr))!=0 || listen(lfd, 512)!=0){
+    std::cerr << "rdo-standin: Failed to listen on " << bind.c_str() << ":" << port
+	      << ": " << strerror(errno) << std::endl;
+    if(lfd >= 0) close(lfd);
+    return -1;
+  }
+  signal(SIGINT, Stop);
+  signal(SIGTERM, Stop);
+  signal(SIGPIPE, SIG_IGN);
+  std::clog << "rdo-standin: serving on http://" << bind.c_str() << ":" << port << std::endl;
+
+  // --------------------------------------------
+  // accept; every connection gets its own thread
+  while(!gStop){
+    struct pollfd pfd = {lfd, POLLIN, 0};
+    if(poll(&pfd, 1, 200) <= 0) continue;
+    int fd = accept(lfd, 0, 0);
+    if(fd < 0) continue;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    gConnections++;
+    std::thread(Serve, fd).detach();
+  }
+  close(lfd);
+  std::clog << "rdo-standin: " << gRequests << " requests (" << gErrors << " errors) on "
+	    << gConnections << " connections, " << gBytes << " bytes";
+  if(gSettings.limitQuota) std::clog << ", quota left " << gQuota << " bits";
+  std::clog << std::endl;
+  return 0;
+}
+
+//_____________________________________________________________________________
+//! answer the HTTP/1.1 requests on a connection until it is closed
+void Serve(int fd)
+{
+  std::mt19937_64 gen(std::random_device{}());
+  std::uniform_real_distribution<double> uniform(0., 1.);
+  std::string in;
+  char buf[4096];
+  bool open = true;
+  while(open && !gStop){
+    // read a request head
+    size_t end;
+    while((end = in.find("\r\n\r\n"))==std::string::npos){
+      struct pollfd pfd = {fd, POLLIN, 0};
+      int ready = poll(&pfd, 1, 200);
+      if(gStop || ready < 0){ open = false; break; }
+      if(ready==0) continue;
+      ssize_t n = read(fd, buf, sizeof(buf));
+      if(n <= 0 || in.size() > 65536){ open = false; break; }
+      in.append(buf, n);
+    }
+    if(!open) break;
+    std::string head = in.substr(0, end);
+    in.erase(0, end + 4);
+
+    // request line and the headers we care for
+    std::string method, target, version;
+    size_t s1 = head.find(' '), s2 = head.find(' ', s1 + 1);
+    size_t eol = head.find("\r\n");
+    if(s1==std::string::npos || s2==std::string::npos || s2 > eol) break;
+    method = head.substr(0, s1);
+    target = head.substr(s1 + 1, s2 - s1 - 1);
+    version = head.substr(s2 + 1, eol - s2 - 1);
+    bool keepAlive = (version=="HTTP/1.1");
+    size_t bodyLength = 0;
+    for(size_t pos = eol + 2; pos < head.size(); ){
+      size_t next = head.find("\r\n", pos);
+      if(next==std::string::npos) next = head.size();
+      std::string line = head.substr(pos, next - pos);
+      if(strncasecmp(line.c_str(), "Connection:", 11)==0){
+	if(line.find("close")!=std::string::npos) keepAlive = false;
+	if(line.find("keep-alive")!=std::string::npos) keepAlive = true;
+      }
+      if(strncasecmp(line.c_str(), "Content-Length:", 15)==0) bodyLength = atol(line.c_str() + 15);
+      pos = next + 2;
+    }
+    // the body of a POST
+    if(bodyLength > (1u << 20)) break;
+    while(in.size() < bodyLength){
+      ssize_t n = read(fd, buf, sizeof(buf));
+      if(n <= 0){ open = false; break; }
+      in.append(buf, n);
+    }
+    if(!open) break;
+    std::string body = in.substr(0, bodyLength);
+    in.erase(0, bodyLength);
+
+    // answer
+    Reply reply;
+    bool rpc = (method=="POST" && target=="/json-rpc/4/invoke");
+    if(method!="GET" && !rpc) reply = Failure("Error: Only GET requests and JSON-RPC are supported", 405);
+    else if(gSettings.errorRate > 0. && uniform(gen) < gSettings.errorRate) reply = Failure("Error: Simulated failure");
+    else if(rpc) reply = Invoke(body);
+    else reply = Respond(target);
+    gRequests++;
+    if(reply.status!=200) gErrors++;
+    double delay = gSettings.latency + gSettings.jitter * uniform(gen);
+    if(delay > 0.) std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(delay));
+
+    const char* reason = (reply.status==200) ? "OK" : (reply.status==404) ? "Not Found"
+      : (reply.status==405) ? "Method Not Allowed" : "Service Unavailable";
+    char header[256];
+    int len = snprintf(header, sizeof(header),
+		       "HTTP/1.1 %d %s\r\nContent-Type: %s; charset=utf-8\r\n"
+		       "Content-Length: %zu\r\nConnection: %s\r\n\r\n",
+		       reply.status, reason, reply.json ? "application/json" : "text/plain",
+		       reply.body.size(), keepAlive ? "keep-alive" : "close");
+    if(SendAll(fd, header, len, false) || SendAll(fd, reply.body.data(), reply.body.size(), true)) break;
+    gBytes += reply.body.size();
+    open = keepAlive;
+  }
+  close(fd);
+}
+
+//_____________________________________________________________________________
+//! the reply to a request target (path and query)
+Reply Respond(const std::string& target)
+{
+  // path and query parameters
+  size_t qpos = target.find('?');
+  std::string path = target.substr(0, qpos);
+  Query q;
+  if(qpos!=std::string::npos){
+    std::string query = target.substr(qpos + 1);
+    for(size_t pos = 0; pos <= query.size(); ){
+      size_t amp = query.find('&', pos);
+      if(amp==std::string::npos) amp = query.size();
+      std::string pair = query.substr(pos, amp - pos);
+      size_t eq = pair.find('=');
+      if(eq!=std::string::npos) q[pair.substr(0, eq)] = pair.substr(eq + 1);
+      pos = amp + 1;
+    }
+  }
+  if(path.size() > 1 && path[path.size()-1]!='/') path += '/';
+
+  if(path=="/quota/"){
+    char text[32];
+    snprintf(text, sizeof(text), "%lld\n", (long long)gQuota);
+    return {200, text, 0, false};
+  }
+  bool known = (path=="/integers/" || path=="/sequences/" || path=="/strings/" || path=="/decimal-fractions/");
+  if(!known) return Failure("Error: Not found", 404);
+  if(q.count("format") && q["format"]!="plain")
+    return Failure("Error: The stand-in only serves format=plain");
+  if(gSettings.limitQuota && gQuota < 0)
+    return Failure("Error: You have used your quota of random bits for today.  See the quota page for details.");
+
+  // the same pre-generated randomization gives the same data
+  std::mt19937_64 gen(std::random_device{}());
+  std::string rnd = q.count("rnd") ? q["rnd"] : "new";
+  if(rnd!="new") gen.seed(std::hash<std::string>()(target));
+
+  Reply reply;
+  if(path=="/integers/") reply = Integers(q, gen);
+  else if(path=="/sequences/") reply = Sequences(q, gen);
+  else if(path=="/strings/") reply = Strings(q, gen);
+  else reply = Fractions(q, gen);
+  if(reply.status==200 && gSettings.limitQuota) gQuota -= reply.bits;
+  return reply;
+}
+
+//_____________________________________________________________________________
+//! value of a query parameter as an integer; def if absent, false if malformed
+static bool Number(const Query& q, const char* key, long int def, long int& value)
+{
+  Query::const_iterator it = q.find(key);
+  if(it==q.end()){ value = def; return true; }
+  char* end = 0;
+  value = strtol(it->second.c_str(), &end, 10);
+  return end!=it->second.c_str() && *end=='\0';
+}
+
+//_____________________________________________________________________________
+//! on or off query parameter
+static bool Flag(const Query& q, const char* key, bool def)
+{
+  Query::const_iterator it = q.find(key);
+  return (it==q.end()) ? def : it->second=="on";
+}
+
+//_____________________________________________________________________________
+//! append values to a body, col per row separated by tabs
+static void Arrange(std::string& body, const std::vector<std::string>& values, long int col)
+{
+  for(size_t i=0; i<values.size(); i++){
+    body += values[i];
+    body += ((long int)((i + 1) % col)==0 || i + 1==values.size()) ? '\n' : '\t';
+  }
+}
+
+//_____________________________________________________________________________
+//! /integers/?num=&min=&max=&col=&base=
+Reply Integers(const Query& q, std::mt19937_64& gen)
+{
+  long int num, min, max, col, base;
+  if(!Number(q, "num", 1, num) || num < 1 || num > kMaxNum)
+    return Failure("Error: The number of random integers must be between 1 and 10,000");
+  if(!Number(q, "min", 1, min) || !Number(q, "max", 100, max) || min < -kMaxInt || max > kMaxInt || min > max)
+    return Failure("Error: The range must be within [-1e9,1e9] with min <= max");
+  if(!Number(q, "col", 1, col) || col < 1) return Failure("Error: The number of columns must be at least 1");
+  if(!Number(q, "base", 10, base) || (base!=2 && base!=8 && base!=10 && base!=16))
+    return Failure("Error: The base must be 2, 8, 10 or 16");
+
+  std::uniform_int_distribution<long int> dist(min, max);
+  std::vector<std::string> values(num);
+  for(long int i=0; i<num; i++){
+    long int v = dist(gen);
+    if(base==10){ values[i] = std::to_string(v); continue; }
+    std::string digits;
+    unsigned long a = (v < 0) ? -v : v;
+    do { digits += "0123456789abcdef"[a % base]; a /= base; } while(a);
+    if(v < 0) digits += '-';
+    values[i].assign(digits.rbegin(), digits.rend());
+  }
+  Reply r = {200, "", (long long)num * (long long)ceil(log2((double)(max - min) + 1.)), false};
+  Arrange(r.body, values, col);
+  return r;
+}
+
+//_____________________________________________________________________________
+//! /sequences/?min=&max=&col=
+Reply Sequences(const Query& q, std::mt19937_64& gen)
+{
+  long int min, max, col;
+  if(!Number(q, "min", 1, min) || !Number(q, "max", 100, max) || min < -kMaxInt || max > kMaxInt || min > max)
+    return Failure("Error: The range must be within [-1e9,1e9] with min <= max");
+  if(max - min + 1 > kMaxNum) return Failure("Error: The sequence must be at most 10,000 long");
+  if(!Number(q, "col", 1, col) || col < 1) return Failure("Error: The number of columns must be at least 1");
+
+  std::vector<long int> seq(max - min + 1);
+  for(long int i=0; i<(long int)seq.size(); i++) seq[i] = min + i;
+  std::shuffle(seq.begin(), seq.end(), gen);
+  std::vector<std::string> values(seq.size());
+  for(size_t i=0; i<seq.size(); i++) values[i] = std::to_string(seq[i]);
+  Reply r = {200, "", (long long)seq.size() * (long long)ceil(log2((double)seq.size() + 1.)), false};
+  Arrange(r.body, values, col);
+  return r;
+}
+
+//_____________________________________________________________________________
+//! /strings/?num=&len=&digits=&upperalpha=&loweralpha=&unique=
+Reply Strings(const Query& q, std::mt19937_64& gen)
+{
+  long int num, len;
+  if(!Number(q, "num", 1, num) || num < 1 || num > kMaxNum)
+    return Failure("Error: The number of random strings must be between 1 and 10,000");
+  if(!Number(q, "len", 8, len) || len < 1 || len > (long int)kMaxLength)
+    return Failure("Error: The length of the strings must be between 1 and 20");
+  std::string alphabet;
+  if(Flag(q, "digits", true)) alphabet += "0123456789";
+  if(Flag(q, "upperalpha", true)) alphabet += "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  if(Flag(q, "loweralpha", true)) alphabet += "abcdefghijklmnopqrstuvwxyz";
+  if(alphabet.empty()) return Failure("Error: At least one type of characters must be allowed");
+  bool unique = Flag(q, "unique", false);
+  if(unique && pow((double)alphabet.size(), (double)len) < num)
+    return Failure("Error: Too few possible strings for unique strings");
+
+  std::uniform_int_distribution<size_t> dist(0, alphabet.size() - 1);
+  std::vector<std::string> values;
+  std::map<std::string, bool> seen;
+  while((long int)values.size() < num){
+    std::string s(len, ' ');
+    for(long int k=0; k<len; k++) s[k] = alphabet[dist(gen)];
+    if(unique && !seen.insert(std::make_pair(s, true)).second) continue;
+    values.push_back(s);
+  }
+  Reply r = {200, "", (long long)ceil(num * len * log2((double)alphabet.size())), false};
+  Arrange(r.body, values, 1);
+  return r;
+}
+
+//_____________________________________________________________________________
+//! /decimal-fractions/?num=&dec=&col=
+Reply Fractions(const Query& q, std::mt19937_64& gen)
+{
+  long int num, dec, col;
+  if(!Number(q, "num", 1, num) || num < 1 || num > kMaxNum)
+    return Failure("Error: The number of decimal fractions must be between 1 and 10,000");
+  if(!Number(q, "dec", 10, dec) || dec < 1 || dec > (long int)kMaxDecimals)
+    return Failure("Error: The number of decimal places must be between 1 and 20");
+  if(!Number(q, "col", 1, col) || col < 1) return Failure("Error: The number of columns must be at least 1");
+
+  std::uniform_int_distribution<int> digit(0, 9);
+  std::vector<std::string> values(num);
+  for(long int i=0; i<num; i++){
+    values[i] = "0.";
+    for(long int k=0; k<dec; k++) values[i] += (char)('0' + digit(gen));
+  }
+  Reply r = {200, "", (long long)ceil(num * dec * log2(10.)), false};
+  Arrange(r.body, values, col);
+  return r;
+}
+
+//_____________________________________________________________________________
+//! the reply to a JSON-RPC request (one call or a batch) to /json-rpc/4/invoke
+Reply Invoke(std::string body)
+{
+  Reply r = {200, "", 0, true};
+  RdoJson json;
+  if(body.empty() || json.parse(&body[0], body.size())){
+    r.body = "{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32700,\"message\":\"Parse error\",\"data\":null},\"id\":null}";
+    return r;
+  }
+  std::mt19937_64 gen(std::random_device{}());
+  gRequestsLeft--;
+  if(json.type(0)!=RdoJson::kArray){
+    r.bits = Call(json, 0, r.body, gen);
+    return r;
+  }
+  r.body = "[";
+  for(int c = json.first(0), k = 0; k < json.children(0); c = json.next(c), k++){
+    if(k) r.body += ",";
+    r.bits += Call(json, c, r.body, gen);
+  }
+  r.body += "]";
+  return r;
+}
+
+//_____________________________________________________________________________
+//! append a JSON-RPC error response
+static void RpcError(std::string& out, int code, const char* msg, const std::string& id)
+{
+  char head[80];
+  snprintf(head, sizeof(head), "{\"jsonrpc\":\"2.0\",\"error\":{\"code\":%d,\"message\":", code);
+  out += head;
+  RdoJson::quote(out, msg);
+  out += ",\"data\":null},\"id\":" + id + "}";
+}
+
+//_____________________________________________________________________________
+//! value of a JSON-RPC parameter as an integer; def if absent, false if not a number
+static bool Param(const RdoJson& json, int params, const char* key, long int def, long int& value)
+{
+  int tok = json.find(params, key);
+  if(tok < 0){ value = def; return true; }
+  if(json.type(tok)!=RdoJson::kPrimitive) return false;
+  char* end = 0;
+  value = strtol(json.str(tok), &end, 10);
+  return end!=json.str(tok) && *end=='\0';
+}
+
+//_____________________________________________________________________________
+//! base64 text of bytes
+static std::string Base64(const unsigned char* b, size_t n)
+{
+  static const char* digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  out.reserve((n + 2) / 3 * 4);
+  for(size_t i=0; i<n; i+=3){
+    unsigned long v = (unsigned long)b[i] << 16;
+    if(i + 1 < n) v |= (unsigned long)b[i+1] << 8;
+    if(i + 2 < n) v |= b[i+2];
+    out += digits[(v >> 18) & 63];
+    out += digits[(v >> 12) & 63];
+    out += (i + 1 < n) ? digits[(v >> 6) & 63] : '=';
+    out += (i + 2 < n) ? digits[v & 63] : '=';
+  }
+  return out;
+}
+
+//_____________________________________________________________________________
+//! append the JSON-RPC response to one call of generateIntegers,
+//! generateDecimalFractions, generateStrings or generateBlobs; the bits used
+long long Call(const RdoJson& json, int call, std::string& out, std::mt19937_64& gen)
+{
+  // id, echoed as given
+  int idTok = json.find(call, "id");
+  std::string id;
+  if(json.type(idTok)==RdoJson::kString) RdoJson::quote(id, json.str(idTok));
+  else if(json.type(idTok)==RdoJson::kPrimitive) id = json.str(idTok);
+  else id = "null";
+
+  int params = json.find(call, "params");
+  std::string method = json.str(json.find(call, "method"));
+  if(json.type(call)!=RdoJson::kObject || std::string(json.str(json.find(call, "jsonrpc")))!="2.0" || method==""){
+    RpcError(out, kInvalidRequest, "Invalid Request", id);
+    return 0;
+  }
+  if(method!="generateIntegers" && method!="generateDecimalFractions" &&
+     method!="generateStrings" && method!="generateBlobs"){
+    RpcError(out, kMethodNotFound, "Method not found", id);
+    return 0;
+  }
+  if(json.type(params)!=RdoJson::kObject || json.type(json.find(params, "apiKey"))!=RdoJson::kString){
+    RpcError(out, kInvalidParams, "Invalid params: apiKey is required", id);
+    return 0;
+  }
+  if(gSettings.limitQuota && gQuota < 0){
+    RpcError(out, kQuotaExceeded, "The API key you specified has exceeded its daily limit", id);
+    return 0;
+  }
+  int repTok = json.find(params, "replacement");
+  bool replacement = (repTok < 0) || json.asBool(repTok);
+
+  // data, as a JSON array
+  std::string data("[");
+  long long bits = 0;
+  long int n;
+  if(!Param(json, params, "n", -1, n) || n < 1 || n > (method=="generateBlobs" ? kMaxBlobs : kMaxNum)){
+    RpcError(out, kInvalidParams, "Invalid params: n is out of range", id);
+    return 0;
+  }
+  if(method=="generateIntegers"){
+    long int min, max;
+    if(!Param(json, params, "min", kMaxInt + 1, min) || !Param(json, params, "max", -kMaxInt - 1, max) ||
+       min < -kMaxInt || max > kMaxInt || min > max || (!replacement && max - min + 1 < n)){
+      RpcError(out, kInvalidParams, "Invalid params: min and max must be within [-1e9,1e9] with min <= max, and n at most max-min+1 without replacement", id);
+      return 0;
+    }
+    std::uniform_int_distribution<long int> dist(min, max);
+    std::set<long int> seen;
+    for(long int i=0; i<n; i++){
+      long int v = dist(gen);
+      if(!replacement && !seen.insert(v).second){ i--; continue; }
+      if(i) data += ",";
+      data += std::to_string(v);
+    }
+    bits = (long long)n * (long long)ceil(log2((double)(max - min) + 1.));
+  }
+  else if(method=="generateDecimalFractions"){
+    long int dec;
+    if(!Param(json, params, "decimalPlaces", 0, dec) || dec < 1 || dec > (long int)kMaxDecimals ||
+       (!replacement && pow(10., (double)dec) < n)){
+      RpcError(out, kInvalidParams, "Invalid params: decimalPlaces must be between 1 and 20, with enough values without replacement", id);
+      return 0;
+    }
+    std::uniform_int_distribution<int> digit(0, 9);
+    std::set<std::string> seen;
+    for(long int i=0; i<n; i++){
+      std::string v("0.");
+      for(long int k=0; k<dec; k++) v += (char)('0' + digit(gen));
+      if(!replacement && !seen.insert(v).second){ i--; continue; }
+      if(i) data += ",";
+      data += v;
+    }
+    bits = (long long)ceil(n * dec * log2(10.));
+  }
+  else if(method=="generateStrings"){
+    long int len;
+    int chars = json.find(params, "characters");
+    std::string alphabet = (json.type(chars)==RdoJson::kString) ? json.str(chars) : "";
+    if(!Param(json, params, "length", 0, len) || len < 1 || len > (long int)kMaxLength || alphabet.empty() ||
+       (!replacement && pow((double)alphabet.size(), (double)len) < n)){
+      RpcError(out, kInvalidParams, "Invalid params: length must be between 1 and 20, with some characters", id);
+      return 0;
+    }
+    std::uniform_int_distribution<size_t> dist(0, alphabet.size() - 1);
+    std::set<std::string> seen;
+    for(long int i=0; i<n; i++){
+      std::string v(len, ' ');
+      for(long int k=0; k<len; k++) v[k] = alphabet[dist(gen)];
+      if(!replacement && !seen.insert(v).second){ i--; continue; }
+      if(i) data += ",";
+      RdoJson::quote(data, v.c_str());
+    }
+    bits = (long long)ceil(n * len * log2((double)alphabet.size()));
+  }
+  else {
+    long int size;
+    int format = json.find(params, "format");
+    if(!Param(json, params, "size", 0, size) || size < 1 || size % 8 || n * size > kMaxBlobBits ||
+       (format >= 0 && std::string(json.str(format))!="base64")){
+      RpcError(out, kInvalidParams, "Invalid params: size must be a multiple of 8, at most 1048576 bits in all, in base64", id);
+      return 0;
+    }
+    std::vector<unsigned char> blob(size / 8);
+    for(long int i=0; i<n; i++){
+      for(size_t k=0; k<blob.size(); k++) blob[k] = (unsigned char)gen();
+      if(i) data += ",";
+      data += "\"" + Base64(blob.data(), blob.size()) + "\"";
+    }
+    bits = (long long)n * size;
+  }
+  data += "]";
+
+  // result
+  if(gSettings.limitQuota) gQuota -= bits;
+  char stats[160];
+  snprintf(stats, sizeof(stats), "\"bitsUsed\":%lld,\"bitsLeft\":%lld,\"requestsLeft\":%ld,\"advisoryDelay\":0",
+	   bits, (long long)gQuota, (long int)gRequestsLeft);
+  out += "{\"jsonrpc\":\"2.0\",\"result\":{\"random\":{\"data\":" + data + "},";
+  out += stats;
+  out += "},\"id\":" + id + "}";
+  return bits;
+}
+
+//_____________________________________________________________________________
+//! an error reply; random.org answers errors with a plain-text message
+Reply Failure(const std::string& msg, int status)
+{
+  return {status, msg + "\n", 0, false};
+}
+
+//_____________________________________________________________________________
+//! write all data, in slices paced to the bandwidth if throttled
+bool SendAll(int fd, const char* data, size_t size, bool throttle)
+{
+  typedef std::chrono::steady_clock Clock;
+  bool paced = throttle && gSettings.bandwidth > 0.;
+  size_t slice = paced ? std::max((size_t)1024, (size_t)(gSettings.bandwidth / 100.)) : size;
+  Clock::time_point start = Clock::now();
+  size_t done = 0;
+  while(done < size){
+    ssize_t n = write(fd, data + done, std::min(slice, size - done));
+    if(n < 0 && errno==EINTR) continue;
+    if(n <= 0) return true;
+    done += n;
+    if(paced)
+      std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>
+				    (std::chrono::duration<double>(done / gSettings.bandwidth)));
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+//! signal handler; stop serving
+void Stop(int /*sig*/)
+{
+  gStop = 1;
+}
+
+//_____________________________________________________________________________
+//! print rdo-standin usage to stream
+void PrintUsage(std::ostream& os)
+{
+  os << "Usage: rdo-standin [options]" << std::endl;
+  os << "       Local HTTP/1.1 stand-in for random.org, for offline load tests." << std::endl;
+  os << "       Serves /integers/, /sequences/, /strings/, /decimal-fractions/ and /quota/" << std::endl;
+  os << "       in the plain-text format and within the limits of random.org, and the" << std::endl;
+  os << "       JSON-RPC calls generateIntegers, generateDecimalFractions, generateStrings and" << std::endl;
+  os << "       generateBlobs (single or batched) at /json-rpc/4/invoke, like api.random.org." << std::endl;
+
+  os << std::endl;
+  os << "Options:" << std::endl;
+  os << "  [long], [short]    [example]       [description]" << std::endl;
+  os << "  --help, -h,-?                      show this help message and exit" << std::endl;
+  os << "  --port, -p         8080            port to listen on" << std::endl;
+  os << "  --bind, -B         127.0.0.1       address to listen on" << std::endl;
+  os << "  --latency, -L      50              delay before every response in ms" << std::endl;
+  os << "  --jitter, -J       20              extra random delay of up to this in ms" << std::endl;
+  os << "  --bandwidth, -b    1e6             bytes/s per connection (default unlimited)" << std::endl;
+  os << "  --error-rate, -e   0.01            fraction of requests failed with 503" << std::endl;
+  os << "  --quota, -Q        1000000         quota in bits; requests are refused once it is" << std::endl;
+  os << "                                     used up (default unlimited)" << std::endl;
+  os << "Example: rdo-standin -p 8080 -L 50 -e 0.01 &" << std::endl;
+  os << "         random-dot-org bench -X -H localhost:8080 -W 16 -R 1000" << std::endl;
+  os << "         Will measure libRdO throughput over 16 connections against the stand-in." << std::endl;
+}
@@ -0,0 +1,336 @@
+/** \file rdo-stattest.cxx
+    \brief Source for rdo-stattest binary executable
+*/
+/*  libRdO for downloading data from random.org
+    Copyright (C) 2012 Doug Hague
+
+    libRdO is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libRdO is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with libRdO.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>     // general utilities
+#include <getopt.h>     // GNU option parsing
+#include <ctype.h>      // isspace
+#include <fcntl.h>      // open
+#include <unistd.h>     // close
+#include <sys/mman.h>   // mmap
+#include <sys/stat.h>   // fstat
+#include <iostream>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include "RdoStatTest.hh"
+
+// significance level below which a test is reported as failed
+static const double kAlpha = 1e-4;
+
+//! a parsed chunk of a text file
+struct Chunk {
+  std::vector<unsigned long long> values;  //<! parsed values (two's complement for integers)
+  std::vector<unsigned char> bytes;        //<! parsed bytes
+  unsigned long long bad;                  //<! number of tokens that failed to parse
+};
+
+// methods
+void ParseChunk(const char* begin, const char* end, const std::string& type,
+		int base, unsigned int decimals, Chunk* chunk);
+void PrintUsage(std::ostream& os);
+
+//_____________________________________________________________________________
+//! rdo-stattest binary executable main method
+int main(int argc, char** argv)
+{
+  // --------------------------------------------
+  // parse options
+  static struct option long_options[] =
+    {
+      {"help",     no_argument,       0, 'h'},
+      {"base",     required_argument, 0, 'b'},
+      {"min",      required_argument, 0, 'l'},
+      {"max",      required_argument, 0, 'u'},
+      {"threads",  required_argument, 0, 'T'},
+      {0, 0, 0, 0}
+    };
+  bool help = false, hasMin = false, hasMax = false;
+  int base = 10;
+  long int min = 0, max = 0;
+  unsigned int nThreads = std::thread::hardware_concurrency();
+  int option_index(0), option_char(-1);
+  while((option_char = getopt_long(argc, argv, "h?b:l:u:T:", long_options, &option_index)) != -1){
+    switch(option_char){
+    case 'h': help = true; break;
+    case '?': help = true; break;
+    case 'b': base = atoi(optarg); break;
+    case 'l': min = atol(optarg); hasMin = true; break;
+    case 'u': max = atol(optarg); hasMax = true; break;
+    case 'T': nThreads = atoi(optarg); break;
+    default:  abort();
+    }
+  }
+  if(help){ PrintUsage(std::cout); return 0; }
+  if(argc - optind != 2){ PrintUsage(std::cerr); return -1; }
+  std::string type(argv[optind]);
+  std::string fileName(argv[optind+1]);
+  if(type!="binary" && type!="bytes" && type!="integers" && type!="fractions"){
+    std::cerr << "rdo-stattest: Unknown data type = " << type.c_str() << std::endl;
+    PrintUsage(std::cerr);
+    return -1;
+  }
+  if(base!=2 && base!=8 && base!=10 && base!=16){
+    std::cerr << "rdo-stattest: Unknown base = " << base << std::endl;
+    return -1;
+  }
+  if(nThreads < 1) nThreads = 1;
+
+  // --------------------------------------------
+  // memory-map the input
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if(fd < 0){
+    std::cerr << "rdo-stattest: Failed to open file " << fileName.c_str() << std::endl;
+    return -1;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size == 0){
+    std::cerr << "rdo-stattest: Empty or unreadable file " << fileName.c_str() << std::endl;
+    close(fd);
+    return -1;
+  }
+  size_t size = st.st_size;
+  void* map = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED){
+    std::cerr << "rdo-stattest: Failed to memory-map file " << fileName.c_str() << std::endl;
+    return -1;
+  }
+  madvise(map, size, MADV_SEQUENTIAL);
+  const char* data = static_cast<const char*>(map);
+
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+  // --------------------------------------------
+  // load the symbols
+  RdoStatTest tests;
+  if(type=="binary"){
+    tests.setBytes(reinterpret_cast<const unsigned char*>(data), size);
+  }
+  else{
+    // decimals from the first fraction
+    unsigned int decimals = 0;
+    if(type=="fractions"){
+      const char* p = data;
+      while(p < data+size && *p!='.') p++;
+      for(p++; p < data+size && *p>='0' && *p<='9'; p++) decimals++;
+      if(decimals==0){
+	std::cerr << "rdo-stattest: No decimal fractions in " << fileName.c_str() << std::endl;
+	munmap(map, size);
+	return -1;
+      }
+      if(decimals > 9) decimals = 9;
+    }
+
+    // split at whitespace and parse the chunks in parallel
+    std::vector<Chunk> chunks(nThreads);
+    std::vector<std::thread> pool;
+    const char* begin = data;
+    for(unsigned int t=0; t<nThreads; t++){
+      const char* end = data + (size * (t+1)) / nThreads;
+      while(end < data+size && !isspace(*end)) end++;
+      if(end < begin) end = begin;
+      pool.push_back(std::thread(ParseChunk, begin, end, type, base, decimals, &chunks[t]));
+      begin = end;
+    }
+    for(unsigned int t=0; t<nThreads; t++) pool[t].join();
+
+    // gather
+    unsigned long long bad = 0, n = 0;
+    for(unsigned int t=0; t<nThreads; t++){
+      bad += chunks[t].bad;
+      n += chunks[t].values.size() + chunks[t].bytes.size();
+    }
+    if(bad){
+      std::cerr << "rdo-stattest: Failed to parse " << bad << " tokens in " << fileName.c_str() << std::endl;
+      munmap(map, size);
+      return -1;
+    }
+
+    if(type=="bytes"){
+      std::vector<unsigned char> all;
+      all.reserve(n);
+      for(unsigned int t=0; t<nThreads; t++){
+	all.insert(all.end(), chunks[t].bytes.begin(), chunks[t].bytes.end());
+	std::vector<unsigned char>().swap(chunks[t].bytes);
+      }
+      tests.setBytes(all);
+    }
+    else{
+      std::vector<unsigned long long> all;
+      all.reserve(n);
+      for(unsigned int t=0; t<nThreads; t++){
+	all.insert(all.end(), chunks[t].values.begin(), chunks[t].values.end());
+	std::vector<unsigned long long>().swap(chunks[t].values);
+      }
+      unsigned long long nSymbols = 1;
+      if(type=="fractions"){
+	for(unsigned int k=0; k<decimals; k++) nSymbols *= 10;
+	for(unsigned long long i=0; i<all.size(); i++) if(all[i] >= nSymbols) all[i] = nSymbols-1;
+      }
+      else if(!all.empty()){
+	// integers: shift by the minimum (modular arithmetic handles negatives)
+	long long lo = (long long)all[0], hi = lo;
+	for(unsigned long long i=0; i<all.size(); i++){
+	  long long v = (long long)all[i];
+	  if(v < lo) lo = v;
+	  if(v > hi) hi = v;
+	}
+	if(hasMin){
+	  if(lo < min){ std::cerr << "rdo-stattest: Found integer " << lo << " below --min" << std::endl; munmap(map, size); return -1; }
+	  lo = min;
+	}
+	if(hasMax){
+	  if(hi > max){ std::cerr << "rdo-stattest: Found integer " << hi << " above --max" << std::endl; munmap(map, size); return -1; }
+	  hi = max;
+	}
+	for(unsigned long long i=0; i<all.size(); i++) all[i] -= (unsigned long long)lo;
+	nSymbols = (unsigned long long)(hi - lo) + 1;
+      }
+      tests.setSymbols(all, nSymbols);
+    }
+  }
+
+  std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+  // --------------------------------------------
+  // run the battery
+  std::vector<RdoStatResult> results = tests.runAll(nThreads);
+
+  std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+  // --------------------------------------------
+  // report
+  std::cout << "rdo-stattest: " << tests.size() << " " << type.c_str() << " samples, "
+	    << tests.nSymbols() << " symbols, from " << fileName.c_str() << std::endl;
+  std::cout << "  [test]              [statistic]   [dof/mean]    [p-value]     [result]" << std::endl;
+  int nFailed = 0;
+  for(unsigned int k=0; k<results.size(); k++){
+    const RdoStatResult& r = results[k];
+    bool failed = (r.pValue < kAlpha);
+    if(failed) nFailed++;
+    std::cout << "  " << std::left << std::setw(20) << r.name.c_str() << std::right
+	      << std::setw(13) << std::setprecision(6) << r.statistic << " "
+	      << std::setw(12) << std::setprecision(6) << r.dof << " "
+	      << std::setw(12) << std::setprecision(4) << r.pValue << "     "
+	      << (r.n==0 || r.dof==0 ? "SKIPPED" : (failed ? "FAIL" : "PASS")) << std::endl;
+  }
+  std::cout << "  load " << std::chrono::duration<double>(t1-t0).count() << " s, tests "
+	    << std::chrono::duration<double>(t2-t1).count() << " s on " << nThreads << " threads" << std::endl;
+
+  // --------------------------------------------
+  // clean & return
+  munmap(map, size);
+  return nFailed ? 1 : 0;
+}
+
+//_____________________________________________________________________________
+//! parse whitespace-separated tokens in [begin,end)
+void ParseChunk(const char* begin, const char* end, const std::string& type,
+		int base, unsigned int decimals, Chunk* chunk)
+{
+  bool bytes = (type=="bytes");
+  bool fractions = (type=="fractions");
+  chunk->bad = 0;
+  chunk->values.reserve(fractions ? (end-begin)/(decimals+3) : (end-begin)/4);
+  const char* p = begin;
+  while(p < end){
+    // skip white space
+    while(p < end && isspace(*p)) p++;
+    if(p >= end) break;
+
+    unsigned long long v = 0;
+    bool neg = false, ok = false;
+    if(fractions){
+      // [0|1].digits, keep the first decimals digits
+      if(*p=='0' || *p=='1'){
+	unsigned long long ip = (*p - '0');
+	p++;
+	if(p < end && *p=='.'){
+	  p++;
+	  unsigned int d = 0;
+	  while(p < end && *p>='0' && *p<='9'){
+	    if(d < decimals){ v = v * 10 + (*p - '0'); d++; }
+	    p++; ok = true;
+	  }
+	  for(; d < decimals; d++) v *= 10;
+	  if(ip) for(unsigned int k=0; k<decimals; k++) ip *= 10;
+	  v += ip;
+	}
+      }
+    }
+    else{
+      if(*p=='-'){ neg = true; p++; }
+      while(p < end){
+	int digit = -1;
+	if(*p>='0' && *p<='9') digit = *p - '0';
+	else if(*p>='a' && *p<='f') digit = *p - 'a' + 10;
+	else if(*p>='A' && *p<='F') digit = *p - 'A' + 10;
+	if(digit < 0 || digit >= base) break;
+	v = v * base + digit;
+	p++; ok = true;
+      }
+      if(neg) v = (unsigned long long)(-(long long)v);
+      if(bytes && (neg || v > 255)) ok = false;
+    }
+
+    // token must end at white space
+    if(p < end && !isspace(*p)) ok = false;
+    if(!ok){
+      chunk->bad++;
+      while(p < end && !isspace(*p)) p++;
+      continue;
+    }
+    if(bytes) chunk->bytes.push_back((unsigned char)v);
+    else chunk->values.push_back(v);
+  }
+}
+
+//_____________________________________________________________________________
+//! print rdo-stattest usage to stream
+void PrintUsage(std::ostream& os)
+{
+  os << "Usage: rdo-stattest [type] [file] [options]" << std::endl;
+  os << "       Run a battery of statistical tests over random data written by random-dot-org." << std::endl;
+
+  os << std::endl;
+  os << "Types:" << std::endl;
+  os << "  binary      raw bytes (random-dot-org binary)" << std::endl;
+  os << "  bytes       bytes as text (random-dot-org bytes)" << std::endl;
+  os << "  integers    integers as text (random-dot-org integers or sequence)" << std::endl;
+  os << "  fractions   decimal fractions as text (random-dot-org fractions)" << std::endl;
+
+  os << std::endl;
+  os << "Tests:" << std::endl;
+  os << "  frequency, runs, serial, poker, birthday-spacings, autocorrelation" << std::endl;
+  os << "  a test FAILs when its p-value is below " << kAlpha << std::endl;
+
+  os << std::endl;
+  os << "Options:" << std::endl;
+  os << "  [long], [short]    [example]       [description]" << std::endl;
+  os << "  --help, -h,-?                      show this help message and exit" << std::endl;
+  os << "  --base, -b         10              base of bytes or integers; 2, 8, 10 or 16" << std::endl;
+  os << "  --min, -l          1               smallest possible integer (default: smallest found)" << std::endl;
+  os << "  --max, -u          10000           largest possible integer (default: largest found)" << std::endl;
+  os << "  --threads, -T      4               number of threads (default: number of cores)" << std::endl;
+  os << "Example: rdo-stattest integers data.txt --min 1 --max 10000" << std::endl;
+  os << "         Will test integers in [1,10000] read from data.txt." << std::endl;
+}